@@ -813,7 +813,7 @@ with file_armfeatures_h.rewrite() as output:
         if reg.name != cppregs[-1].name:
             print(file=output)
 
-# Generate the C/C++ template data structure for regview.cpp.
+# Generate the C/C++ template data structure for regview.def.
 cppregs = [reg for reg in Register.byname.values() if reg.cpusysregs]
 cppregs.sort(key=lambda x: x.name.lower())
 with open(REGVIEW_CPP_OUT, 'w') as output:
@@ -0,0 +1,490 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Recommend the compiler options -march, -mcpu, -mtune from the CPU features
+// of the current system or the intersection of the features of snapshots.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include "featureset.h"
+#include "regsnapshot.h"
+#include "snapfile.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::vector<std::string> inputs;
+    bool line;
+    bool verbose;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Syntax: " << command << " [options] [snapshot ...]" << std::endl
+              << std::endl
+              << "Recommend the compiler options -march, -mcpu and -mtune for the current" << std::endl
+              << "system or, when snapshots are specified, for all systems in the snapshots." << std::endl
+              << "A snapshot is a binary snapshot file (.csrsnap), a registers file (sysregs -a)" << std::endl
+              << "or a collect/ subdirectory. Directories are searched recursively. The features" << std::endl
+              << "of all CPU's in all snapshots are intersected." << std::endl
+              << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -l : display one line of options for the compiler command line" << std::endl
+              << "  -v : verbose, display the CPU's and the features which are missing" << std::endl
+              << "       for the next architecture level" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    inputs(),
+    line(false),
+    verbose(false)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-l") {
+            line = true;
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Architecture levels, extensions and CPU models, as known by GCC and clang.
+//----------------------------------------------------------------------------
+
+// An Armv8.x level: the features which are added to the previous level.
+// The features are those which the compilers may use, plus a few mandatory
+// ones which are visible at EL0, to avoid claiming a level on a partial CPU.
+// Armv9.x is Armv8.(x+5) plus SVE2.
+struct ArchLevel {
+    int minor;
+    std::initializer_list<FeatureId> features;
+};
+
+const ArchLevel ArchLevels[] = {
+    {0, {FeatureId::FEAT_FP, FeatureId::FEAT_AdvSIMD}},
+    {1, {FeatureId::FEAT_CRC32, FeatureId::FEAT_LSE, FeatureId::FEAT_RDM}},
+    {2, {FeatureId::FEAT_DPB}},
+    {3, {FeatureId::FEAT_LRCPC, FeatureId::FEAT_JSCVT, FeatureId::FEAT_FCMA, FeatureId::FEAT_PAuth}},
+    {4, {FeatureId::FEAT_DotProd, FeatureId::FEAT_FlagM, FeatureId::FEAT_LRCPC2}},
+    {5, {FeatureId::FEAT_SB, FeatureId::FEAT_SSBS, FeatureId::FEAT_SPECRES, FeatureId::FEAT_FRINTTS, FeatureId::FEAT_FlagM2}},
+    {6, {FeatureId::FEAT_BF16, FeatureId::FEAT_I8MM}},
+    {7, {FeatureId::FEAT_WFxT, FeatureId::FEAT_XS}},
+    {8, {FeatureId::FEAT_MOPS, FeatureId::FEAT_HBC}},
+    {9, {FeatureId::FEAT_CSSC, FeatureId::FEAT_CLRBHB}},
+};
+
+// First Armv8.x level in Armv9, Armv9.0 is Armv8.5.
+constexpr int ARMV9_BASE = 5;
+
+// An architecture extension (+name), with the Armv8.x level which implies it (-1 if none).
+struct ArchExtension {
+    const char* name;
+    int implied_minor;
+    bool implied_v9;
+    std::initializer_list<FeatureId> features;
+};
+
+const ArchExtension ArchExtensions[] = {
+    {"crc",          1, false, {FeatureId::FEAT_CRC32}},
+    {"lse",          1, false, {FeatureId::FEAT_LSE}},
+    {"rdma",         1, false, {FeatureId::FEAT_RDM}},
+    {"fp16",        -1, false, {FeatureId::FEAT_FP16}},
+    {"fp16fml",     -1, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM}},
+    {"aes",         -1, false, {FeatureId::FEAT_AES, FeatureId::FEAT_PMULL}},
+    {"sha2",        -1, false, {FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {"sha3",        -1, false, {FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {"sm4",         -1, false, {FeatureId::FEAT_SM3, FeatureId::FEAT_SM4}},
+    {"rcpc",         3, false, {FeatureId::FEAT_LRCPC}},
+    {"pauth",        3, false, {FeatureId::FEAT_PAuth}},
+    {"dotprod",      4, false, {FeatureId::FEAT_DotProd}},
+    {"flagm",        4, false, {FeatureId::FEAT_FlagM}},
+    {"sb",           5, false, {FeatureId::FEAT_SB}},
+    {"ssbs",         5, false, {FeatureId::FEAT_SSBS}},
+    {"predres",      5, false, {FeatureId::FEAT_SPECRES}},
+    {"rng",         -1, false, {FeatureId::FEAT_RNG}},
+    {"memtag",      -1, false, {FeatureId::FEAT_MTE}},
+    {"i8mm",         6, false, {FeatureId::FEAT_I8MM}},
+    {"bf16",         6, false, {FeatureId::FEAT_BF16}},
+    {"sve",         -1, true,  {FeatureId::FEAT_SVE}},
+    {"f32mm",       -1, false, {FeatureId::FEAT_SVE, FeatureId::FEAT_F32MM}},
+    {"f64mm",       -1, false, {FeatureId::FEAT_SVE, FeatureId::FEAT_F64MM}},
+    {"sve2",        -1, true,  {FeatureId::FEAT_SVE2}},
+    {"sve2-aes",    -1, false, {FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_AES, FeatureId::FEAT_SVE_PMULL128}},
+    {"sve2-sha3",   -1, false, {FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_SHA3}},
+    {"sve2-sm4",    -1, false, {FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_SM4}},
+    {"sve2-bitperm",-1, false, {FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm}},
+    {"ls64",        -1, false, {FeatureId::FEAT_LS64}},
+    {"mops",         8, false, {FeatureId::FEAT_MOPS}},
+    {"cssc",         9, false, {FeatureId::FEAT_CSSC}},
+    {"sme",         -1, false, {FeatureId::FEAT_SME}},
+    {"sme2",        -1, false, {FeatureId::FEAT_SME2}},
+};
+
+// A CPU model, identified by MIDR_EL1, with the name of its -mcpu and -mtune options.
+// The architecture level of the model and the extensions which -mcpu enables by default
+// (union of GCC and clang, crypto is often enabled but optional) are used to check that
+// -mcpu is safe.
+struct CpuModel {
+    uint32_t implementer;
+    uint32_t part;
+    const char* name;
+    int minor;  // Armv8.x
+    bool v9;    // Armv9.(x-5)
+    std::initializer_list<FeatureId> features;
+};
+
+const CpuModel CpuModels[] = {
+    // Arm Ltd.
+    {0x41, 0xD03, "cortex-a53",   0, false, {FeatureId::FEAT_CRC32, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD04, "cortex-a35",   0, false, {FeatureId::FEAT_CRC32, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD05, "cortex-a55",   2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD07, "cortex-a57",   0, false, {FeatureId::FEAT_CRC32, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD08, "cortex-a72",   0, false, {FeatureId::FEAT_CRC32, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD09, "cortex-a73",   0, false, {FeatureId::FEAT_CRC32, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD0A, "cortex-a75",   2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD0B, "cortex-a76",   2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD0C, "neoverse-n1",  2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD0D, "cortex-a77",   2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD0E, "cortex-a76ae", 2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD40, "neoverse-v1",  4, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SSBS, FeatureId::FEAT_RNG, FeatureId::FEAT_SVE, FeatureId::FEAT_I8MM, FeatureId::FEAT_BF16, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3, FeatureId::FEAT_SM3, FeatureId::FEAT_SM4}},
+    {0x41, 0xD41, "cortex-a78",   2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD42, "cortex-a78ae", 2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD44, "cortex-x1",    2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD46, "cortex-a510",  5, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_I8MM, FeatureId::FEAT_BF16}},
+    {0x41, 0xD47, "cortex-a710",  5, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_I8MM, FeatureId::FEAT_BF16}},
+    {0x41, 0xD48, "cortex-x2",    5, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_I8MM, FeatureId::FEAT_BF16}},
+    {0x41, 0xD49, "neoverse-n2",  5, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_I8MM, FeatureId::FEAT_BF16, FeatureId::FEAT_RNG}},
+    {0x41, 0xD4A, "neoverse-e1",  2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD4B, "cortex-a78c",  2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_LRCPC, FeatureId::FEAT_DotProd, FeatureId::FEAT_SSBS, FeatureId::FEAT_FlagM, FeatureId::FEAT_PAuth, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    {0x41, 0xD4D, "cortex-a715",  5, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_I8MM, FeatureId::FEAT_BF16}},
+    {0x41, 0xD4E, "cortex-x3",    5, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_I8MM, FeatureId::FEAT_BF16}},
+    {0x41, 0xD4F, "neoverse-v2",  5, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_I8MM, FeatureId::FEAT_BF16, FeatureId::FEAT_RNG}},
+    {0x41, 0xD80, "cortex-a520",  7, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE}},
+    {0x41, 0xD81, "cortex-a720",  7, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE}},
+    {0x41, 0xD82, "cortex-x4",    7, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE}},
+    {0x41, 0xD84, "neoverse-v3",  7, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_RNG, FeatureId::FEAT_LS64}},
+    {0x41, 0xD8E, "neoverse-n3",  7, true,  {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_SVE2, FeatureId::FEAT_SVE_BitPerm, FeatureId::FEAT_MTE, FeatureId::FEAT_RNG}},
+    // Cavium
+    {0x43, 0x0AF, "thunderx2t99", 1, false, {FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    // Fujitsu
+    {0x46, 0x001, "a64fx",        2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_SVE, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    // HiSilicon
+    {0x48, 0xD01, "tsv110",       2, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_DotProd, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256}},
+    // Apple (efficiency and performance cores)
+    {0x61, 0x022, "apple-m1",     4, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x023, "apple-m1",     4, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x024, "apple-m1",     4, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x025, "apple-m1",     4, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x028, "apple-m1",     4, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x029, "apple-m1",     4, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x032, "apple-m2",     6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x033, "apple-m2",     6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x034, "apple-m2",     6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x035, "apple-m2",     6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x038, "apple-m2",     6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x039, "apple-m2",     6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0x61, 0x043, "apple-m3",     6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_FHM, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    // Ampere Computing
+    {0xC0, 0xAC3, "ampere1",      6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_RNG, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3}},
+    {0xC0, 0xAC4, "ampere1a",     6, false, {FeatureId::FEAT_FP16, FeatureId::FEAT_RNG, FeatureId::FEAT_MTE, FeatureId::FEAT_AES, FeatureId::FEAT_PMULL, FeatureId::FEAT_SHA1, FeatureId::FEAT_SHA256, FeatureId::FEAT_SHA512, FeatureId::FEAT_SHA3, FeatureId::FEAT_SM3, FeatureId::FEAT_SM4}},
+};
+
+// Find the CPU model from a MIDR_EL1 value. Return nullptr if unknown.
+const CpuModel* FindCpuModel(csr_u64_t midr)
+{
+    const uint32_t implementer = uint32_t(midr >> 24) & 0xFF;
+    const uint32_t part = uint32_t(midr >> 4) & 0xFFF;
+    for (const auto& model : CpuModels) {
+        if (model.implementer == implementer && model.part == part) {
+            return &model;
+        }
+    }
+    return nullptr;
+}
+
+// Check if all features in a list are in a set.
+bool HasAll(const FeatureSet& set, std::initializer_list<FeatureId> features)
+{
+    return std::all_of(features.begin(), features.end(), [&set](FeatureId id) { return set.has(id); });
+}
+
+// Name of an architecture level.
+std::string ArchName(int minor, bool v9)
+{
+    const int major = v9 ? 9 : 8;
+    const int sub = v9 ? minor - ARMV9_BASE : minor;
+    return sub == 0 ? Format("armv%d-a", major) : Format("armv%d.%d-a", major, sub);
+}
+
+
+//----------------------------------------------------------------------------
+// Collect the features and CPU models of all inputs.
+//----------------------------------------------------------------------------
+
+class Collector
+{
+public:
+    size_t systems = 0;                  // number of systems
+    size_t cpus = 0;                     // number of CPU's in all systems
+    FeatureSet features {};              // intersection of features of all CPU's
+    std::map<std::string, size_t> cores; // CPU model name -> number of CPU's, empty name if unknown
+
+    // Add the current system. Return false on error, with an error message.
+    bool addCurrentSystem(std::string& error);
+
+    // Add all snapshots in a path. Return false on error, with an error message.
+    bool addPath(const std::string& path, std::string& error);
+
+private:
+    // Add the features and the MIDR of one CPU.
+    void addCpu(const FeatureSet& set, csr_u64_t midr);
+
+    // Add one snapshot. Return false on error, with an error message.
+    bool addSnapshot(const std::string& path, std::string& error);
+};
+
+void Collector::addCpu(const FeatureSet& set, csr_u64_t midr)
+{
+    if (cpus++ == 0) {
+        features = set;
+    }
+    else {
+        features &= set;
+    }
+    const CpuModel* model = FindCpuModel(midr);
+    cores[model == nullptr ? std::string() : model->name]++;
+}
+
+bool Collector::addCurrentSystem(std::string& error)
+{
+    FeatureSet set;
+    csr_u64_t midr = 0;
+    if (!set.loadCurrentSystem(error, &midr)) {
+        return false;
+    }
+    systems++;
+    addCpu(set, midr);
+    return true;
+}
+
+bool Collector::addSnapshot(const std::string& path, std::string& error)
+{
+    systems++;
+    const std::string filename(RegSnapshot::FileName(path));
+    if (fs::path(filename).extension() == ".csrsnap") {
+        // A binary snapshot contains all CPU's of the system.
+        SnapFile file;
+        if (!file.open(filename, error)) {
+            return false;
+        }
+        for (size_t cpu = 0; cpu < file.cpuCount(); ++cpu) {
+            ArmFeatures feat;
+            csr_pair_t midr {0, 0};
+            file.getFeatures(feat, cpu);
+            file.get(CSR_REGID_MIDR_EL1, midr, cpu);
+            addCpu(FeatureSet(feat), midr.low);
+        }
+    }
+    else {
+        RegSnapshot snap;
+        if (!snap.load(filename, error)) {
+            return false;
+        }
+        ArmFeatures feat;
+        csr_pair_t midr {0, 0};
+        snap.getFeatures(feat);
+        snap.get(CSR_REGID_MIDR_EL1, midr);
+        addCpu(FeatureSet(feat), midr.low);
+    }
+    return true;
+}
+
+bool Collector::addPath(const std::string& path, std::string& error)
+{
+    const std::vector<std::string> files(RegSnapshot::Search(path));
+    if (files.empty()) {
+        error = "no snapshot found in " + path;
+        return false;
+    }
+    for (const auto& file : files) {
+        if (!addSnapshot(file, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Options opt(argc, argv);
+
+    Collector coll;
+    std::string error;
+    if (opt.inputs.empty() && !coll.addCurrentSystem(error)) {
+        opt.fatal(error);
+    }
+    for (const auto& path : opt.inputs) {
+        if (!coll.addPath(path, error)) {
+            opt.fatal(error);
+        }
+    }
+
+    // Highest Armv8.x level, then Armv9.x when SVE2 is present.
+    int minor = -1;
+    while (minor + 1 < int(std::size(ArchLevels)) && HasAll(coll.features, ArchLevels[minor + 1].features)) {
+        minor++;
+    }
+    if (minor < 0) {
+        opt.fatal("no Armv8-A floating point and SIMD, not an Arm64 system?");
+    }
+    const bool v9 = minor >= ARMV9_BASE && coll.features.has(FeatureId::FEAT_SVE2);
+
+    // Add the extensions which are present but not implied by the architecture level.
+    std::string march("-march=" + ArchName(minor, v9));
+    for (const auto& ext : ArchExtensions) {
+        const bool implied = (ext.implied_minor >= 0 && ext.implied_minor <= minor) || (ext.implied_v9 && v9);
+        if (!implied && HasAll(coll.features, ext.features)) {
+            march += "+";
+            march += ext.name;
+        }
+    }
+
+    // Use -mcpu only when all CPU's are the same known model, with all features of its level
+    // and all extensions which -mcpu enables by default.
+    // With unknown models, tune for the most frequent known model.
+    std::string mcpu;
+    std::string mtune("-mtune=generic");
+    size_t max_count = 0;
+    for (const auto& it : coll.cores) {
+        if (!it.first.empty() && it.second > max_count) {
+            max_count = it.second;
+            mtune = "-mtune=" + it.first;
+        }
+    }
+    const CpuModel* model = nullptr;
+    if (coll.cores.size() == 1 && !coll.cores.begin()->first.empty()) {
+        for (const auto& m : CpuModels) {
+            if (coll.cores.begin()->first == m.name) {
+                model = &m;
+                break;
+            }
+        }
+        if (model != nullptr && model->minor <= minor && (!model->v9 || v9) && HasAll(coll.features, model->features)) {
+            mcpu = std::string("-mcpu=") + model->name;
+        }
+    }
+
+    if (opt.verbose) {
+        std::cout << Format("Systems: %zu, CPU's: %zu", coll.systems, coll.cpus) << std::endl;
+        for (const auto& it : coll.cores) {
+            std::cout << Format("  %-16s %zu", it.first.empty() ? "(unknown)" : it.first.c_str(), it.second) << std::endl;
+        }
+        std::cout << "Architecture: " << ArchName(minor, v9) << std::endl;
+        if (minor + 1 < int(std::size(ArchLevels))) {
+            std::string missing;
+            for (auto id : ArchLevels[minor + 1].features) {
+                if (!coll.features.has(id)) {
+                    missing += " ";
+                    missing += FeatureSet::name(id);
+                }
+            }
+            std::cout << "Missing for " << ArchName(minor + 1, v9) << ":" << missing << std::endl;
+        }
+        if (minor >= ARMV9_BASE && !v9) {
+            std::cout << "Missing for " << ArchName(minor, true) << ": FEAT_SVE2" << std::endl;
+        }
+        if (mcpu.empty() && model != nullptr) {
+            std::string missing;
+            for (auto id : model->features) {
+                if (!coll.features.has(id)) {
+                    missing += " ";
+                    missing += FeatureSet::name(id);
+                }
+            }
+            if (missing.empty()) {
+                std::cout << "No -mcpu, " << model->name << " is " << ArchName(model->minor, model->v9) << std::endl;
+            }
+            else {
+                std::cout << "No -mcpu, some features of " << model->name << " are missing:" << missing << std::endl;
+            }
+        }
+    }
+
+    // One line for the command line: -mcpu alone, or -march and -mtune.
+    // The compilers complain when -march and -mcpu specify different architectures.
+    if (opt.line) {
+        std::cout << (mcpu.empty() ? march + " " + mtune : mcpu) << std::endl;
+    }
+    else {
+        std::cout << march << std::endl;
+        if (!mcpu.empty()) {
+            std::cout << mcpu << std::endl;
+        }
+        std::cout << mtune << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
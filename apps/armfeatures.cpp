@@ -11,6 +11,14 @@
 #include "armfeatures.h"
 #include "restrictions.h"
 
+#if defined(__linux__)
+    #include <fstream>
+    #include <sys/auxv.h>
+    #if !defined(AT_HWCAP3)
+        #define AT_HWCAP3 29
+    #endif
+#endif
+
 
 //----------------------------------------------------------------------------
 // Clear contents.
@@ -132,6 +140,70 @@ bool ArmFeatures::load(RegAccess& reg)
     return _loaded;
 }
 
+//----------------------------------------------------------------------------
+// Save and restore the raw values of all registers.
+//----------------------------------------------------------------------------
+
+const ArmFeatures::SavedRegister ArmFeatures::_all_registers[REGISTER_COUNT] = {
+    {&ArmFeatures::_aa64isar0,  CSR_REGID_ID_AA64ISAR0_EL1},
+    {&ArmFeatures::_aa64isar1,  CSR_REGID_ID_AA64ISAR1_EL1},
+    {&ArmFeatures::_aa64isar2,  CSR_REGID_ID_AA64ISAR2_EL1},
+    {&ArmFeatures::_aa64isar3,  CSR_REGID_ID_AA64ISAR3_EL1},
+    {&ArmFeatures::_aa64pfr0,   CSR_REGID_ID_AA64PFR0_EL1},
+    {&ArmFeatures::_aa64pfr1,   CSR_REGID_ID_AA64PFR1_EL1},
+    {&ArmFeatures::_aa64pfr2,   CSR_REGID_ID_AA64PFR2_EL1},
+    {&ArmFeatures::_aa64dfr0,   CSR_REGID_ID_AA64DFR0_EL1},
+    {&ArmFeatures::_aa64dfr1,   CSR_REGID_ID_AA64DFR1_EL1},
+    {&ArmFeatures::_aa64dfr2,   CSR_REGID_ID_AA64DFR2_EL1},
+    {&ArmFeatures::_aa64fpfr0,  CSR_REGID_ID_AA64FPFR0_EL1},
+    {&ArmFeatures::_aa64mmfr0,  CSR_REGID_ID_AA64MMFR0_EL1},
+    {&ArmFeatures::_aa64mmfr1,  CSR_REGID_ID_AA64MMFR1_EL1},
+    {&ArmFeatures::_aa64mmfr2,  CSR_REGID_ID_AA64MMFR2_EL1},
+    {&ArmFeatures::_aa64mmfr3,  CSR_REGID_ID_AA64MMFR3_EL1},
+    {&ArmFeatures::_aa64mmfr4,  CSR_REGID_ID_AA64MMFR4_EL1},
+    {&ArmFeatures::_aa64smfr0,  CSR_REGID_ID_AA64SMFR0_EL1},
+    {&ArmFeatures::_aa64zfr0,   CSR_REGID_ID_AA64ZFR0_EL1},
+    {&ArmFeatures::_isar0,      CSR_REGID_ID_ISAR0_EL1},
+    {&ArmFeatures::_isar1,      CSR_REGID_ID_ISAR1_EL1},
+    {&ArmFeatures::_isar2,      CSR_REGID_ID_ISAR2_EL1},
+    {&ArmFeatures::_isar3,      CSR_REGID_ID_ISAR3_EL1},
+    {&ArmFeatures::_isar4,      CSR_REGID_ID_ISAR4_EL1},
+    {&ArmFeatures::_isar5,      CSR_REGID_ID_ISAR5_EL1},
+    {&ArmFeatures::_isar6,      CSR_REGID_ID_ISAR6_EL1},
+    {&ArmFeatures::_mmfr0,      CSR_REGID_ID_MMFR0_EL1},
+    {&ArmFeatures::_mmfr1,      CSR_REGID_ID_MMFR1_EL1},
+    {&ArmFeatures::_mmfr2,      CSR_REGID_ID_MMFR2_EL1},
+    {&ArmFeatures::_mmfr3,      CSR_REGID_ID_MMFR3_EL1},
+    {&ArmFeatures::_mmfr4,      CSR_REGID_ID_MMFR4_EL1},
+    {&ArmFeatures::_mmfr5,      CSR_REGID_ID_MMFR5_EL1},
+    {&ArmFeatures::_pfr0,       CSR_REGID_ID_PFR0_EL1},
+    {&ArmFeatures::_pfr1,       CSR_REGID_ID_PFR1_EL1},
+    {&ArmFeatures::_pfr2,       CSR_REGID_ID_PFR2_EL1},
+    {&ArmFeatures::_ctr,        CSR_REGID_CTR_EL0},
+    {&ArmFeatures::_tcr,        CSR_REGID_TCR_EL1},
+    {&ArmFeatures::_tcr2,       CSR_REGID_TCR2_EL1},
+    {&ArmFeatures::_trcdevarch, CSR_REGID_TRCDEVARCH},
+    {&ArmFeatures::_pmmir,      CSR_REGID_PMMIR_EL1},
+    {&ArmFeatures::_pmsidr,     CSR_REGID_PMSIDR_EL1},
+    {&ArmFeatures::_mpamidr,    CSR_REGID_MPAMIDR_EL1},
+    {&ArmFeatures::_trbidr,     CSR_REGID_TRBIDR_EL1},
+};
+
+void ArmFeatures::saveRegisters(csr_u64_t values[REGISTER_COUNT]) const
+{
+    for (size_t i = 0; i < REGISTER_COUNT; ++i) {
+        values[i] = this->*_all_registers[i].field;
+    }
+}
+
+void ArmFeatures::loadRegisters(const csr_u64_t values[REGISTER_COUNT])
+{
+    for (size_t i = 0; i < REGISTER_COUNT; ++i) {
+        this->*_all_registers[i].field = values[i];
+    }
+    _loaded = true;
+}
+
 //----------------------------------------------------------------------------
 // Load features using direct access to system registers in userland.
 // Works on Linux thanks to mrs emulation. Trap on other systems.
@@ -168,3 +240,222 @@ void ArmFeatures::loadDirect()
     }
     _loaded = true;
 }
+
+
+//----------------------------------------------------------------------------
+// Load features on Linux without the kernel module.
+//----------------------------------------------------------------------------
+
+// Bits in AT_HWCAP, AT_HWCAP2, AT_HWCAP3 and corresponding register fields.
+// The bit numbers are part of the Linux ABI (see arch/arm64/include/uapi/asm/hwcap.h),
+// they are defined here to be independent from the version of the system headers.
+namespace {
+    struct HwcapField {
+        int hwcap;  // 1, 2, 3 for AT_HWCAP, AT_HWCAP2, AT_HWCAP3
+        int bit;    // bit number in AT_HWCAPx
+        int regid;  // CSR_REGID_ value of the register
+        int lsb;    // field in register, 4 bits
+        int value;  // field value when the bit is set, zero when unknown
+    };
+
+    // HWCAP_PACA and HWCAP_PACG are set when any of the corresponding fields is non-zero
+    // (QARMA5, implementation defined or QARMA3 algorithm). The algorithm is unknown:
+    // the fields are not set and are reported with an unknown origin. When the bit is
+    // not set, all these fields are known to be zero.
+
+    const HwcapField HwcapFields[] = {
+        {1,  3, CSR_REGID_ID_AA64ISAR0_EL1,  4, 1},  // HWCAP_AES -> AES
+        {1,  4, CSR_REGID_ID_AA64ISAR0_EL1,  4, 2},  // HWCAP_PMULL -> AES
+        {1,  5, CSR_REGID_ID_AA64ISAR0_EL1,  8, 1},  // HWCAP_SHA1 -> SHA1
+        {1,  6, CSR_REGID_ID_AA64ISAR0_EL1, 12, 1},  // HWCAP_SHA2 -> SHA2
+        {1,  7, CSR_REGID_ID_AA64ISAR0_EL1, 16, 1},  // HWCAP_CRC32 -> CRC32
+        {1,  8, CSR_REGID_ID_AA64ISAR0_EL1, 20, 2},  // HWCAP_ATOMICS -> Atomic
+        {1,  9, CSR_REGID_ID_AA64PFR0_EL1,  16, 1},  // HWCAP_FPHP -> FP
+        {1, 10, CSR_REGID_ID_AA64PFR0_EL1,  20, 1},  // HWCAP_ASIMDHP -> AdvSIMD
+        {1, 12, CSR_REGID_ID_AA64ISAR0_EL1, 28, 1},  // HWCAP_ASIMDRDM -> RDM
+        {1, 13, CSR_REGID_ID_AA64ISAR1_EL1, 12, 1},  // HWCAP_JSCVT -> JSCVT
+        {1, 14, CSR_REGID_ID_AA64ISAR1_EL1, 16, 1},  // HWCAP_FCMA -> FCMA
+        {1, 15, CSR_REGID_ID_AA64ISAR1_EL1, 20, 1},  // HWCAP_LRCPC -> LRCPC
+        {1, 16, CSR_REGID_ID_AA64ISAR1_EL1,  0, 1},  // HWCAP_DCPOP -> DPB
+        {1, 17, CSR_REGID_ID_AA64ISAR0_EL1, 32, 1},  // HWCAP_SHA3 -> SHA3
+        {1, 18, CSR_REGID_ID_AA64ISAR0_EL1, 36, 1},  // HWCAP_SM3 -> SM3
+        {1, 19, CSR_REGID_ID_AA64ISAR0_EL1, 40, 1},  // HWCAP_SM4 -> SM4
+        {1, 20, CSR_REGID_ID_AA64ISAR0_EL1, 44, 1},  // HWCAP_ASIMDDP -> DP
+        {1, 21, CSR_REGID_ID_AA64ISAR0_EL1, 12, 2},  // HWCAP_SHA512 -> SHA2
+        {1, 22, CSR_REGID_ID_AA64PFR0_EL1,  32, 1},  // HWCAP_SVE -> SVE
+        {1, 23, CSR_REGID_ID_AA64ISAR0_EL1, 48, 1},  // HWCAP_ASIMDFHM -> FHM
+        {1, 24, CSR_REGID_ID_AA64PFR0_EL1,  48, 1},  // HWCAP_DIT -> DIT
+        {1, 25, CSR_REGID_ID_AA64MMFR2_EL1, 32, 1},  // HWCAP_USCAT -> AT
+        {1, 26, CSR_REGID_ID_AA64ISAR1_EL1, 20, 2},  // HWCAP_ILRCPC -> LRCPC
+        {1, 27, CSR_REGID_ID_AA64ISAR0_EL1, 52, 1},  // HWCAP_FLAGM -> TS
+        {1, 28, CSR_REGID_ID_AA64PFR1_EL1,   4, 2},  // HWCAP_SSBS -> SSBS
+        {1, 29, CSR_REGID_ID_AA64ISAR1_EL1, 36, 1},  // HWCAP_SB -> SB
+        {1, 30, CSR_REGID_ID_AA64ISAR1_EL1,  4, 0},  // HWCAP_PACA -> APA
+        {1, 30, CSR_REGID_ID_AA64ISAR1_EL1,  8, 0},  // HWCAP_PACA -> API
+        {1, 30, CSR_REGID_ID_AA64ISAR2_EL1, 12, 0},  // HWCAP_PACA -> APA3
+        {1, 31, CSR_REGID_ID_AA64ISAR1_EL1, 24, 0},  // HWCAP_PACG -> GPA
+        {1, 31, CSR_REGID_ID_AA64ISAR1_EL1, 28, 0},  // HWCAP_PACG -> GPI
+        {1, 31, CSR_REGID_ID_AA64ISAR2_EL1,  8, 0},  // HWCAP_PACG -> GPA3
+        {1, 32, CSR_REGID_ID_AA64PFR1_EL1,  44, 1},  // HWCAP_GCS -> GCS
+        {2,  0, CSR_REGID_ID_AA64ISAR1_EL1,  0, 2},  // HWCAP2_DCPODP -> DPB
+        {2,  1, CSR_REGID_ID_AA64ZFR0_EL1,   0, 1},  // HWCAP2_SVE2 -> SVEver
+        {2,  2, CSR_REGID_ID_AA64ZFR0_EL1,   4, 1},  // HWCAP2_SVEAES -> AES
+        {2,  3, CSR_REGID_ID_AA64ZFR0_EL1,   4, 2},  // HWCAP2_SVEPMULL -> AES
+        {2,  4, CSR_REGID_ID_AA64ZFR0_EL1,  16, 1},  // HWCAP2_SVEBITPERM -> BitPerm
+        {2,  5, CSR_REGID_ID_AA64ZFR0_EL1,  32, 1},  // HWCAP2_SVESHA3 -> SHA3
+        {2,  6, CSR_REGID_ID_AA64ZFR0_EL1,  40, 1},  // HWCAP2_SVESM4 -> SM4
+        {2,  7, CSR_REGID_ID_AA64ISAR0_EL1, 52, 2},  // HWCAP2_FLAGM2 -> TS
+        {2,  8, CSR_REGID_ID_AA64ISAR1_EL1, 32, 1},  // HWCAP2_FRINT -> FRINTTS
+        {2,  9, CSR_REGID_ID_AA64ZFR0_EL1,  44, 1},  // HWCAP2_SVEI8MM -> I8MM
+        {2, 10, CSR_REGID_ID_AA64ZFR0_EL1,  52, 1},  // HWCAP2_SVEF32MM -> F32MM
+        {2, 11, CSR_REGID_ID_AA64ZFR0_EL1,  56, 1},  // HWCAP2_SVEF64MM -> F64MM
+        {2, 12, CSR_REGID_ID_AA64ZFR0_EL1,  20, 1},  // HWCAP2_SVEBF16 -> BF16
+        {2, 13, CSR_REGID_ID_AA64ISAR1_EL1, 52, 1},  // HWCAP2_I8MM -> I8MM
+        {2, 14, CSR_REGID_ID_AA64ISAR1_EL1, 44, 1},  // HWCAP2_BF16 -> BF16
+        {2, 15, CSR_REGID_ID_AA64ISAR1_EL1, 48, 1},  // HWCAP2_DGH -> DGH
+        {2, 16, CSR_REGID_ID_AA64ISAR0_EL1, 60, 1},  // HWCAP2_RNG -> RNDR
+        {2, 17, CSR_REGID_ID_AA64PFR1_EL1,   0, 1},  // HWCAP2_BTI -> BT
+        {2, 18, CSR_REGID_ID_AA64PFR1_EL1,   8, 2},  // HWCAP2_MTE -> MTE
+        {2, 19, CSR_REGID_ID_AA64MMFR0_EL1, 60, 1},  // HWCAP2_ECV -> ECV
+        {2, 20, CSR_REGID_ID_AA64MMFR1_EL1, 44, 1},  // HWCAP2_AFP -> AFP
+        {2, 21, CSR_REGID_ID_AA64ISAR2_EL1,  4, 1},  // HWCAP2_RPRES -> RPRES
+        {2, 22, CSR_REGID_ID_AA64PFR1_EL1,   8, 3},  // HWCAP2_MTE3 -> MTE
+        {2, 23, CSR_REGID_ID_AA64PFR1_EL1,  24, 1},  // HWCAP2_SME -> SME
+        {2, 31, CSR_REGID_ID_AA64ISAR2_EL1,  0, 2},  // HWCAP2_WFXT -> WFxT
+        {2, 32, CSR_REGID_ID_AA64ISAR1_EL1, 44, 2},  // HWCAP2_EBF16 -> BF16
+        {2, 33, CSR_REGID_ID_AA64ZFR0_EL1,  20, 2},  // HWCAP2_SVE_EBF16 -> BF16
+        {2, 34, CSR_REGID_ID_AA64ISAR2_EL1, 52, 1},  // HWCAP2_CSSC -> CSSC
+        {2, 35, CSR_REGID_ID_AA64ISAR2_EL1, 48, 1},  // HWCAP2_RPRFM -> RPRFM
+        {2, 36, CSR_REGID_ID_AA64ZFR0_EL1,   0, 2},  // HWCAP2_SVE2P1 -> SVEver
+        {2, 43, CSR_REGID_ID_AA64ISAR2_EL1, 16, 1},  // HWCAP2_MOPS -> MOPS
+        {2, 44, CSR_REGID_ID_AA64ISAR2_EL1, 20, 1},  // HWCAP2_HBC -> BC
+        {2, 45, CSR_REGID_ID_AA64ZFR0_EL1,  24, 1},  // HWCAP2_SVE_B16B16 -> B16B16
+        {2, 46, CSR_REGID_ID_AA64ISAR1_EL1, 20, 3},  // HWCAP2_LRCPC3 -> LRCPC
+        {2, 47, CSR_REGID_ID_AA64ISAR0_EL1, 20, 3},  // HWCAP2_LSE128 -> Atomic
+        {3,  0, CSR_REGID_ID_AA64PFR2_EL1,   8, 1},  // HWCAP3_MTE_FAR -> MTEFAR
+        {3,  1, CSR_REGID_ID_AA64PFR2_EL1,   4, 1},  // HWCAP3_MTE_STORE_ONLY -> MTESTOREONLY
+    };
+
+    // Special bits in AT_HWCAP: the FP and AdvSIMD fields are 0xF when not implemented.
+    constexpr int HWCAP_FP_BIT = 0;
+    constexpr int HWCAP_ASIMD_BIT = 1;
+    constexpr int HWCAP_CPUID_BIT = 11;
+}
+
+// Origin of a bit in a register.
+ArmFeatures::Source ArmFeatures::LinuxReport::source(size_t index, int bit) const
+{
+    if (index >= REGISTER_COUNT || bit < 0 || bit > 63) {
+        return Source::NONE;
+    }
+    else if ((hwcap_bits[index] >> bit) & 1) {
+        return Source::HWCAP;
+    }
+    else if ((emulated_bits[index] >> bit) & 1) {
+        return Source::EMULATED;
+    }
+    else {
+        return Source::NONE;
+    }
+}
+
+// Index of a register in _all_registers.
+size_t ArmFeatures::registerIndex(int regid)
+{
+    size_t index = 0;
+    while (index < REGISTER_COUNT && _all_registers[index].regid != regid) {
+        index++;
+    }
+    return index;
+}
+
+// Apply the features from the AT_HWCAPx values.
+void ArmFeatures::applyHwcaps(uint64_t hwcap, uint64_t hwcap2, uint64_t hwcap3, bool raise_only, LinuxReport* report)
+{
+    const uint64_t hwcaps[4] {0, hwcap, hwcap2, hwcap3};
+    for (const auto& hf : HwcapFields) {
+        const size_t index = registerIndex(hf.regid);
+        if (index < REGISTER_COUNT && ((hwcaps[hf.hwcap] >> hf.bit) & 1) != 0 && hf.value == 0) {
+            // Feature present, unknown field value: keep the field, never report it as from AT_HWCAPx.
+            continue;
+        }
+        else if (index < REGISTER_COUNT && ((hwcaps[hf.hwcap] >> hf.bit) & 1) != 0) {
+            csr_u64_t& reg(this->*_all_registers[index].field);
+            const csr_u64_t mask = csr_u64_t(0x0F) << hf.lsb;
+            if (!raise_only || int((reg >> hf.lsb) & 0x0F) < hf.value) {
+                reg = (reg & ~mask) | (csr_u64_t(hf.value) << hf.lsb);
+                if (report != nullptr) {
+                    report->hwcap_bits[index] |= mask;
+                    report->emulated_bits[index] &= ~mask;
+                }
+            }
+        }
+        else if (index < REGISTER_COUNT && !raise_only && report != nullptr) {
+            // Without mrs emulation, the absence of the bit means that the field is zero.
+            report->hwcap_bits[index] |= csr_u64_t(0x0F) << hf.lsb;
+        }
+    }
+    if (!raise_only) {
+        // FP and AdvSIMD are zero when implemented without half-precision, 0xF when not implemented.
+        if (((hwcap >> HWCAP_FP_BIT) & 1) == 0) {
+            _aa64pfr0 |= csr_u64_t(0x0F) << 16;
+        }
+        if (((hwcap >> HWCAP_ASIMD_BIT) & 1) == 0) {
+            _aa64pfr0 |= csr_u64_t(0x0F) << 20;
+        }
+        if (report != nullptr) {
+            report->hwcap_bits[registerIndex(CSR_REGID_ID_AA64PFR0_EL1)] |= csr_u64_t(0xFF) << 16;
+        }
+    }
+}
+
+bool ArmFeatures::loadLinuxSysfs(bool emulate, LinuxReport* report)
+{
+    clear();
+    if (report != nullptr) {
+        *report = LinuxReport();
+    }
+
+#if defined(__linux__)
+
+    // The identification registers of CPU 0 are in sysfs, as text in hexadecimal.
+    if (report != nullptr) {
+        std::ifstream midr("/sys/devices/system/cpu/cpu0/regs/identification/midr_el1");
+        std::ifstream revidr("/sys/devices/system/cpu/cpu0/regs/identification/revidr_el1");
+        midr >> std::hex >> report->midr;
+        revidr >> std::hex >> report->revidr;
+    }
+
+    // No trap, the auxiliary vector is in the process memory.
+    const uint64_t hwcap = ::getauxval(AT_HWCAP);
+    const uint64_t hwcap2 = ::getauxval(AT_HWCAP2);
+    const uint64_t hwcap3 = ::getauxval(AT_HWCAP3);
+
+    if (emulate && ((hwcap >> HWCAP_CPUID_BIT) & 1) != 0) {
+        // One batch of emulated mrs, then restore the fields which are hidden by the emulation.
+        loadDirect();
+        if (report != nullptr) {
+            for (int regid : {CSR_REGID_ID_AA64ISAR0_EL1, CSR_REGID_ID_AA64ISAR1_EL1, CSR_REGID_ID_AA64ISAR2_EL1,
+                              CSR_REGID_ID_AA64ISAR3_EL1, CSR_REGID_ID_AA64PFR0_EL1, CSR_REGID_ID_AA64PFR1_EL1,
+                              CSR_REGID_ID_AA64PFR2_EL1, CSR_REGID_ID_AA64DFR0_EL1, CSR_REGID_ID_AA64DFR1_EL1,
+                              CSR_REGID_ID_AA64DFR2_EL1, CSR_REGID_ID_AA64FPFR0_EL1, CSR_REGID_ID_AA64MMFR0_EL1,
+                              CSR_REGID_ID_AA64MMFR1_EL1, CSR_REGID_ID_AA64MMFR2_EL1, CSR_REGID_ID_AA64MMFR3_EL1,
+                              CSR_REGID_CTR_EL0, CSR_REGID_ID_AA64SMFR0_EL1, CSR_REGID_ID_AA64ZFR0_EL1})
+            {
+                report->emulated_bits[registerIndex(regid)] = ~csr_u64_t(0);
+            }
+        }
+        applyHwcaps(hwcap, hwcap2, hwcap3, true, report);
+    }
+    else {
+        applyHwcaps(hwcap, hwcap2, hwcap3, false, report);
+    }
+    _loaded = true;
+    return true;
+
+#else
+
+    return false;
+
+#endif
+}
@@ -33,6 +33,37 @@ public:
     // macOS: Illegal instruction exception.
     void loadDirect();
 
+    // Raw values of all system registers which define the features, in a fixed order.
+    // Used to save and restore the features, for instance in a binary snapshot file.
+    static constexpr size_t REGISTER_COUNT = 42;
+    void saveRegisters(csr_u64_t values[REGISTER_COUNT]) const;
+    void loadRegisters(const csr_u64_t values[REGISTER_COUNT]);
+
+    // CSR_REGID_ value of a saved register, by index in saveRegisters() and loadRegisters().
+    static int registerId(size_t index) { return index < REGISTER_COUNT ? _all_registers[index].regid : -1; }
+
+    // Origin of the bits in the feature registers, after loadLinuxSysfs().
+    enum class Source {NONE, HWCAP, EMULATED};
+
+    // Report of loadLinuxSysfs(): origin of the register bits, identification of CPU 0.
+    struct LinuxReport {
+        csr_u64_t midr = 0;                          // MIDR_EL1 of CPU 0 from sysfs, zero if unavailable
+        csr_u64_t revidr = 0;                        // REVIDR_EL1 of CPU 0 from sysfs, zero if unavailable
+        csr_u64_t hwcap_bits[REGISTER_COUNT] {};     // bits which are deduced from AT_HWCAPx, by register index
+        csr_u64_t emulated_bits[REGISTER_COUNT] {};  // bits which are read using mrs emulation, by register index
+        Source source(size_t index, int bit) const;
+    };
+
+    // Load features on Linux without the kernel module.
+    // The features are first deduced from AT_HWCAP, AT_HWCAP2, AT_HWCAP3, without trap.
+    // When emulate is true and the kernel emulates mrs, the ID registers are then read
+    // in one batch, like loadDirect(), and the fields which are hidden by the emulation
+    // but reported in AT_HWCAPx are restored. Return false on other systems.
+    // Without emulation, the fields which are not reported in AT_HWCAPx are zero:
+    // use the report to know which fields are actually known (Source::NONE when unknown,
+    // for instance the PAC algorithm fields when HWCAP_PACA or HWCAP_PACG is set).
+    bool loadLinuxSysfs(bool emulate = true, LinuxReport* report = nullptr);
+
     // Individual fields in the system registers.
     // This part of the file is automatically generated by the script aarch/extract-arm-spec.py.
     // Do not remove the markers AUTOGEN-BEGIN and AUTOGEN-END.
@@ -934,4 +965,18 @@ private:
     csr_u64_t _pmsidr = 0;      // @REG: PMSIDR_EL1
     csr_u64_t _mpamidr = 0;     // @REG: MPAMIDR_EL1
     csr_u64_t _trbidr = 0;      // @REG: TRBIDR_EL1
+
+    // All register fields, in the order of saveRegisters() and loadRegisters().
+    struct SavedRegister {
+        csr_u64_t ArmFeatures::* field;
+        int regid;
+    };
+    static const SavedRegister _all_registers[REGISTER_COUNT];
+
+    // Index of a register in _all_registers, REGISTER_COUNT if not found.
+    static size_t registerIndex(int regid);
+
+    // Apply the features from the AT_HWCAPx values. When raise_only is true, a field is
+    // modified only if AT_HWCAPx reports a higher value (restore hidden fields).
+    void applyHwcaps(uint64_t hwcap, uint64_t hwcap2, uint64_t hwcap3, bool raise_only, LinuxReport* report);
 };
@@ -0,0 +1,429 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class to access Arm64 system registers asynchronously.
+//
+//----------------------------------------------------------------------------
+
+#include "asyncregaccess.h"
+#include "strutils.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+
+// The io_uring commands are defined in Linux 5.19 headers. IORING_SETUP_SQE128 only
+// detects these headers: the ring uses 64-byte SQE's, the command payload fits in sqe->cmd.
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #include <linux/io_uring.h>
+    #if defined(IORING_SETUP_SQE128)
+        #define CSR_USE_URING 1
+        #include <unistd.h>
+        #include <fcntl.h>
+        #include <sys/mman.h>
+        #include <sys/syscall.h>
+    #endif
+#endif
+
+// The ioctl() codes are only used with io_uring.
+#if defined(CSR_USE_URING)
+    #define CSR_URING_CMD(cmd) (cmd)
+#else
+    #define CSR_URING_CMD(cmd) 0
+#endif
+
+
+//----------------------------------------------------------------------------
+// Internal state of io_uring.
+//----------------------------------------------------------------------------
+
+#if defined(CSR_USE_URING)
+
+struct AsyncRegAccess::Ring
+{
+    int           dev_fd = -1;        // file descriptor of the kernel module
+    int           ring_fd = -1;       // io_uring file descriptor
+    bool          enabled = false;    // io_uring is used for new requests
+    bool          confirmed = false;  // at least one command succeeded
+    unsigned      sq_entries = 0;     // number of entries in submission queue
+    void*         sq_ptr = nullptr;   // mapped submission queue ring
+    size_t        sq_size = 0;
+    void*         cq_ptr = nullptr;   // mapped completion queue ring
+    size_t        cq_size = 0;
+    io_uring_sqe* sqes = nullptr;     // mapped submission queue entries
+    size_t        sqes_size = 0;
+    unsigned*     sq_head = nullptr;
+    unsigned*     sq_tail = nullptr;
+    unsigned*     sq_mask = nullptr;
+    unsigned*     sq_array = nullptr;
+    unsigned*     cq_head = nullptr;
+    unsigned*     cq_tail = nullptr;
+    unsigned*     cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // Open the device and the ring. Return false if io_uring cannot be used.
+    bool open(size_t depth);
+    ~Ring();
+
+    // Space in the submission queue.
+    unsigned sqSpace() const { return sq_entries - (*sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE)); }
+};
+
+bool AsyncRegAccess::Ring::open(size_t depth)
+{
+    if ((dev_fd = ::open(CSR_DEVICE_PATH, O_RDONLY)) < 0) {
+        return false;
+    }
+
+    io_uring_params params;
+    Zero(&params, sizeof(params));
+    if ((ring_fd = int(::syscall(__NR_io_uring_setup, unsigned(depth), &params))) < 0) {
+        return false;
+    }
+
+    // Check that IORING_OP_URING_CMD is supported by this kernel.
+    const size_t probe_size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    std::unique_ptr<uint8_t[]> probe_data(new uint8_t[probe_size]());
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probe_data.get());
+    if (::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, 256) < 0 ||
+        probe->last_op < IORING_OP_URING_CMD ||
+        (probe->ops[IORING_OP_URING_CMD].flags & IO_URING_OP_SUPPORTED) == 0)
+    {
+        return false;
+    }
+
+    // Map the rings, possibly in one single mapping.
+    sq_entries = params.sq_entries;
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+    sq_ptr = ::mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        sq_ptr = nullptr;
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr = sq_ptr;
+    }
+    else {
+        cq_ptr = ::mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            cq_ptr = nullptr;
+            return false;
+        }
+    }
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* ptr = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    sqes = reinterpret_cast<io_uring_sqe*>(ptr);
+
+    uint8_t* const sq = reinterpret_cast<uint8_t*>(sq_ptr);
+    uint8_t* const cq = reinterpret_cast<uint8_t*>(cq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    enabled = true;
+    return true;
+}
+
+AsyncRegAccess::Ring::~Ring()
+{
+    if (sqes != nullptr) {
+        ::munmap(sqes, sqes_size);
+    }
+    if (cq_ptr != nullptr && cq_ptr != sq_ptr) {
+        ::munmap(cq_ptr, cq_size);
+    }
+    if (sq_ptr != nullptr) {
+        ::munmap(sq_ptr, sq_size);
+    }
+    if (ring_fd >= 0) {
+        ::close(ring_fd);
+    }
+    if (dev_fd >= 0) {
+        ::close(dev_fd);
+    }
+}
+
+#else
+
+// Placeholder on systems without io_uring.
+struct AsyncRegAccess::Ring
+{
+    bool enabled = false;
+    bool confirmed = false;
+};
+
+#endif
+
+
+//----------------------------------------------------------------------------
+// Constructor and destructor.
+//----------------------------------------------------------------------------
+
+AsyncRegAccess::AsyncRegAccess(RegAccess& regaccess, size_t depth) :
+    _regaccess(regaccess),
+    _ring(),
+    _queue(),
+    _inflight()
+{
+#if defined(CSR_USE_URING)
+    _ring.reset(new Ring);
+    if (!_ring->open(std::max<size_t>(depth, 1))) {
+        _ring.reset();
+    }
+#endif
+}
+
+AsyncRegAccess::~AsyncRegAccess()
+{
+    // The requests which were not yet submitted are cancelled. The in-flight requests reference
+    // user data, wait for them before unmapping the rings. The handlers may queue new requests.
+    while (!_queue.empty() || !_inflight.empty()) {
+        while (!_queue.empty()) {
+            Request& req(_queue.front());
+            _inflight.splice(_inflight.end(), _queue, req.self);
+            complete(req, ECANCELED);
+        }
+        if (!_inflight.empty()) {
+            poll(1);
+        }
+    }
+}
+
+bool AsyncRegAccess::isAsync() const
+{
+    return _ring != nullptr && _ring->enabled;
+}
+
+
+//----------------------------------------------------------------------------
+// Queue management.
+//----------------------------------------------------------------------------
+
+AsyncRegAccess::Request& AsyncRegAccess::enqueue()
+{
+    _queue.emplace_back();
+    Request& req(_queue.back());
+    req.self = std::prev(_queue.end());
+    return req;
+}
+
+size_t AsyncRegAccess::complete(Request& req, int error)
+{
+    // Remove the request before invoking the handler, which may queue new requests.
+    Handler handler(std::move(req.handler));
+    _inflight.erase(req.self);
+    if (handler) {
+        handler(error);
+    }
+    return 1;
+}
+
+AsyncRegAccess::Handler AsyncRegAccess::groupHandler(size_t parts, Handler handler)
+{
+    struct Group {
+        size_t  remaining;
+        int     error;
+        Handler handler;
+    };
+    auto group = std::make_shared<Group>(Group{parts, 0, std::move(handler)});
+    return [group](int error) {
+        if (error != 0 && group->error == 0) {
+            group->error = error;
+        }
+        if (--group->remaining == 0 && group->handler) {
+            group->handler(group->error);
+        }
+    };
+}
+
+
+//----------------------------------------------------------------------------
+// Queue requests.
+//----------------------------------------------------------------------------
+
+bool AsyncRegAccess::read(int regid, csr_u64_t& reg, Handler handler)
+{
+    if (!csr_regid_is_single(regid)) {
+        return false;
+    }
+    Request& req(enqueue());
+    req.cmd = CSR_URING_CMD(CSR_IOC_GET_REG(regid));
+    req.param = &reg;
+    req.sync = [this, regid, &reg]() { return _regaccess.read(regid, reg) ? 0 : int(_regaccess.lastError()); };
+    req.handler = std::move(handler);
+    return true;
+}
+
+bool AsyncRegAccess::read(int regid, csr_pair_t& reg, Handler handler)
+{
+    if (csr_regid_is_single(regid)) {
+        reg.high = 0;
+        return read(regid, reg.low, std::move(handler));
+    }
+    if (!csr_regid_is_pair(regid)) {
+        return false;
+    }
+    Request& req(enqueue());
+    req.cmd = CSR_URING_CMD(CSR_IOC_GET_REG2(regid));
+    req.param = &reg;
+    req.sync = [this, regid, &reg]() { return _regaccess.read(regid, reg) ? 0 : int(_regaccess.lastError()); };
+    req.handler = std::move(handler);
+    return true;
+}
+
+bool AsyncRegAccess::readSysRegs(csr_sreg_t* regs, size_t count, Handler handler)
+{
+    if (regs == nullptr || count == 0) {
+        return false;
+    }
+    const size_t parts = (count + CSR_SREG_BATCH_MAX - 1) / CSR_SREG_BATCH_MAX;
+    if (parts > 1) {
+        handler = groupHandler(parts, std::move(handler));
+    }
+    for (size_t first = 0; first < count; first += CSR_SREG_BATCH_MAX) {
+        csr_sreg_t* const base = regs + first;
+        const size_t size = std::min<size_t>(count - first, CSR_SREG_BATCH_MAX);
+        Request& req(enqueue());
+        req.cmd = CSR_URING_CMD(CSR_IOC_GET_SREGS);
+        req.sregs.count = size;
+        req.sregs.entries = csr_u64_t(uintptr_t(base));
+        req.param = &req.sregs;
+        req.sync = [this, base, size]() { return _regaccess.readSysRegs(base, size) ? 0 : int(_regaccess.lastError()); };
+        req.handler = handler;
+    }
+    return true;
+}
+
+bool AsyncRegAccess::executeInstr(int instr, csr_instr_t& args, Handler handler)
+{
+    if (instr == CSR_INSTR_INVALID || instr >= _CSR_INSTR_END) {
+        return false;
+    }
+    Request& req(enqueue());
+    req.cmd = CSR_URING_CMD(CSR_IOC_INSTR(instr));
+    req.param = &args;
+    req.sync = [this, instr, &args]() { return _regaccess.executeInstr(instr, args) ? 0 : int(_regaccess.lastError()); };
+    req.handler = std::move(handler);
+    return true;
+}
+
+bool AsyncRegAccess::executeInstrs(int instr, csr_instr_t* args, size_t count, Handler handler)
+{
+    if (instr == CSR_INSTR_INVALID || instr >= _CSR_INSTR_END || args == nullptr || count == 0) {
+        return false;
+    }
+    const size_t parts = (count + CSR_INSTR_BATCH_MAX - 1) / CSR_INSTR_BATCH_MAX;
+    if (parts > 1) {
+        handler = groupHandler(parts, std::move(handler));
+    }
+    for (size_t first = 0; first < count; first += CSR_INSTR_BATCH_MAX) {
+        csr_instr_t* const base = args + first;
+        const size_t size = std::min<size_t>(count - first, CSR_INSTR_BATCH_MAX);
+        Request& req(enqueue());
+        req.cmd = CSR_URING_CMD(CSR_IOC_INSTRS);
+        req.instrs.instr = csr_u64_t(instr);
+        req.instrs.count = size;
+        req.instrs.entries = csr_u64_t(uintptr_t(base));
+        req.param = &req.instrs;
+        req.sync = [this, instr, base, size]() { return _regaccess.executeInstrs(instr, base, size) ? 0 : int(_regaccess.lastError()); };
+        req.handler = handler;
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Submit queued requests and process completions.
+//----------------------------------------------------------------------------
+
+size_t AsyncRegAccess::poll(size_t min_complete)
+{
+    size_t completed = 0;
+
+    do {
+        // Synchronous execution of the queued requests when io_uring is not used.
+        while (!isAsync() && !_queue.empty()) {
+            Request& req(_queue.front());
+            _inflight.splice(_inflight.end(), _queue, req.self);
+            completed += complete(req, req.sync());
+        }
+
+#if defined(CSR_USE_URING)
+        if (_ring == nullptr || (_queue.empty() && _inflight.empty())) {
+            break;
+        }
+
+        // Fill the submission queue.
+        unsigned submit = 0;
+        unsigned tail = *_ring->sq_tail;
+        for (unsigned space = _ring->sqSpace(); isAsync() && space > 0 && !_queue.empty(); --space) {
+            Request& req(_queue.front());
+            const unsigned index = tail & *_ring->sq_mask;
+            io_uring_sqe* sqe = &_ring->sqes[index];
+            Zero(sqe, sizeof(*sqe));
+            sqe->opcode = IORING_OP_URING_CMD;
+            sqe->fd = _ring->dev_fd;
+            sqe->cmd_op = uint32_t(req.cmd);
+            sqe->user_data = uint64_t(uintptr_t(&req));
+            csr_uring_cmd_t* payload = reinterpret_cast<csr_uring_cmd_t*>(sqe->cmd);
+            payload->param = csr_u64_t(uintptr_t(req.param));
+            payload->reserved = 0;
+            _ring->sq_array[index] = index;
+            _inflight.splice(_inflight.end(), _queue, req.self);
+            tail++;
+            submit++;
+        }
+        __atomic_store_n(_ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+        // Submit and wait for one completion when necessary.
+        const unsigned wait_nr = completed < min_complete && !_inflight.empty() ? 1 : 0;
+        if (submit > 0 || wait_nr > 0) {
+            const long ret = ::syscall(__NR_io_uring_enter, _ring->ring_fd, submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                // The ring is unusable, fail all in-flight requests and revert to ioctl().
+                const int error = errno;
+                _ring->enabled = false;
+                while (!_inflight.empty()) {
+                    completed += complete(_inflight.front(), error);
+                }
+                continue;
+            }
+        }
+
+        // Process all available completions.
+        unsigned head = *_ring->cq_head;
+        while (head != __atomic_load_n(_ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe* cqe = &_ring->cqes[head & *_ring->cq_mask];
+            Request& req(*reinterpret_cast<Request*>(uintptr_t(cqe->user_data)));
+            const int res = cqe->res;
+            __atomic_store_n(_ring->cq_head, ++head, __ATOMIC_RELEASE);
+            if (res == -EOPNOTSUPP && !_ring->confirmed) {
+                // The kernel module does not support uring_cmd, revert to ioctl().
+                _ring->enabled = false;
+                completed += complete(req, req.sync());
+            }
+            else {
+                _ring->confirmed = _ring->confirmed || res >= 0;
+                completed += complete(req, res < 0 ? -res : 0);
+            }
+        }
+#endif
+    } while (completed < min_complete && (!_queue.empty() || !_inflight.empty()));
+
+    return completed;
+}
@@ -0,0 +1,104 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class to access Arm64 system registers asynchronously.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "regaccess.h"
+#include <functional>
+#include <memory>
+#include <list>
+
+//
+// A class to access Arm64 system registers asynchronously.
+//
+// On Linux, the requests are sent to the kernel module as io_uring commands
+// (IORING_OP_URING_CMD, Linux 5.19 and higher). Many requests are submitted and
+// completed in one system call. When io_uring or the uring_cmd interface of the
+// kernel module is not available, the requests are executed using the RegAccess
+// instance (one ioctl() per request). This is always the case on macOS and Windows.
+//
+// The requests are queued and submitted in poll() or wait(). The completion handlers
+// are invoked from poll() or wait(), in the calling thread. A completion handler may
+// queue new requests but must not call poll() or wait(). The data which are referenced
+// by a request must remain valid until its completion. An instance must not be used
+// from several threads at the same time. When the instance is destroyed, the in-flight
+// requests are completed and the requests which were not yet submitted are cancelled
+// (their handlers are invoked with ECANCELED).
+//
+class AsyncRegAccess
+{
+public:
+    // Completion handler. The parameter is a system error code, zero on success.
+    typedef std::function<void(int error)> Handler;
+
+    // Constructor and destructor.
+    // The regaccess instance is used when io_uring is not available.
+    // The depth is the size of the submission queue.
+    AsyncRegAccess(RegAccess& regaccess, size_t depth = 64);
+    ~AsyncRegAccess();
+
+    // Forbid copy.
+    AsyncRegAccess(AsyncRegAccess&&) = delete;
+    AsyncRegAccess(const AsyncRegAccess&) = delete;
+    AsyncRegAccess& operator=(AsyncRegAccess&&) = delete;
+    AsyncRegAccess& operator=(const AsyncRegAccess&) = delete;
+
+    // Check if the requests are currently sent using io_uring.
+    bool isAsync() const;
+
+    // Queue requests, similar to RegAccess methods.
+    // Return false if the request is invalid (the handler is not invoked).
+    // Large batches are split, the handler is invoked once, after the last part.
+    bool read(int regid, csr_u64_t& reg, Handler handler);
+    bool read(int regid, csr_pair_t& reg, Handler handler);
+    bool readSysRegs(csr_sreg_t* regs, size_t count, Handler handler);
+    bool executeInstr(int instr, csr_instr_t& args, Handler handler);
+    bool executeInstrs(int instr, csr_instr_t* args, size_t count, Handler handler);
+
+    // Number of requests which are not yet completed.
+    size_t pending() const { return _queue.size() + _inflight.size(); }
+
+    // Submit queued requests and process completions.
+    // Wait until at least min_complete requests are completed.
+    // Return the number of completed requests.
+    size_t poll(size_t min_complete = 0);
+
+    // Submit queued requests and wait for all completions.
+    size_t wait() { return poll(pending()); }
+
+private:
+    // One queued or in-flight request.
+    struct Request
+    {
+        unsigned long          cmd = 0;        // ioctl() code (Linux)
+        void*                  param = nullptr;// ioctl() argument
+        csr_sreg_batch_t       sregs {};       // ioctl() argument for a batch of registers
+        csr_instr_batch_t      instrs {};      // ioctl() argument for a batch of instructions
+        std::function<int()>   sync {};        // synchronous execution, return an error code
+        Handler                handler {};     // completion handler
+        std::list<Request>::iterator self {};  // position in _queue or _inflight
+    };
+
+    // Internal state of io_uring (Linux only).
+    struct Ring;
+
+    RegAccess&            _regaccess;  // synchronous access
+    std::unique_ptr<Ring> _ring;       // null when io_uring is not used
+    std::list<Request>    _queue;      // requests which are not yet submitted
+    std::list<Request>    _inflight;   // requests which are submitted
+
+    // Add a new request in the queue.
+    Request& enqueue();
+
+    // Create a handler which is shared by the parts of a batch.
+    static Handler groupHandler(size_t parts, Handler handler);
+
+    // Complete a request and remove it. Return 1 (number of completed requests).
+    size_t complete(Request& req, int error);
+};
@@ -0,0 +1,459 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Scan AArch64 ELF files for BTI and PAC: GNU properties, landing pads at
+// the entry of the functions, indirect branch targets without landing pad.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "elffile.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::vector<std::string> inputs;
+    size_t threads;
+    bool list;
+    bool summary;
+    bool verbose;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Syntax: " << command << " [options] path ..." << std::endl
+              << std::endl
+              << "  path : AArch64 ELF file (executable, shared library, object file) or directory," << std::endl
+              << "         recursively searched for ELF files, for instance the root of a system" << std::endl
+              << std::endl
+              << "Check the BTI and PAC properties of ELF files, count the functions which start" << std::endl
+              << "with a landing pad (BTI C, BTI JC, PACIASP, PACIBSP) and find the indirect branch" << std::endl
+              << "targets which have no landing pad. The indirect branch targets are the exported" << std::endl
+              << "functions and the functions with an address in data or computed by ADR, ADRP+ADD." << std::endl
+              << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -l : list the indirect branch targets without landing pad" << std::endl
+              << "  -s : display the summary only" << std::endl
+              << "  -t count : number of scanning threads (default: number of CPU's)" << std::endl
+              << "  -v : verbose, display the scanning throughput" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    inputs(),
+    threads(std::max(1u, std::thread::hardware_concurrency())),
+    list(false),
+    summary(false),
+    verbose(false)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-l") {
+            list = true;
+        }
+        else if (arg == "-s") {
+            summary = true;
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            if ((threads = ::atol(argv[++i])) == 0) {
+                fatal("invalid number of threads");
+            }
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+    if (inputs.empty()) {
+        fatal("no input file, try --help");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Instructions of interest.
+//----------------------------------------------------------------------------
+
+namespace {
+    // BTI {c|j|jc}, in the hint space, bits 7:6 = target type.
+    bool IsBTI(uint32_t insn) { return (insn & 0xFFFFFF3F) == 0xD503241F; }
+    // PACIASP, PACIBSP: implicit BTI C when SCTLR_ELx.BT is zero (Linux).
+    bool IsPACxSP(uint32_t insn) { return insn == 0xD503233F || insn == 0xD503237F; }
+    // Landing pad for a call (BLR) or a branch through x16/x17 (BR from a PLT or a veneer).
+    bool IsCallLandingPad(uint32_t insn) { return insn == 0xD503245F || insn == 0xD50324DF || IsPACxSP(insn); }
+    // BR Xn, except x16/x17: jump tables or computed tail calls, targets need BTI J.
+    bool IsIndirectJump(uint32_t insn) { return (insn & 0xFFFFFC1F) == 0xD61F0000 && ((insn >> 5) & 0x1E) != 16; }
+
+    // ADR, ADRP: immhi in bits 23:5, immlo in bits 30:29, signed.
+    bool IsADR(uint32_t insn) { return (insn & 0x9F000000) == 0x10000000; }
+    bool IsADRP(uint32_t insn) { return (insn & 0x9F000000) == 0x90000000; }
+    int64_t ADRImmediate(uint32_t insn)
+    {
+        const int64_t imm = int64_t(((insn >> 3) & 0x1FFFFC) | ((insn >> 29) & 3));
+        return (imm ^ 0x100000) - 0x100000;
+    }
+    // ADD Xd, Xn, #imm12 (no shift).
+    bool IsADDImmediate(uint32_t insn) { return (insn & 0xFFC00000) == 0x91000000; }
+
+    // General purpose registers which may be written by an instruction, as a bit mask,
+    // conservatively: destination of data processing instructions, transfer registers
+    // of loads and stores, registers which are not preserved by a call (x0-x18, x30).
+    uint32_t WrittenRegisters(uint32_t insn)
+    {
+        if ((insn & 0x1C000000) == 0x10000000 || (insn & 0x0E000000) == 0x0A000000) {
+            return 1u << (insn & 0x1F);  // data processing, immediate or register
+        }
+        else if ((insn & 0x3E000000) == 0x28000000) {
+            return (1u << (insn & 0x1F)) | (1u << ((insn >> 10) & 0x1F));  // pair of registers
+        }
+        else if ((insn & 0x0E000000) == 0x08000000) {
+            return 1u << (insn & 0x1F);  // load or store, not SIMD&FP
+        }
+        else if ((insn & 0xFC000000) == 0x94000000 || (insn & 0xFEFFF000) == 0xD63F0000) {
+            return 0x4007FFFF;  // BL, BLR, BLRAx
+        }
+        else {
+            return 0;
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// An ELF file to scan.
+//----------------------------------------------------------------------------
+
+struct Function {
+    std::string name {};
+    uint64_t    address = 0;  // offset in section in a relocatable file
+    uint32_t    entry = 0;    // first instruction
+    bool        target = false;
+};
+
+class Binary
+{
+public:
+    // Constructor.
+    Binary(const std::string& path, bool explicit_path) : path(path), explicit_path(explicit_path) {}
+
+    const std::string path;
+    const bool explicit_path;      // specified on the command line, not found in a directory
+    bool valid = false;
+    std::string error {};
+    bool has_property = false;     // GNU_PROPERTY_AARCH64_FEATURE_1_AND is present
+    uint32_t property = 0;         // GNU_PROPERTY_AARCH64_FEATURE_1_AND value
+    size_t instructions = 0;       // instruction words in code sections
+    size_t bti = 0;                // BTI instructions, anywhere
+    size_t pacsp = 0;              // PACIASP, PACIBSP, anywhere
+    size_t indirect_jumps = 0;     // BR Xn, except x16/x17
+    size_t functions = 0;
+    size_t entry_bti = 0;          // functions starting with BTI C or BTI JC
+    size_t entry_pacsp = 0;        // functions starting with PACIASP or PACIBSP
+    size_t targets = 0;            // indirect branch targets
+    std::vector<std::string> missing {};  // indirect branch targets without landing pad
+
+    bool isBTI() const { return (property & ElfFile::GNU_PROPERTY_AARCH64_FEATURE_1_BTI) != 0; }
+    bool isPAC() const { return (property & ElfFile::GNU_PROPERTY_AARCH64_FEATURE_1_PAC) != 0; }
+
+    // Open the file, scan it and unmap it. The error is ignored for a file
+    // which was found in a directory and which is not an AArch64 ELF file.
+    void scan();
+
+private:
+    // Mark a function as an indirect branch target, from an address.
+    static void MarkTarget(std::vector<Function>& funcs, uint64_t address);
+};
+
+void Binary::MarkTarget(std::vector<Function>& funcs, uint64_t address)
+{
+    if (!funcs.empty() && address >= funcs.front().address && address <= funcs.back().address) {
+        auto it = std::lower_bound(funcs.begin(), funcs.end(), address, [](const Function& f, uint64_t a) { return f.address < a; });
+        if (it != funcs.end() && it->address == address) {
+            it->target = true;
+        }
+    }
+}
+
+void Binary::scan()
+{
+    ElfFile elf;
+    valid = elf.open(path, error);
+    if (!valid) {
+        if (!explicit_path) {
+            error.clear();
+        }
+        return;
+    }
+    has_property = elf.getProperty(ElfFile::GNU_PROPERTY_AARCH64_FEATURE_1_AND, property);
+
+    // In a relocatable file, the addresses are not resolved, only the global
+    // functions are indirect branch targets.
+    const bool relocatable = elf.type() == ElfFile::ET_REL;
+    const auto& sections(elf.sections());
+
+    // Collect the functions, sorted by address.
+    std::vector<Function> funcs;
+    for (const auto& sym : elf.symbols()) {
+        const ElfFile::Section& sec(sections[sym.section]);
+        const std::string_view code(elf.content(sec));
+        if (sym.isFunction() && sec.isExecutable() && sym.offset + 4 <= code.size()) {
+            Function fn;
+            fn.name = sym.name;
+            fn.address = relocatable ? sym.offset : sec.address + sym.offset;
+            std::memcpy(&fn.entry, code.data() + sym.offset, sizeof(fn.entry));
+            fn.target = relocatable && sym.bind != ElfFile::STB_LOCAL;
+            funcs.push_back(std::move(fn));
+        }
+    }
+    if (!relocatable) {
+        std::sort(funcs.begin(), funcs.end(), [](const Function& f1, const Function& f2) { return f1.address < f2.address; });
+        funcs.erase(std::unique(funcs.begin(), funcs.end(), [](const Function& f1, const Function& f2) { return f1.address == f2.address; }), funcs.end());
+
+        // Exported functions.
+        for (const auto& sym : elf.symbols(true)) {
+            if (sym.isFunction()) {
+                MarkTarget(funcs, sections[sym.section].address + sym.offset);
+            }
+        }
+        // Function addresses in relocations (PIE, shared libraries) and in data (static executables).
+        for (const auto& rel : elf.relocations()) {
+            if (rel.type == ElfFile::R_AARCH64_RELATIVE) {
+                MarkTarget(funcs, uint64_t(rel.addend));
+            }
+        }
+        for (const auto& sec : sections) {
+            if ((sec.flags & ElfFile::SHF_ALLOC) != 0 && !sec.isExecutable() && (sec.address % 8) == 0) {
+                const std::string_view data(elf.content(sec));
+                for (size_t off = 0; off + 8 <= data.size(); off += 8) {
+                    uint64_t value = 0;
+                    std::memcpy(&value, data.data() + off, sizeof(value));
+                    MarkTarget(funcs, value);
+                }
+            }
+        }
+    }
+
+    // Decode all instructions. Addresses which are computed by ADR or ADRP+ADD are indirect branch targets.
+    for (const auto& sec : sections) {
+        if (!sec.isExecutable()) {
+            continue;
+        }
+        const std::string_view code(elf.content(sec));
+        uint64_t pages[32] {};
+        uint32_t valid_pages = 0;  // bit mask of registers with a page address from ADRP
+        auto next_func = std::lower_bound(funcs.begin(), funcs.end(), sec.address, [](const Function& f, uint64_t a) { return f.address < a; });
+        for (size_t off = 0; off + 4 <= code.size(); off += 4) {
+            uint32_t insn = 0;
+            std::memcpy(&insn, code.data() + off, sizeof(insn));
+            instructions++;
+            if (IsBTI(insn)) {
+                bti++;
+            }
+            else if (IsPACxSP(insn)) {
+                pacsp++;
+            }
+            else if (IsIndirectJump(insn)) {
+                indirect_jumps++;
+            }
+            if (relocatable) {
+                continue;
+            }
+            // A page address from ADRP is valid until it is consumed by an ADD, until
+            // the register is written by another instruction, or until the next function.
+            const uint64_t address = sec.address + off;
+            for (; next_func != funcs.end() && next_func->address <= address; ++next_func) {
+                valid_pages = 0;
+            }
+            if (IsADRP(insn)) {
+                pages[insn & 0x1F] = (address & ~uint64_t(0xFFF)) + (ADRImmediate(insn) << 12);
+                valid_pages |= 1u << (insn & 0x1F);
+            }
+            else {
+                if (IsADR(insn)) {
+                    MarkTarget(funcs, address + ADRImmediate(insn));
+                }
+                else if (IsADDImmediate(insn) && (valid_pages & (1u << ((insn >> 5) & 0x1F))) != 0) {
+                    MarkTarget(funcs, pages[(insn >> 5) & 0x1F] + ((insn >> 10) & 0xFFF));
+                    valid_pages &= ~(1u << ((insn >> 5) & 0x1F));
+                }
+                valid_pages &= ~WrittenRegisters(insn);
+            }
+        }
+    }
+
+    // Landing pads at the entry of the functions.
+    functions = funcs.size();
+    for (const auto& fn : funcs) {
+        const bool pad = IsCallLandingPad(fn.entry);
+        entry_bti += IsBTI(fn.entry) && pad;
+        entry_pacsp += IsPACxSP(fn.entry);
+        if (fn.target) {
+            targets++;
+            if (!pad) {
+                missing.push_back(fn.name);
+            }
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Options opt(argc, argv);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Search ELF files.
+    std::vector<std::unique_ptr<Binary>> binaries;
+    for (const auto& path : opt.inputs) {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) {
+            binaries.push_back(std::make_unique<Binary>(path, true));
+            continue;
+        }
+        std::vector<std::string> files;
+        const auto options = fs::directory_options::skip_permission_denied;
+        for (auto it = fs::recursive_directory_iterator(path, options, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && !it->is_symlink(ec) && ElfFile::IsElf(it->path().string())) {
+                files.push_back(it->path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            binaries.push_back(std::make_unique<Binary>(file, false));
+        }
+    }
+
+    // Scan all files in parallel. Each file is unmapped after its scan.
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(opt.threads, binaries.size()); ++i) {
+        threads.emplace_back([&]() {
+            for (size_t n = next++; n < binaries.size(); n = next++) {
+                binaries[n]->scan();
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    // Report in input order.
+    int status = EXIT_SUCCESS;
+    size_t files = 0, bti_files = 0, pac_files = 0, broken_files = 0;
+    size_t instructions = 0, bti = 0, add_bti = 0, add_jumps = 0, add_instructions = 0;
+    for (const auto& bin : binaries) {
+        if (!bin->error.empty()) {
+            std::cerr << opt.command << ": " << bin->error << std::endl;
+            status = EXIT_FAILURE;
+        }
+        if (!bin->valid) {
+            continue;
+        }
+        files++;
+        bti_files += bin->isBTI();
+        pac_files += bin->isPAC();
+        instructions += bin->instructions;
+        bti += bin->bti;
+        if (bin->isBTI()) {
+            // Guarded pages: any missing landing pad is a branch target exception.
+            broken_files += !bin->missing.empty();
+        }
+        else {
+            // Not guarded: one BTI C per target to add when rebuilt with BTI.
+            add_bti += bin->missing.size();
+            add_jumps += bin->indirect_jumps;
+            add_instructions += bin->instructions;
+        }
+        if (!opt.summary) {
+            std::cout << Format("%s: %s, %zu functions, %zu BTI, %zu PACIxSP, %zu indirect targets, %zu without landing pad",
+                                bin->path.c_str(),
+                                !bin->has_property ? "no property" : bin->isBTI() && bin->isPAC() ? "BTI PAC" : bin->isBTI() ? "BTI" : bin->isPAC() ? "PAC" : "none",
+                                bin->functions, bin->entry_bti, bin->entry_pacsp, bin->targets, bin->missing.size())
+                      << std::endl;
+            if (opt.list) {
+                for (const auto& name : bin->missing) {
+                    std::cout << "    " << name << std::endl;
+                }
+            }
+        }
+    }
+
+    // Summary, for the decision of enforcing BTI.
+    const auto percent = [](size_t a, size_t b) { return b == 0 ? 0.0 : 100.0 * double(a) / double(b); };
+    if (!opt.summary && files > 0) {
+        std::cout << std::endl;
+    }
+    std::cout << Format("ELF files: %zu, with BTI property: %zu (%.1f%%), with PAC property: %zu (%.1f%%)",
+                        files, bti_files, percent(bti_files, files), pac_files, percent(pac_files, files)) << std::endl
+              << Format("BTI files with targets without landing pad (fail when BTI is enforced): %zu", broken_files) << std::endl
+              << Format("BTI instructions: %zu in %zu instructions (%.2f%%)", bti, instructions, percent(bti, instructions)) << std::endl
+              << Format("Non-BTI files: estimated %zu BTI C to add in %zu instructions (%.2f%%), plus BTI J at the targets of %zu indirect jumps",
+                        add_bti, add_instructions, percent(add_bti, add_instructions), add_jumps) << std::endl;
+
+    if (opt.verbose) {
+        const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << Format("%s: %zu ELF files, %zu instructions in %.3f s, %.1f M instructions/s", opt.command.c_str(),
+                            files, instructions, sec, sec > 0 ? instructions / sec / 1e6 : 0.0)
+                  << std::endl;
+    }
+    return status;
+}
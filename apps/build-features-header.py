@@ -5,21 +5,25 @@
 # Copyright (c) 2023, Thierry Lelegard
 # BSD-2-Clause license, see the LICENSE file.
 #
-# Build the temporary header files _armfeatures.h and _userfeatures.h.
+# Build the temporary header files _armfeatures.h, _armfeatureids.h and _userfeatures.h.
 #
 #----------------------------------------------------------------------------
 
 import sys, re
 
-if len(sys.argv) != 3:
-    print('Usage: %s in-file out-file' % sys.argv[0], file=sys.stderr)
+# With option --ids, build a list of enumeration identifiers instead of a table.
+ids = len(sys.argv) > 1 and sys.argv[1] == '--ids'
+args = sys.argv[2:] if ids else sys.argv[1:]
+
+if len(args) != 2:
+    print('Usage: %s [--ids] in-file out-file' % sys.argv[0], file=sys.stderr)
     exit(1)
 
 class_name = None
-input_file = sys.argv[1]
-output_file = sys.argv[2]
+input_file = args[0]
+output_file = args[1]
 
-lines = []
+names = []
 with open(input_file, 'r', encoding='utf-8') as input:
     for line in input:
         if class_name is None:
@@ -29,9 +33,12 @@ with open(input_file, 'r', encoding='utf-8') as input:
         else:
             match = re.search(r'^bool\s+(FEAT_[^ (]+)\s*\(\).*$', line.strip())
             if match is not None:
-                lines.append('    {"%s", &%s::%s},' % (match.group(1), class_name, match.group(1)))
+                names.append(match.group(1))
 
-lines.sort(key = lambda x: x.lower())
+names.sort(key = lambda x: x.lower())
 with open(output_file, 'w') as output:
-    for line in lines:
-        print(line, file=output)
+    for name in names:
+        if ids:
+            print('    %s,' % name, file=output)
+        else:
+            print('    {"%s", &%s::%s},' % (name, class_name, name), file=output)
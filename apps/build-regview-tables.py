@@ -0,0 +1,211 @@
+#!/usr/bin/env python
+#----------------------------------------------------------------------------
+#
+# Arm64 CPU system registers tools
+# Copyright (c) 2023, Thierry Lelegard
+# BSD-2-Clause license, see the LICENSE file.
+#
+# Build the temporary header file _regview.h from regview.def.
+#
+# The descriptions of registers, bitfields and values are compiled into
+# flat constexpr arrays. All names are string views into one string pool.
+# A perfect hash table of register names is also generated.
+# The generated file is included in the body of struct RegView::Tables.
+#
+#----------------------------------------------------------------------------
+
+import sys, re
+
+if len(sys.argv) != 3:
+    print('Usage: %s in-file out-file' % sys.argv[0], file=sys.stderr)
+    exit(1)
+
+input_file = sys.argv[1]
+output_file = sys.argv[2]
+
+# Tokens: comments, strings, other lexical elements.
+TOKEN = re.compile(r'//[^\n]*|/\*.*?\*/|"(?:\\.|[^"\\])*"|[A-Za-z_0-9]+|\S', re.DOTALL)
+
+def error(message):
+    print('%s: %s' % (input_file, message), file=sys.stderr)
+    exit(1)
+
+with open(input_file, 'r', encoding='utf-8') as input:
+    tokens = [t for t in TOKEN.findall(input.read()) if not t.startswith('//') and not t.startswith('/*')]
+pos = 0
+
+def peek():
+    return tokens[pos] if pos < len(tokens) else ''
+
+def expect(tok):
+    global pos
+    if peek() != tok:
+        error('expected "%s", got "%s"' % (tok, peek()))
+    pos += 1
+
+# Parse a C++ expression, up to the next comma or closing brace at top level.
+def expression():
+    global pos
+    start = pos
+    depth = 0
+    while pos < len(tokens) and (depth > 0 or tokens[pos] not in (',', '}')):
+        depth += {'(': 1, ')': -1}.get(tokens[pos], 0)
+        pos += 1
+    if pos == start:
+        error('missing expression before "%s"' % peek())
+    return ' '.join(tokens[start:pos]).replace(' ( ', '(').replace(' )', ')')
+
+# Parse a string literal, return its content, with C escape sequences.
+def string():
+    global pos
+    tok = peek()
+    if not tok.startswith('"'):
+        error('expected string, got "%s"' % tok)
+    pos += 1
+    return tok[1:-1]
+
+# Parse a brace-enclosed list of elements, using a parsing function for each element.
+def brace_list(element):
+    items = []
+    expect('{')
+    while peek() != '}':
+        items.append(element())
+        if peek() != ',':
+            break
+        expect(',')
+    expect('}')
+    return items
+
+def value_name():
+    expect('{')
+    value = expression()
+    expect(',')
+    name = string()
+    expect('}')
+    return (value, name)
+
+def bitfield():
+    expect('{')
+    name = string()
+    expect(',')
+    msb = expression()
+    expect(',')
+    lsb = expression()
+    expect(',')
+    values = brace_list(value_name)
+    expect('}')
+    return (name, msb, lsb, values)
+
+def register():
+    expect('{')
+    name = string()
+    expect(',')
+    index = expression()
+    expect(',')
+    features = expression()
+    expect(',')
+    fields = brace_list(bitfield)
+    expect('}')
+    return (name, index, features, fields)
+
+# The input file is a list of registers, without enclosing braces.
+registers = []
+while pos < len(tokens):
+    registers.append(register())
+    if pos < len(tokens):
+        expect(',')
+
+# Build the string pool. Identical strings are stored once. The offsets are
+# computed on the decoded strings, the pool is emitted with the original escapes.
+pool = {}
+pool_size = 0
+pool_lines = []
+def intern(literal):
+    global pool_size
+    if literal not in pool:
+        pool[literal] = (pool_size, len(literal.encode('utf-8').decode('unicode_escape')))
+        pool_size += pool[literal][1]
+        pool_lines.append(literal)
+    return '{Strings + %d, %d}' % pool[literal]
+
+names = []
+fields = []
+regs = []
+for (rname, index, features, rfields) in registers:
+    first_field = len(fields)
+    for (fname, msb, lsb, values) in rfields:
+        first_value = len(names)
+        for (value, vname) in values:
+            names.append('    {%s, %s},' % (value, intern(vname)))
+        vrange = '{Names + %d, %d}' % (first_value, len(values)) if len(values) > 0 else '{}'
+        fields.append('    {%s, %s, %s, %s},' % (intern(fname), msb, lsb, vrange))
+    frange = '{Fields + %d, %d}' % (first_field, len(rfields)) if len(rfields) > 0 else '{}'
+    regs.append('    {%s, %s, %s, %s},' % (intern(rname), index, features, frange))
+
+# Case-insensitive hash of a register name, same as RegView::nameHash().
+def name_hash(seed, name):
+    h = 2166136261 ^ seed
+    for c in name.upper().encode('ascii'):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+# Build a perfect hash table of register names, using "hash and displace".
+# The names are first distributed in buckets using seed 0. Then, starting from
+# the largest buckets, find a seed per bucket which moves all names of the bucket
+# in free slots. Lookup: slot = hash(seeds[hash(0, name) % buckets], name) % slots.
+reg_names = [r[0] for r in registers]
+if len(set(n.upper() for n in reg_names)) != len(reg_names):
+    error('duplicate register names')
+slot_count = max(1, len(reg_names))
+bucket_count = max(1, (len(reg_names) + 3) // 4)
+buckets = [[] for i in range(bucket_count)]
+for i, name in enumerate(reg_names):
+    buckets[name_hash(0, name) % bucket_count].append(i)
+seeds = [0] * bucket_count
+slots = [None] * slot_count
+for b in sorted(range(bucket_count), key=lambda b: -len(buckets[b])):
+    if len(buckets[b]) == 0:
+        break
+    seed = 1
+    while True:
+        bucket_slots = [name_hash(seed, reg_names[i]) % slot_count for i in buckets[b]]
+        if len(set(bucket_slots)) == len(bucket_slots) and all(slots[p] is None for p in bucket_slots):
+            break
+        seed += 1
+    seeds[b] = seed
+    for i, p in zip(buckets[b], bucket_slots):
+        slots[p] = i
+
+# Arrays cannot be empty.
+if len(names) == 0:
+    names.append('    {0, {}},')
+if len(fields) == 0:
+    fields.append('    {{}, 0, 0, {}},')
+
+with open(output_file, 'w') as output:
+    print('// Automatically generated from %s, do not edit.' % input_file, file=output)
+    print('static constexpr char Strings[] =', file=output)
+    line = ''
+    for s in pool_lines:
+        if len(line) + len(s) > 100:
+            print('    "%s"' % line, file=output)
+            line = ''
+        line += s
+    print('    "%s";' % line, file=output)
+    print('static constexpr Name Names[] = {', file=output)
+    print('\n'.join(names), file=output)
+    print('};', file=output)
+    print('static constexpr BitField Fields[] = {', file=output)
+    print('\n'.join(fields), file=output)
+    print('};', file=output)
+    print('static constexpr Register Registers[] = {', file=output)
+    print('\n'.join(regs), file=output)
+    print('};', file=output)
+    print('static constexpr uint32_t NameSeeds[] = {', file=output)
+    for i in range(0, bucket_count, 10):
+        print('    %s,' % ', '.join('%d' % x for x in seeds[i:i+10]), file=output)
+    print('};', file=output)
+    print('static constexpr uint16_t NameSlots[] = {', file=output)
+    for i in range(0, slot_count, 10):
+        print('    %s,' % ', '.join('%d' % (0 if x is None else x) for x in slots[i:i+10]), file=output)
+    print('};', file=output)
@@ -13,48 +13,81 @@
 #include "armfeatures.h"
 #include "armpseudocode.h"
 #include "regview.h"
-#include "strutils.h"
+#include "outbuffer.h"
 
-#include <iostream>
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 
+#define LABEL_WIDTH 20
 #define WIDTH 15
 
 
 //----------------------------------------------------------------------------
-// Formatting functions.
+// Formatting functions: one row of the table, without intermediate string.
 //----------------------------------------------------------------------------
 
-std::string Str(const std::string& s)
+// Number of characters of a decimal value.
+size_t DecimalWidth(int i)
 {
-    return Pad(s, WIDTH, ' ') + " |";
+    size_t width = i < 0 ? 2 : 1;
+    for (unsigned int u = i < 0 ? 0u - unsigned(i) : unsigned(i); u >= 10; u /= 10) {
+        width++;
+    }
+    return width;
+}
+
+// Start a row with its label, end a row after a value of a given width.
+OutBuffer& Row(OutBuffer& out, const char* label)
+{
+    return out.put("| ").pad(label, LABEL_WIDTH, ' ') << " | ";
+}
+
+void EndRow(OutBuffer& out, size_t width)
+{
+    out.put(' ', width < WIDTH ? WIDTH - width : 0) << " |\n";
+}
+
+void Str(OutBuffer& out, const char* label, const char* value = "")
+{
+    Row(out, label) << value;
+    EndRow(out, ::strlen(value));
 }
 
-std::string Bool(bool b)
+void Bool(OutBuffer& out, const char* label, bool b)
 {
-    return Pad(YesNo(b), WIDTH, ' ') + " |";
+    Str(out, label, b ? "yes" : "no");
 }
 
-std::string Bool(bool b1, bool b2)
+void Bool(OutBuffer& out, const char* label, bool b1, bool b2)
 {
-    return Pad(YesNo(b1) + " / " + YesNo(b2), WIDTH, ' ') + " |";
+    Row(out, label) << (b1 ? "yes" : "no") << " / " << (b2 ? "yes" : "no");
+    EndRow(out, (b1 ? 3 : 2) + 3 + (b2 ? 3 : 2));
 }
 
-std::string Int(int i, const char* prefix = "", const char* suffix = "")
+void Int(OutBuffer& out, const char* label, int i, const char* prefix = "", const char* suffix = "")
 {
-    return Pad(Format("%s%d%s", prefix, i, suffix), WIDTH, ' ') + " |";
+    Row(out, label) << prefix;
+    out.decimal(i) << suffix;
+    EndRow(out, ::strlen(prefix) + DecimalWidth(i) + ::strlen(suffix));
 }
 
-std::string PacBits(ArmPseudoCode& code, csr_u64_t address, bool is_instr)
+void PacBits(OutBuffer& out, const char* label, ArmPseudoCode& code, csr_u64_t address, bool is_instr)
 {
-    const int top = code.pacTopBit(address, is_instr);
-    const int bottom = code.pacBottomBit(address, is_instr);
+    int top = code.pacTopBit(address, is_instr);
+    int bottom = code.pacBottomBit(address, is_instr);
+    Row(out, label);
     if (bottom < 55 && 55 < top) {
-        return Str(Format("%d:56,54:%d", top, bottom));
+        out.decimal(top) << ":56,54:";
+        out.decimal(bottom);
+        EndRow(out, DecimalWidth(top) + 7 + DecimalWidth(bottom));
     }
     else {
-        return Str(Format("%d:%d", top == 55 ? 54 : top, bottom == 55 ? 56 : bottom));
+        top = top == 55 ? 54 : top;
+        bottom = bottom == 55 ? 56 : bottom;
+        out.decimal(top) << ":";
+        out.decimal(bottom);
+        EndRow(out, DecimalWidth(top) + 1 + DecimalWidth(bottom));
     }
 }
 
@@ -63,12 +96,12 @@ std::string PacBits(ArmPseudoCode& code, csr_u64_t address, bool is_instr)
 // Check if PAC keys are identical in EL0 and EL1.
 //----------------------------------------------------------------------------
 
-std::string PacKeys(RegAccess& regs, int regid)
+const char* PacKeys(RegAccess& regs, int regid)
 {
     // Check if PAC is implemented.
     ArmFeatures feat(regs);
     if (!feat.FEAT_PAuth()) {
-        return Str("none");
+        return "none";
     }
 
     const csr_u64_t modifier = 47;
@@ -102,7 +135,7 @@ std::string PacKeys(RegAccess& regs, int regid)
 
     // Check if PAC instructions are inactive.
     if (value == value_pac) {
-        return Str("inactive");
+        return "inactive";
     }
 
     // Execute in kernel mode.
@@ -113,7 +146,7 @@ std::string PacKeys(RegAccess& regs, int regid)
 
     // Check if EL0 and EL1 use distinct keys.
     if (value_pac != args.value) {
-        return Str("distinct keys");
+        return "distinct keys";
     }
 
     // Check if we can read the key and non-zero.
@@ -123,7 +156,7 @@ std::string PacKeys(RegAccess& regs, int regid)
         regs.read(regid, key);
         zero = key.high == 0 && key.low == 0;
     }
-    return Str(zero ? "zero" : "same key");
+    return zero ? "zero" : "same key";
 }
 
 
@@ -139,42 +172,43 @@ int main(int argc, char* argv[])
 
     const char* algo = (feat.FEAT_PACQARMA5() ? "QARMA5" : (feat.FEAT_PACQARMA3() ? "QARMA3" : (feat.FEAT_PACIMP() ? "private" : "none")));
 
-    std::cout << "| PAC algorithm        | " << Str(algo) << std::endl
-              << "| PAuth / PAuth2       | " << Bool(feat.FEAT_PAuth(), feat.FEAT_PAuth2()) << std::endl
-              << "| EPAC / FPAC          | " << Bool(feat.FEAT_EPAC(), feat.FEAT_FPAC()) << std::endl
-              << "| MTE tagging          | " << Bool(feat.addressTaggingEnabled()) << std::endl
-              << "|                      | " << Str("") << std::endl
-              << "| **PAC size**         | " << Str("") << std::endl
-              << "| data, lower          | " << Int(code.pacSize(0, false), "", " bits") << std::endl
-              << "| data, upper          | " << Int(code.pacSize(~0ull, false), "", " bits") << std::endl
-              << "| instruction, lower   | " << Int(code.pacSize(0, true), "", " bits") << std::endl
-              << "| instruction, upper   | " << Int(code.pacSize(~0ull, true), "", " bits") << std::endl
-              << "|                      | " << Str("") << std::endl
-              << "| **PAC position**     | " << Str("") << std::endl
-              << "| data, lower          | " << PacBits(code, 0, false) << std::endl
-              << "| data, upper          | " << PacBits(code, ~0ull, false) << std::endl
-              << "| instruction, lower   | " << PacBits(code, 0, true) << std::endl
-              << "| instruction, upper   | " << PacBits(code, ~0ull, true) << std::endl
-              << "|                      | " << Str("") << std::endl
-              << "| **PAC selector bit** | " << Str("") << std::endl
-              << "| data, lower          | " << Int(code.pacSelBit(0, false), "bit ") << std::endl
-              << "| data, upper          | " << Int(code.pacSelBit(~0ull, false), "bit ") << std::endl
-              << "| instruction, lower   | " << Int(code.pacSelBit(0, true), "bit ") << std::endl
-              << "| instruction, upper   | " << Int(code.pacSelBit(~0ull, true), "bit ") << std::endl
-              << "|                      | " << Str("") << std::endl
-              << "| **EL0/EL1 PAC keys** | " << Str("") << std::endl
-              << "| DA                   | " << PacKeys(regs, CSR_REGID2_APDAKEY_EL1) << std::endl
-              << "| DB                   | " << PacKeys(regs, CSR_REGID2_APDBKEY_EL1) << std::endl
-              << "| IA                   | " << PacKeys(regs, CSR_REGID2_APIAKEY_EL1) << std::endl
-              << "| IB                   | " << PacKeys(regs, CSR_REGID2_APIBKEY_EL1) << std::endl
-              << "| Generic (PACGA)      | " << PacKeys(regs, CSR_REGID2_APGAKEY_EL1) << std::endl
-              << "|                      | " << Str("") << std::endl
-              << "| **TCR_EL1 register** | " << Str("") << std::endl
-              << "| TBI0                 | " << Int(feat.TCR_EL1_TBI0()) << std::endl
-              << "| TBID0                | " << Int(feat.TCR_EL1_TBID0()) << std::endl
-              << "| T0SZ                 | " << Int(feat.TCR_EL1_T0SZ()) << std::endl
-              << "| TBI1                 | " << Int(feat.TCR_EL1_TBI1()) << std::endl
-              << "| TBID1                | " << Int(feat.TCR_EL1_TBID1()) << std::endl
-              << "| T1SZ                 | " << Int(feat.TCR_EL1_T1SZ()) << std::endl;
+    OutBuffer out(OutBuffer::STDOUT);
+    Str(out, "PAC algorithm", algo);
+    Bool(out, "PAuth / PAuth2", feat.FEAT_PAuth(), feat.FEAT_PAuth2());
+    Bool(out, "EPAC / FPAC", feat.FEAT_EPAC(), feat.FEAT_FPAC());
+    Bool(out, "MTE tagging", feat.addressTaggingEnabled());
+    Str(out, "");
+    Str(out, "**PAC size**");
+    Int(out, "data, lower", code.pacSize(0, false), "", " bits");
+    Int(out, "data, upper", code.pacSize(~0ull, false), "", " bits");
+    Int(out, "instruction, lower", code.pacSize(0, true), "", " bits");
+    Int(out, "instruction, upper", code.pacSize(~0ull, true), "", " bits");
+    Str(out, "");
+    Str(out, "**PAC position**");
+    PacBits(out, "data, lower", code, 0, false);
+    PacBits(out, "data, upper", code, ~0ull, false);
+    PacBits(out, "instruction, lower", code, 0, true);
+    PacBits(out, "instruction, upper", code, ~0ull, true);
+    Str(out, "");
+    Str(out, "**PAC selector bit**");
+    Int(out, "data, lower", code.pacSelBit(0, false), "bit ");
+    Int(out, "data, upper", code.pacSelBit(~0ull, false), "bit ");
+    Int(out, "instruction, lower", code.pacSelBit(0, true), "bit ");
+    Int(out, "instruction, upper", code.pacSelBit(~0ull, true), "bit ");
+    Str(out, "");
+    Str(out, "**EL0/EL1 PAC keys**");
+    Str(out, "DA", PacKeys(regs, CSR_REGID2_APDAKEY_EL1));
+    Str(out, "DB", PacKeys(regs, CSR_REGID2_APDBKEY_EL1));
+    Str(out, "IA", PacKeys(regs, CSR_REGID2_APIAKEY_EL1));
+    Str(out, "IB", PacKeys(regs, CSR_REGID2_APIBKEY_EL1));
+    Str(out, "Generic (PACGA)", PacKeys(regs, CSR_REGID2_APGAKEY_EL1));
+    Str(out, "");
+    Str(out, "**TCR_EL1 register**");
+    Int(out, "TBI0", feat.TCR_EL1_TBI0());
+    Int(out, "TBID0", feat.TCR_EL1_TBID0());
+    Int(out, "T0SZ", feat.TCR_EL1_T0SZ());
+    Int(out, "TBI1", feat.TCR_EL1_TBI1());
+    Int(out, "TBID1", feat.TCR_EL1_TBID1());
+    Int(out, "T1SZ", feat.TCR_EL1_T1SZ());
     return EXIT_SUCCESS;
 }
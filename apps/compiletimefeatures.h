@@ -0,0 +1,155 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A class describing the Arm64 features which are guaranteed by the
+// compilation target options (-march, -mcpu), without any run time check.
+// This module is independent from the rest of this project.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+//
+// A class describing the Arm64 features which are guaranteed by the
+// compilation target options, as reported by the ACLE __ARM_FEATURE_xxx macros.
+//
+// All methods are constexpr. A feature which is reported here is implemented
+// by all CPU's which can run the binary. Features without ACLE macro are
+// always false. Same names as UserFeatures.
+//
+class CompileTimeFeatures
+{
+public:
+    static constexpr bool FEAT_AES()     { return _aes; }
+    static constexpr bool FEAT_BF16()    { return _bf16; }
+    static constexpr bool FEAT_BTI()     { return _bti; }
+    static constexpr bool FEAT_CRC32()   { return _crc32; }
+    static constexpr bool FEAT_CSV2()    { return false; }
+    static constexpr bool FEAT_CSV3()    { return false; }
+    static constexpr bool FEAT_DIT()     { return false; }
+    static constexpr bool FEAT_DotProd() { return _dotprod; }
+    static constexpr bool FEAT_DPB()     { return false; }
+    static constexpr bool FEAT_DPB2()    { return false; }
+    static constexpr bool FEAT_ECV()     { return false; }
+    static constexpr bool FEAT_FCMA()    { return _fcma; }
+    static constexpr bool FEAT_FHM()     { return _fhm; }
+    static constexpr bool FEAT_FlagM()   { return false; }
+    static constexpr bool FEAT_FlagM2()  { return false; }
+    static constexpr bool FEAT_FP16()    { return _fp16; }
+    static constexpr bool FEAT_FPAC()    { return false; }
+    static constexpr bool FEAT_FRINTTS() { return _frintts; }
+    static constexpr bool FEAT_I8MM()    { return _i8mm; }
+    static constexpr bool FEAT_JSCVT()   { return _jscvt; }
+    static constexpr bool FEAT_LRCPC()   { return _lrcpc; }
+    static constexpr bool FEAT_LRCPC2()  { return _lrcpc2; }
+    static constexpr bool FEAT_LSE()     { return _lse; }
+    static constexpr bool FEAT_LSE2()    { return false; }
+    static constexpr bool FEAT_PAuth()   { return _pauth; }
+    static constexpr bool FEAT_PAuth2()  { return false; }
+    static constexpr bool FEAT_PMULL()   { return _aes; }    // same ACLE macro as AES
+    static constexpr bool FEAT_RDM()     { return _rdm; }
+    static constexpr bool FEAT_SB()      { return false; }
+    static constexpr bool FEAT_SHA1()    { return _sha2; }   // same ACLE macro as SHA-256
+    static constexpr bool FEAT_SHA256()  { return _sha2; }
+    static constexpr bool FEAT_SHA512()  { return _sha512; }
+    static constexpr bool FEAT_SHA3()    { return _sha3; }
+    static constexpr bool FEAT_SPECRES() { return false; }
+    static constexpr bool FEAT_SSBS()    { return false; }
+
+private:
+#if defined(__ARM_FEATURE_AES)
+    static constexpr bool _aes = true;
+#else
+    static constexpr bool _aes = false;
+#endif
+#if defined(__ARM_FEATURE_BF16)
+    static constexpr bool _bf16 = true;
+#else
+    static constexpr bool _bf16 = false;
+#endif
+#if defined(__ARM_FEATURE_BTI)
+    static constexpr bool _bti = true;
+#else
+    static constexpr bool _bti = false;
+#endif
+#if defined(__ARM_FEATURE_CRC32)
+    static constexpr bool _crc32 = true;
+#else
+    static constexpr bool _crc32 = false;
+#endif
+#if defined(__ARM_FEATURE_DOTPROD)
+    static constexpr bool _dotprod = true;
+#else
+    static constexpr bool _dotprod = false;
+#endif
+#if defined(__ARM_FEATURE_COMPLEX)
+    static constexpr bool _fcma = true;
+#else
+    static constexpr bool _fcma = false;
+#endif
+#if defined(__ARM_FEATURE_FP16_FML)
+    static constexpr bool _fhm = true;
+#else
+    static constexpr bool _fhm = false;
+#endif
+#if defined(__ARM_FEATURE_FP16_SCALAR_ARITHMETIC)
+    static constexpr bool _fp16 = true;
+#else
+    static constexpr bool _fp16 = false;
+#endif
+#if defined(__ARM_FEATURE_FRINT)
+    static constexpr bool _frintts = true;
+#else
+    static constexpr bool _frintts = false;
+#endif
+#if defined(__ARM_FEATURE_MATMUL_INT8)
+    static constexpr bool _i8mm = true;
+#else
+    static constexpr bool _i8mm = false;
+#endif
+#if defined(__ARM_FEATURE_JCVT)
+    static constexpr bool _jscvt = true;
+#else
+    static constexpr bool _jscvt = false;
+#endif
+#if defined(__ARM_FEATURE_RCPC)
+    static constexpr bool _lrcpc = true;
+    static constexpr bool _lrcpc2 = __ARM_FEATURE_RCPC >= 2;
+#else
+    static constexpr bool _lrcpc = false;
+    static constexpr bool _lrcpc2 = false;
+#endif
+#if defined(__ARM_FEATURE_ATOMICS)
+    static constexpr bool _lse = true;
+#else
+    static constexpr bool _lse = false;
+#endif
+#if defined(__ARM_FEATURE_PAUTH)
+    static constexpr bool _pauth = true;
+#else
+    static constexpr bool _pauth = false;
+#endif
+#if defined(__ARM_FEATURE_QRDMX)
+    static constexpr bool _rdm = true;
+#else
+    static constexpr bool _rdm = false;
+#endif
+#if defined(__ARM_FEATURE_SHA2)
+    static constexpr bool _sha2 = true;
+#else
+    static constexpr bool _sha2 = false;
+#endif
+#if defined(__ARM_FEATURE_SHA512)
+    static constexpr bool _sha512 = true;
+#else
+    static constexpr bool _sha512 = false;
+#endif
+#if defined(__ARM_FEATURE_SHA3)
+    static constexpr bool _sha3 = true;
+#else
+    static constexpr bool _sha3 = false;
+#endif
+};
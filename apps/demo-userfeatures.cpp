@@ -20,7 +20,7 @@ class Feature
 {
 public:
     std::string name;             // Feature name
-    bool (UserFeatures::*get)();  // Method to get that feature
+    bool (UserFeatures::*get)() const;  // Method to get that feature
 };
 const std::list<Feature> AllUserFeatures {
     // Automatically generated file:
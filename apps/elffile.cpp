@@ -0,0 +1,317 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A minimal reader of AArch64 ELF files, mapped in memory.
+//
+//----------------------------------------------------------------------------
+
+#include "elffile.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+
+//----------------------------------------------------------------------------
+// ELF structures (64-bit, little endian).
+//----------------------------------------------------------------------------
+
+namespace {
+    constexpr uint8_t  ELFCLASS64  = 2;
+    constexpr uint8_t  ELFDATA2LSB = 1;
+    constexpr uint16_t EM_AARCH64  = 183;
+    constexpr uint32_t SHT_SYMTAB  = 2;
+    constexpr uint32_t SHT_RELA    = 4;
+    constexpr uint32_t SHT_NOTE    = 7;
+    constexpr uint32_t SHT_DYNSYM  = 11;
+    constexpr uint16_t SHN_LORESERVE = 0xFF00;
+
+    struct Elf64_Ehdr {
+        uint8_t  e_ident[16];
+        uint16_t e_type;
+        uint16_t e_machine;
+        uint32_t e_version;
+        uint64_t e_entry;
+        uint64_t e_phoff;
+        uint64_t e_shoff;
+        uint32_t e_flags;
+        uint16_t e_ehsize;
+        uint16_t e_phentsize;
+        uint16_t e_phnum;
+        uint16_t e_shentsize;
+        uint16_t e_shnum;
+        uint16_t e_shstrndx;
+    };
+
+    struct Elf64_Shdr {
+        uint32_t sh_name;
+        uint32_t sh_type;
+        uint64_t sh_flags;
+        uint64_t sh_addr;
+        uint64_t sh_offset;
+        uint64_t sh_size;
+        uint32_t sh_link;
+        uint32_t sh_info;
+        uint64_t sh_addralign;
+        uint64_t sh_entsize;
+    };
+
+    struct Elf64_Sym {
+        uint32_t st_name;
+        uint8_t  st_info;
+        uint8_t  st_other;
+        uint16_t st_shndx;
+        uint64_t st_value;
+        uint64_t st_size;
+    };
+
+    struct Elf64_Rela {
+        uint64_t r_offset;
+        uint64_t r_info;
+        int64_t  r_addend;
+    };
+
+    struct Elf64_Nhdr {
+        uint32_t n_namesz;
+        uint32_t n_descsz;
+        uint32_t n_type;
+    };
+
+    // Round up a size to an alignment.
+    uint64_t Align(uint64_t size, uint64_t alignment)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    // Read a structure at some offset in a mapped file. Return false if outside the file.
+    template <typename T>
+    bool Read(std::string_view data, uint64_t offset, T& value)
+    {
+        if (offset > data.size() || data.size() - offset < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return true;
+    }
+
+    // Get a nul-terminated string in a string table.
+    std::string GetString(std::string_view table, uint32_t offset)
+    {
+        if (offset >= table.size()) {
+            return std::string();
+        }
+        const std::string_view str(table.substr(offset));
+        return std::string(str.substr(0, str.find('\0')));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check if a file starts with the ELF magic number.
+//----------------------------------------------------------------------------
+
+bool ElfFile::IsElf(const std::string& filename)
+{
+    char magic[4] {};
+    std::ifstream file(filename, std::ios::binary);
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, "\x7F" "ELF", sizeof(magic)) == 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Open and map an ELF file.
+//----------------------------------------------------------------------------
+
+bool ElfFile::open(const std::string& filename, std::string& error)
+{
+    close();
+    _filename = filename;
+    if (!_file.open(filename, error)) {
+        return false;
+    }
+
+    const std::string_view data(_file.view());
+    Elf64_Ehdr eh;
+    if (!Read(data, 0, eh) || std::memcmp(eh.e_ident, "\x7F" "ELF", 4) != 0) {
+        error = filename + ": not an ELF file";
+        close();
+        return false;
+    }
+    if (eh.e_ident[4] != ELFCLASS64 || eh.e_ident[5] != ELFDATA2LSB || eh.e_machine != EM_AARCH64) {
+        error = filename + ": not an AArch64 ELF file";
+        close();
+        return false;
+    }
+    _type = eh.e_type;
+
+    // Load the section table. Section names are in the section eh.e_shstrndx.
+    std::vector<Elf64_Shdr> headers(eh.e_shnum);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        if (eh.e_shentsize < sizeof(Elf64_Shdr) || !Read(data, eh.e_shoff + i * eh.e_shentsize, headers[i])) {
+            error = filename + ": invalid section table";
+            close();
+            return false;
+        }
+    }
+    std::string_view names;
+    if (eh.e_shstrndx < headers.size()) {
+        const Elf64_Shdr& sh(headers[eh.e_shstrndx]);
+        if (sh.sh_offset <= data.size() && data.size() - sh.sh_offset >= sh.sh_size) {
+            names = data.substr(sh.sh_offset, sh.sh_size);
+        }
+    }
+    _sections.resize(headers.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+        Section& sec(_sections[i]);
+        sec.name = GetString(names, headers[i].sh_name);
+        sec.type = headers[i].sh_type;
+        sec.flags = headers[i].sh_flags;
+        sec.address = headers[i].sh_addr;
+        sec.offset = headers[i].sh_offset;
+        sec.size = headers[i].sh_size;
+        sec.link = headers[i].sh_link;
+        sec.alignment = headers[i].sh_addralign;
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Close the file.
+//----------------------------------------------------------------------------
+
+void ElfFile::close()
+{
+    _file.close();
+    _type = 0;
+    _sections.clear();
+}
+
+
+//----------------------------------------------------------------------------
+// Get the content of a section.
+//----------------------------------------------------------------------------
+
+std::string_view ElfFile::content(const Section& section) const
+{
+    const std::string_view data(_file.view());
+    if (section.type == SHT_NOBITS || section.offset > data.size() || data.size() - section.offset < section.size) {
+        return std::string_view();
+    }
+    return data.substr(section.offset, section.size);
+}
+
+
+//----------------------------------------------------------------------------
+// Get the symbols.
+//----------------------------------------------------------------------------
+
+std::vector<ElfFile::Symbol> ElfFile::symbols(bool dynamic) const
+{
+    // Use the full symbol table when present, the dynamic one otherwise.
+    auto table = dynamic ? _sections.end() : std::find_if(_sections.begin(), _sections.end(), [](const Section& s) { return s.type == SHT_SYMTAB; });
+    if (table == _sections.end()) {
+        table = std::find_if(_sections.begin(), _sections.end(), [](const Section& s) { return s.type == SHT_DYNSYM; });
+    }
+    std::vector<Symbol> symbols;
+    if (table == _sections.end()) {
+        return symbols;
+    }
+
+    const std::string_view strings(table->link < _sections.size() ? content(_sections[table->link]) : std::string_view());
+    const std::string_view syms(content(*table));
+
+    // The first entry is the null symbol.
+    Elf64_Sym st;
+    for (size_t off = sizeof(Elf64_Sym); Read(syms, off, st); off += sizeof(Elf64_Sym)) {
+        if (st.st_shndx == 0 || st.st_shndx >= SHN_LORESERVE || st.st_shndx >= _sections.size()) {
+            continue;  // undefined, absolute or common symbol
+        }
+        Symbol sym;
+        sym.name = GetString(strings, st.st_name);
+        sym.type = st.st_info & 0x0F;
+        sym.bind = st.st_info >> 4;
+        sym.visibility = st.st_other & 0x03;
+        sym.section = st.st_shndx;
+        // In relocatable files, the value is already an offset in the section.
+        sym.offset = _type == ET_REL ? st.st_value : st.st_value - _sections[st.st_shndx].address;
+        sym.size = st.st_size;
+        symbols.push_back(std::move(sym));
+    }
+    std::sort(symbols.begin(), symbols.end(), [](const Symbol& s1, const Symbol& s2) {
+        return s1.section != s2.section ? s1.section < s2.section : s1.offset < s2.offset;
+    });
+    return symbols;
+}
+
+
+//----------------------------------------------------------------------------
+// Get the relocations with addend.
+//----------------------------------------------------------------------------
+
+std::vector<ElfFile::Relocation> ElfFile::relocations() const
+{
+    std::vector<Relocation> relocs;
+    for (const auto& sec : _sections) {
+        if (sec.type == SHT_RELA) {
+            const std::string_view data(content(sec));
+            Elf64_Rela rela;
+            for (size_t off = 0; Read(data, off, rela); off += sizeof(Elf64_Rela)) {
+                relocs.push_back(Relocation{rela.r_offset, uint32_t(rela.r_info), uint32_t(rela.r_info >> 32), rela.r_addend});
+            }
+        }
+    }
+    return relocs;
+}
+
+
+//----------------------------------------------------------------------------
+// Get the notes.
+//----------------------------------------------------------------------------
+
+std::vector<ElfFile::Note> ElfFile::notes() const
+{
+    std::vector<Note> notes;
+    for (const auto& sec : _sections) {
+        if (sec.type == SHT_NOTE) {
+            // Notes are 4-byte aligned, except .note.gnu.property which is 8-byte aligned in ELF64.
+            const uint64_t align = std::max<uint64_t>(4, sec.alignment);
+            const std::string_view data(content(sec));
+            Elf64_Nhdr nh;
+            for (uint64_t off = 0; Read(data, off, nh); ) {
+                const uint64_t name_off = off + sizeof(nh);
+                const uint64_t desc_off = Align(name_off + nh.n_namesz, align);
+                if (desc_off > data.size() || data.size() - desc_off < nh.n_descsz) {
+                    break;
+                }
+                const std::string_view name(data.substr(name_off, nh.n_namesz));
+                notes.push_back(Note{std::string(name.substr(0, name.find('\0'))), nh.n_type, data.substr(desc_off, nh.n_descsz)});
+                off = Align(desc_off + nh.n_descsz, align);
+            }
+        }
+    }
+    return notes;
+}
+
+
+//----------------------------------------------------------------------------
+// Get the value of a 32-bit GNU property.
+//----------------------------------------------------------------------------
+
+bool ElfFile::getProperty(uint32_t type, uint32_t& value) const
+{
+    // A property note contains a list of properties: type, size, data, padded to 8 bytes.
+    for (const auto& note : notes()) {
+        if (note.name == "GNU" && note.type == NT_GNU_PROPERTY_TYPE_0) {
+            uint32_t pr[2];
+            for (uint64_t off = 0; Read(note.description, off, pr); off += 8 + Align(pr[1], 8)) {
+                if (pr[0] == type && pr[1] >= 4 && Read(note.description, off + 8, value)) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
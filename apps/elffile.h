@@ -0,0 +1,131 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A minimal reader of AArch64 ELF files, mapped in memory.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include "mappedfile.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+//
+// A minimal reader of AArch64 ELF files, mapped in memory.
+//
+// Only 64-bit little-endian ELF files for AArch64 are supported: executables,
+// shared libraries, relocatable object files. The ELF structures are defined
+// here, the system <elf.h> is not used because it does not exist on macOS.
+//
+class ElfFile
+{
+public:
+    // ELF constants which are used by the applications.
+    enum : uint32_t {
+        ET_REL        = 1,
+        ET_EXEC       = 2,
+        ET_DYN        = 3,
+        SHT_NOBITS    = 8,
+        SHF_ALLOC     = 0x2,
+        SHF_EXECINSTR = 0x4,
+        STT_NOTYPE    = 0,
+        STT_FUNC      = 2,
+        STT_GNU_IFUNC = 10,
+        STB_LOCAL     = 0,
+        STV_DEFAULT   = 0,
+        R_AARCH64_RELATIVE = 1027,
+        NT_GNU_PROPERTY_TYPE_0 = 5,
+        GNU_PROPERTY_AARCH64_FEATURE_1_AND = 0xC0000000,
+        GNU_PROPERTY_AARCH64_FEATURE_1_BTI = 0x00000001,
+        GNU_PROPERTY_AARCH64_FEATURE_1_PAC = 0x00000002,
+    };
+
+    // Description of a section.
+    struct Section {
+        std::string name {};
+        uint32_t    type = 0;
+        uint64_t    flags = 0;
+        uint64_t    address = 0;
+        uint64_t    offset = 0;  // in file
+        uint64_t    size = 0;
+        uint32_t    link = 0;    // associated section, e.g. string table of a symbol table
+        uint64_t    alignment = 0;
+        bool isExecutable() const { return (flags & SHF_EXECINSTR) != 0 && type != SHT_NOBITS; }
+    };
+
+    // Description of a symbol.
+    struct Symbol {
+        std::string name {};
+        uint8_t     type = STT_NOTYPE;
+        uint8_t     bind = STB_LOCAL;
+        uint8_t     visibility = STV_DEFAULT;
+        uint16_t    section = 0;  // index in sections()
+        uint64_t    offset = 0;   // in section
+        uint64_t    size = 0;
+        bool isFunction() const { return type == STT_FUNC || type == STT_GNU_IFUNC; }
+        bool isCodeMapping() const { return name == "$x" || name.compare(0, 3, "$x.") == 0; }
+        bool isDataMapping() const { return name == "$d" || name.compare(0, 3, "$d.") == 0; }
+    };
+
+    // Description of a relocation, with addend.
+    struct Relocation {
+        uint64_t offset = 0;  // address of the relocated location (offset in section in a relocatable file)
+        uint32_t type = 0;    // R_AARCH64_xxx
+        uint32_t symbol = 0;  // index in the associated symbol table
+        int64_t  addend = 0;
+    };
+
+    // Description of a note.
+    struct Note {
+        std::string      name {};
+        uint32_t         type = 0;
+        std::string_view description {};
+    };
+
+    // Constructor.
+    ElfFile() = default;
+
+    // Open and map an ELF file. Return false on error, with an error message.
+    bool open(const std::string& filename, std::string& error);
+    void close();
+    bool isOpen() const { return _file.isOpen(); }
+
+    // Check if a file starts with the ELF magic number, without mapping it.
+    static bool IsElf(const std::string& filename);
+
+    // Access the file.
+    const std::string& filename() const { return _filename; }
+    uint16_t type() const { return _type; }  // ET_REL, ET_EXEC, ET_DYN...
+    const std::vector<Section>& sections() const { return _sections; }
+
+    // Get the content of a section in the mapped file. Empty for a NOBITS section.
+    std::string_view content(const Section& section) const;
+
+    // Get the symbols, from .symtab when present, from .dynsym otherwise, or
+    // only from .dynsym when dynamic is true (the exported symbols).
+    // The symbols which are not defined in a section are ignored.
+    // The symbols are sorted by section and offset.
+    std::vector<Symbol> symbols(bool dynamic = false) const;
+
+    // Get the relocations with addend from all SHT_RELA sections.
+    std::vector<Relocation> relocations() const;
+
+    // Get the notes from all SHT_NOTE sections.
+    std::vector<Note> notes() const;
+
+    // Get the value of a 32-bit GNU property, such as GNU_PROPERTY_AARCH64_FEATURE_1_AND.
+    // Return false if the property is not present.
+    bool getProperty(uint32_t type, uint32_t& value) const;
+
+private:
+    std::string          _filename {};
+    MappedFile           _file {};
+    uint16_t             _type = 0;
+    std::vector<Section> _sections {};
+};
@@ -0,0 +1,569 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Scan AArch64 ELF files for instructions which require Arm features and
+// report the functions which would fail with SIGILL on the current system
+// or on the systems of a set of snapshots.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include "elffile.h"
+#include "featureset.h"
+#include "insnfeatures.h"
+#include "regsnapshot.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::vector<std::string> inputs;
+    std::vector<std::string> snapshots;
+    size_t threads;
+    bool all;
+    bool verbose;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Syntax: " << command << " [options] path ..." << std::endl
+              << std::endl
+              << "  path : AArch64 ELF file (executable, shared library, object file) or directory," << std::endl
+              << "         recursively searched for ELF files" << std::endl
+              << std::endl
+              << "Report the functions which contain instructions requiring Arm features" << std::endl
+              << "which are not implemented on the current system or, with -s, on the systems" << std::endl
+              << "of the snapshots. These functions would fail with SIGILL, unless they are" << std::endl
+              << "only called after a runtime check of the features." << std::endl
+              << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -a : list all functions which require features, even when available" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -s path : binary snapshot file (.csrsnap), registers file (sysregs -a), or" << std::endl
+              << "       collect/ subdirectory, directories are recursively searched, can be repeated" << std::endl
+              << "  -t count : number of decoding threads (default: number of CPU's)" << std::endl
+              << "  -v : verbose, display the features of the systems and the decoding throughput" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    inputs(),
+    snapshots(),
+    threads(std::max(1u, std::thread::hardware_concurrency())),
+    all(false),
+    verbose(false)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-a") {
+            all = true;
+        }
+        else if (arg == "-s" && i+1 < argc) {
+            snapshots.push_back(argv[++i]);
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            if ((threads = ::atol(argv[++i])) == 0) {
+                fatal("invalid number of threads");
+            }
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+    if (inputs.empty()) {
+        fatal("no input file, try --help");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Target systems: the current one or the snapshots, grouped by feature set.
+//----------------------------------------------------------------------------
+
+struct Target {
+    FeatureSet features {};            // intersection of the features of all CPU's of a system
+    std::vector<std::string> names {}; // systems with these features
+};
+
+class Targets
+{
+public:
+    std::vector<Target> list {};
+
+    // Add the current system. Return false on error, with an error message.
+    bool addCurrentSystem(std::string& error);
+
+    // Add all snapshots in a path. Return false on error, with an error message.
+    bool addPath(const std::string& path, std::string& error);
+
+private:
+    // Add a system with its features.
+    void addSystem(const std::string& name, const FeatureSet& features);
+
+    // Add one snapshot. Return false on error, with an error message.
+    bool addSnapshot(const std::string& path, std::string& error);
+};
+
+void Targets::addSystem(const std::string& name, const FeatureSet& features)
+{
+    for (auto& target : list) {
+        if (target.features == features) {
+            target.names.push_back(name);
+            return;
+        }
+    }
+    list.push_back(Target{features, {name}});
+}
+
+bool Targets::addCurrentSystem(std::string& error)
+{
+    FeatureSet features;
+    if (!features.loadCurrentSystem(error)) {
+        return false;
+    }
+    addSystem("this system", features);
+    return true;
+}
+
+bool Targets::addSnapshot(const std::string& path, std::string& error)
+{
+    // A thread can run on any CPU, use the intersection of the features of all CPU's.
+    FeatureSet features;
+    if (!RegSnapshot::GetFeatures(path, features, error)) {
+        return false;
+    }
+    addSystem(path, features);
+    return true;
+}
+
+bool Targets::addPath(const std::string& path, std::string& error)
+{
+    const std::vector<std::string> files(RegSnapshot::Search(path));
+    if (files.empty()) {
+        error = "no snapshot found in " + path;
+        return false;
+    }
+    for (const auto& file : files) {
+        if (!addSnapshot(file, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// An ELF file to scan, with its functions and its decoding results.
+//----------------------------------------------------------------------------
+
+// A function in an executable section.
+struct Function {
+    std::string name {};
+    uint64_t    offset = 0;  // in section
+    uint64_t    size = 0;
+};
+
+// An instruction which requires a feature, at some offset in a section.
+struct Hit {
+    uint64_t offset = 0;
+    const InstructionFeatures::Encoding* encoding = nullptr;
+};
+
+// An executable section.
+struct CodeSection {
+    size_t index = 0;                                    // in ElfFile::sections()
+    std::vector<Function> functions {};                  // sorted by offset
+    std::vector<std::pair<uint64_t, uint64_t>> data {};  // data ranges ($d mapping symbols), sorted
+};
+
+class Binary
+{
+public:
+    // Constructor.
+    Binary(const std::string& path, bool explicit_path) : path(path), explicit_path(explicit_path) {}
+
+    const std::string path;
+    const bool explicit_path;     // specified on the command line, not found in a directory
+    ElfFile elf {};
+    bool valid = false;
+    std::string error {};
+    std::vector<CodeSection> code {};
+
+    // Open the file and collect the functions. The error is ignored for a file
+    // which was found in a directory and which is not an AArch64 ELF file.
+    void load();
+
+    // Address of an offset in a section, for display.
+    std::string address(const CodeSection& sec, uint64_t offset) const;
+};
+
+void Binary::load()
+{
+    valid = elf.open(path, error);
+    if (!valid) {
+        if (!explicit_path) {
+            error.clear();
+        }
+        return;
+    }
+
+    const auto& sections(elf.sections());
+    for (size_t i = 0; i < sections.size(); ++i) {
+        if (sections[i].isExecutable() && sections[i].size >= 4) {
+            code.push_back(CodeSection());
+            code.back().index = i;
+        }
+    }
+
+    // Symbols are sorted by section and offset.
+    auto sec = code.begin();
+    uint64_t data_start = 0;
+    bool in_data = false;
+    for (const auto& sym : elf.symbols()) {
+        while (sec != code.end() && sec->index < sym.section) {
+            if (in_data) {
+                sec->data.push_back(std::make_pair(data_start, sections[sec->index].size));
+                in_data = false;
+            }
+            ++sec;
+        }
+        if (sec == code.end()) {
+            break;
+        }
+        if (sec->index != sym.section) {
+            continue;
+        }
+        if (sym.isFunction()) {
+            sec->functions.push_back(Function{sym.name, sym.offset, sym.size});
+        }
+        else if (sym.isDataMapping() && !in_data) {
+            data_start = sym.offset;
+            in_data = true;
+        }
+        else if (sym.isCodeMapping() && in_data) {
+            sec->data.push_back(std::make_pair(data_start, sym.offset));
+            in_data = false;
+        }
+    }
+    if (in_data && sec != code.end()) {
+        sec->data.push_back(std::make_pair(data_start, sections[sec->index].size));
+    }
+
+    // Functions without size (assembly code) extend to the next function.
+    // Code without any function symbol is attributed to the section.
+    for (auto& cs : code) {
+        const uint64_t size = sections[cs.index].size;
+        auto& funcs(cs.functions);
+        funcs.erase(std::unique(funcs.begin(), funcs.end(), [](const Function& f1, const Function& f2) { return f1.offset == f2.offset; }), funcs.end());
+        for (size_t i = 0; i < funcs.size(); ++i) {
+            if (funcs[i].size == 0) {
+                funcs[i].size = (i + 1 < funcs.size() ? funcs[i + 1].offset : size) - funcs[i].offset;
+            }
+        }
+        if (funcs.empty() || funcs.front().offset > 0) {
+            funcs.insert(funcs.begin(), Function{"(" + sections[cs.index].name + ")", 0, funcs.empty() ? size : funcs.front().offset});
+        }
+    }
+}
+
+std::string Binary::address(const CodeSection& sec, uint64_t offset) const
+{
+    const ElfFile::Section& s(elf.sections()[sec.index]);
+    if (elf.type() == ElfFile::ET_REL) {
+        return Format("%s+0x%llx", s.name.c_str(), (unsigned long long)offset);
+    }
+    return Format("0x%llx", (unsigned long long)(s.address + offset));
+}
+
+
+//----------------------------------------------------------------------------
+// A chunk of code to decode, the unit of parallel work.
+//----------------------------------------------------------------------------
+
+struct Chunk {
+    Binary*      binary = nullptr;
+    CodeSection* section = nullptr;
+    uint64_t     start = 0;  // offset range in section
+    uint64_t     end = 0;
+    std::vector<Hit> hits {};
+
+    // Decode all instructions in the chunk, skip data ranges.
+    void decode();
+};
+
+// Size of a chunk in bytes, large enough to amortize the scheduling, small
+// enough to balance the load when one file is much larger than the others.
+constexpr uint64_t CHUNK_SIZE = 256 * 1024;
+
+void Chunk::decode()
+{
+    const std::string_view content(binary->elf.content(binary->elf.sections()[section->index]));
+    const auto& data(section->data);
+    auto dr = std::partition_point(data.begin(), data.end(), [this](const std::pair<uint64_t, uint64_t>& r) { return r.second <= start; });
+    for (uint64_t off = start; off + 4 <= end && off + 4 <= content.size(); off += 4) {
+        while (dr != data.end() && dr->second <= off) {
+            ++dr;
+        }
+        if (dr != data.end() && off >= dr->first) {
+            // Skip data, up to the next instruction.
+            off = ((dr->second + 3) & ~uint64_t(3)) - 4;
+            continue;
+        }
+        // ELF files are little endian, like all supported systems.
+        uint32_t insn = 0;
+        std::memcpy(&insn, content.data() + off, sizeof(insn));
+        const InstructionFeatures::Encoding* enc = InstructionFeatures::find(insn);
+        if (enc != nullptr) {
+            hits.push_back(Hit{off, enc});
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Requirements of a function.
+//----------------------------------------------------------------------------
+
+struct FeatureUse {
+    size_t count = 0;                                 // number of instructions
+    uint64_t first = 0;                               // offset of the first one
+    const InstructionFeatures::Encoding* encoding = nullptr;  // first one
+};
+
+struct FunctionReport {
+    const CodeSection* section = nullptr;
+    const Function* function = nullptr;
+    FeatureSet features {};
+    std::map<FeatureId, FeatureUse> uses {};
+};
+
+// Display the functions which require some features.
+void DisplayFunctions(const Binary& bin, const std::vector<FunctionReport>& reports, const FeatureSet& features)
+{
+    for (const auto& rep : reports) {
+        if (!(rep.features & features).empty()) {
+            std::cout << "    " << rep.function->name << " (" << bin.address(*rep.section, rep.function->offset) << ")" << std::endl;
+            (rep.features & features).forEach([&](FeatureId id) {
+                const FeatureUse& use(rep.uses.at(id));
+                std::cout << Format("      %-16s %5zu instructions, first at %s, %s",
+                                    std::string(FeatureSet::name(id)).c_str(), use.count,
+                                    bin.address(*rep.section, use.first).c_str(), use.encoding->name)
+                          << std::endl;
+            });
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Options opt(argc, argv);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Target systems.
+    Targets targets;
+    std::string error;
+    if (opt.snapshots.empty() && !targets.addCurrentSystem(error)) {
+        opt.fatal(error);
+    }
+    for (const auto& path : opt.snapshots) {
+        if (!targets.addPath(path, error)) {
+            opt.fatal(error);
+        }
+    }
+    if (opt.verbose) {
+        for (const auto& target : targets.list) {
+            std::cout << "Systems: " << Join(target.names, ", ") << std::endl
+                      << "  Features: " << target.features.toString() << std::endl;
+        }
+    }
+
+    // Search ELF files. Binary is not movable, because of the mapped file.
+    std::vector<std::unique_ptr<Binary>> binaries;
+    for (const auto& path : opt.inputs) {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) {
+            binaries.push_back(std::make_unique<Binary>(path, true));
+            continue;
+        }
+        std::vector<std::string> files;
+        for (auto it = fs::recursive_directory_iterator(path, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && !it->is_symlink(ec) && ElfFile::IsElf(it->path().string())) {
+                files.push_back(it->path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            binaries.push_back(std::make_unique<Binary>(file, false));
+        }
+    }
+
+    // Run a function in parallel on a number of items.
+    auto parallel = [&opt](size_t count, auto func) {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < std::min(opt.threads, count); ++i) {
+            threads.emplace_back([&]() {
+                for (size_t n = next++; n < count; n = next++) {
+                    func(n);
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    };
+
+    // Load all files in parallel, then decode all chunks of all sections in parallel.
+    parallel(binaries.size(), [&binaries](size_t n) { binaries[n]->load(); });
+    std::vector<Chunk> chunks;
+    size_t bytes = 0;
+    for (auto& bin : binaries) {
+        for (auto& sec : bin->code) {
+            const uint64_t size = bin->elf.sections()[sec.index].size;
+            bytes += size;
+            for (uint64_t off = 0; off < size; off += CHUNK_SIZE) {
+                chunks.push_back(Chunk{bin.get(), &sec, off, std::min(size, off + CHUNK_SIZE)});
+            }
+        }
+    }
+    parallel(chunks.size(), [&chunks](size_t n) { chunks[n].decode(); });
+
+    // Report in input order. Chunks are in file and section order.
+    int status = EXIT_SUCCESS;
+    size_t files = 0;
+    auto chunk = chunks.begin();
+    for (auto& bin : binaries) {
+        if (!bin->error.empty()) {
+            std::cerr << opt.command << ": " << bin->error << std::endl;
+            status = EXIT_FAILURE;
+        }
+        if (!bin->valid) {
+            continue;
+        }
+        files++;
+
+        // Attribute the instructions to functions.
+        std::vector<FunctionReport> reports;
+        FeatureSet required;
+        for (; chunk != chunks.end() && chunk->binary == bin.get(); ++chunk) {
+            const auto& funcs(chunk->section->functions);
+            for (const auto& hit : chunk->hits) {
+                // Last function which starts before the instruction.
+                auto fn = std::upper_bound(funcs.begin(), funcs.end(), hit.offset, [](uint64_t off, const Function& f) { return off < f.offset; });
+                if (fn == funcs.begin() || hit.offset >= std::prev(fn)->offset + std::prev(fn)->size) {
+                    continue;  // outside any function (padding)
+                }
+                --fn;
+                if (reports.empty() || reports.back().function != &*fn) {
+                    reports.push_back(FunctionReport{chunk->section, &*fn});
+                }
+                FunctionReport& rep(reports.back());
+                FeatureUse& use(rep.uses[hit.encoding->feature]);
+                if (use.count++ == 0) {
+                    use.first = hit.offset;
+                    use.encoding = hit.encoding;
+                    rep.features.set(hit.encoding->feature);
+                    required.set(hit.encoding->feature);
+                }
+            }
+        }
+
+        // Functions are reported once per group of systems where some features are missing.
+        bool header = false;
+        auto display_header = [&]() {
+            if (!header) {
+                std::cout << bin->path << ": requires " << (required.empty() ? "no feature" : required.toString()) << std::endl;
+                header = true;
+            }
+        };
+        if (opt.all) {
+            display_header();
+            DisplayFunctions(*bin, reports, required);
+        }
+        std::vector<Target> failures;  // systems grouped by missing features
+        for (const auto& target : targets.list) {
+            const FeatureSet missing(required - target.features);
+            if (!missing.empty()) {
+                auto it = std::find_if(failures.begin(), failures.end(), [&missing](const Target& t) { return t.features == missing; });
+                if (it == failures.end()) {
+                    failures.push_back(Target{missing, {}});
+                    it = failures.end() - 1;
+                }
+                it->names.insert(it->names.end(), target.names.begin(), target.names.end());
+            }
+        }
+        for (const auto& fail : failures) {
+            status = EXIT_FAILURE;
+            display_header();
+            std::cout << "  SIGILL on " << Join(fail.names, ", ") << ", missing " << fail.features.toString() << std::endl;
+            DisplayFunctions(*bin, reports, fail.features);
+        }
+    }
+
+    if (opt.verbose) {
+        const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << Format("%s: %zu ELF files, %zu code bytes in %.3f s, %.1f MB/s", opt.command.c_str(),
+                            files, bytes, sec, sec > 0 ? bytes / sec / 1e6 : 0.0)
+                  << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,180 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A persistent cache of the CPU features of the host, shared by all processes.
+//
+//----------------------------------------------------------------------------
+
+#include "featurecache.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <cerrno>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <unistd.h>
+    #include <fcntl.h>
+#endif
+#if defined(__APPLE__)
+    #include <sys/types.h>
+    #include <sys/sysctl.h>
+#endif
+
+static constexpr char CACHE_MAGIC[8] = {'C', 'S', 'R', 'F', 'E', 'A', 'T', '\0'};
+
+
+//----------------------------------------------------------------------------
+// Path of the cache file.
+//----------------------------------------------------------------------------
+
+std::string FeatureCache::defaultPath()
+{
+    const char* env = ::getenv("CPUSYSREGS_FEATURE_CACHE");
+    if (env != nullptr) {
+        return env;
+    }
+#if defined(__linux__)
+    return "/run/cpusysregs-features.cache";
+#elif defined(__APPLE__)
+    return "/var/run/cpusysregs-features.cache";
+#else
+    return std::string();
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Build the header of the cache file for the current boot.
+//----------------------------------------------------------------------------
+
+#if defined(__linux__)
+// Read a small text file, return the number of characters, zero on error.
+static size_t ReadSmallFile(const char* path, char* buffer, size_t size)
+{
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    const ssize_t len = ::read(fd, buffer, size - 1);
+    ::close(fd);
+    if (len <= 0) {
+        return 0;
+    }
+    buffer[len] = '\0';
+    // Remove trailing new line.
+    size_t end = size_t(len);
+    while (end > 0 && (buffer[end - 1] == '\n' || buffer[end - 1] == '\r')) {
+        buffer[--end] = '\0';
+    }
+    return end;
+}
+#endif
+
+bool FeatureCache::header(Data& data)
+{
+    std::memset(&data, 0, sizeof(data));
+    std::memcpy(data.magic, CACHE_MAGIC, sizeof(data.magic));
+    data.version = VERSION;
+    data.count = ArmFeatures::REGISTER_COUNT;
+    for (size_t i = 0; i < ArmFeatures::REGISTER_COUNT; ++i) {
+        data.regids[i] = uint64_t(ArmFeatures::registerId(i));
+    }
+
+#if defined(__linux__)
+
+    // The MIDR of CPU 0, whatever CPU we run on. Not present in some virtual machines.
+    char midr[32];
+    if (ReadSmallFile("/sys/devices/system/cpu/cpu0/regs/identification/midr_el1", midr, sizeof(midr)) > 0) {
+        data.midr = std::strtoull(midr, nullptr, 16);
+    }
+    return ReadSmallFile("/proc/sys/kernel/random/boot_id", data.boot_id, sizeof(data.boot_id)) > 0;
+
+#elif defined(__APPLE__)
+
+    // No MIDR from userland on macOS, the boot session is enough.
+    size_t len = sizeof(data.boot_id) - 1;
+    return ::sysctlbyname("kern.bootsessionuuid", data.boot_id, &len, nullptr, 0) == 0 && len > 0;
+
+#else
+
+    return false;
+
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Load the features from the cache file.
+//----------------------------------------------------------------------------
+
+bool FeatureCache::load(ArmFeatures& features, const std::string& path)
+{
+    Data current;
+    MappedFile file;
+    std::string error;
+    if (path.empty() || !header(current) || !file.open(path, error) || file.size() != sizeof(Data)) {
+        return false;
+    }
+
+    // The registers follow the header, compare everything before them.
+    const Data* data = reinterpret_cast<const Data*>(file.data());
+    if (std::memcmp(data, &current, offsetof(Data, values)) != 0) {
+        return false;
+    }
+    features.loadRegisters(data->values);
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Save the features in the cache file.
+//----------------------------------------------------------------------------
+
+bool FeatureCache::save(const ArmFeatures& features, const std::string& path)
+{
+    Data data;
+    if (path.empty() || !features.isLoaded() || !header(data)) {
+        return false;
+    }
+    features.saveRegisters(data.values);
+
+#if defined(__linux__) || defined(__APPLE__)
+
+    // Write a temporary file and rename it: concurrent readers never see a partial file.
+    const std::string temp(path + "." + std::to_string(::getpid()));
+    const int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const bool success = ::write(fd, &data, sizeof(data)) == ssize_t(sizeof(data));
+    ::close(fd);
+    if (!success || ::rename(temp.c_str(), path.c_str()) < 0) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+    return true;
+
+#else
+
+    return false;
+
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Remove the cache file.
+//----------------------------------------------------------------------------
+
+bool FeatureCache::remove(const std::string& path)
+{
+#if defined(__linux__) || defined(__APPLE__)
+    return path.empty() || ::unlink(path.c_str()) == 0 || errno == ENOENT;
+#else
+    return true;
+#endif
+}
@@ -0,0 +1,63 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A persistent cache of the CPU features of the host, shared by all processes.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include <string>
+
+//
+// A persistent cache of the CPU features of the host, shared by all processes.
+//
+// The cache file contains the raw values of the registers of ArmFeatures.
+// It is loaded in one mmap(), without access to the kernel module. The cache
+// is valid until the next reboot, it is identified by the boot id of the system
+// and the MIDR of the first CPU (in case of migration of a virtual machine).
+//
+// The default path is /run/cpusysregs-features.cache (/var/run on macOS).
+// It can be changed using the environment variable CPUSYSREGS_FEATURE_CACHE.
+// When this variable is defined but empty, the cache is disabled.
+//
+class FeatureCache
+{
+public:
+    // Path of the cache file. Return an empty string when the cache is disabled.
+    static std::string defaultPath();
+
+    // Load the features from the cache file.
+    // Return false if the cache file does not exist, is invalid, or is from another boot.
+    static bool load(ArmFeatures& features, const std::string& path = defaultPath());
+
+    // Save the features in the cache file. The file is atomically replaced.
+    // Return false if the file cannot be written (typically not root).
+    static bool save(const ArmFeatures& features, const std::string& path = defaultPath());
+
+    // Remove the cache file, when some cached register is modified (e.g. TCR_EL1).
+    // Return false if the file exists and cannot be removed.
+    static bool remove(const std::string& path = defaultPath());
+
+private:
+    // Format version of the cache file.
+    static constexpr uint64_t VERSION = 1;
+
+    // Content of the cache file.
+    struct Data {
+        char      magic[8];
+        uint64_t  version;
+        char      boot_id[48];  // nul-terminated
+        uint64_t  midr;
+        uint64_t  count;        // ArmFeatures::REGISTER_COUNT
+        uint64_t  regids[ArmFeatures::REGISTER_COUNT];
+        csr_u64_t values[ArmFeatures::REGISTER_COUNT];
+    };
+
+    // Build the header of the cache file for the current boot. Return false if not supported.
+    static bool header(Data& data);
+};
@@ -0,0 +1,291 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A set of Arm features, as a dense bitset.
+//
+//----------------------------------------------------------------------------
+
+#include "featureset.h"
+#include "regaccess.h"
+#include <algorithm>
+#include <iterator>
+
+#if defined(__APPLE__)
+    #include <sys/types.h>
+    #include <sys/sysctl.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Descriptions of all Arm features, in FeatureId order.
+//----------------------------------------------------------------------------
+
+namespace {
+    struct Feature {
+        std::string_view name;             // Feature name
+        bool (ArmFeatures::*get)() const;  // Method to get that feature
+    };
+
+    const Feature AllFeatures[] {
+        // Automatically generated file:
+        #include "_armfeatures.h"
+    };
+
+    // Case-insensitive comparison, same order as in build-features-header.py.
+    constexpr char lower(char c) { return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c; }
+    bool LessName(std::string_view s1, std::string_view s2)
+    {
+        return std::lexicographical_compare(s1.begin(), s1.end(), s2.begin(), s2.end(),
+                                            [](char c1, char c2) { return uint8_t(lower(c1)) < uint8_t(lower(c2)); });
+    }
+}
+
+#if defined(__APPLE__)
+namespace {
+    // Legacy sysctl names of some features. Some of them, such as FP, AdvSIMD and CRC32,
+    // have no hw.optional.arm.FEAT_xxx name on any version of macOS.
+    struct LegacySysctl {
+        FeatureId   id;    // Feature
+        const char* name;  // Legacy sysctl name
+    };
+
+    const LegacySysctl LegacySysctls[] {
+        {FeatureId::FEAT_FP,      "hw.optional.floatingpoint"},
+        {FeatureId::FEAT_AdvSIMD, "hw.optional.AdvSIMD"},
+        {FeatureId::FEAT_AdvSIMD, "hw.optional.neon"},
+        {FeatureId::FEAT_CRC32,   "hw.optional.armv8_crc32"},
+        {FeatureId::FEAT_LSE,     "hw.optional.armv8_1_atomics"},
+        {FeatureId::FEAT_FP16,    "hw.optional.neon_fp16"},
+        {FeatureId::FEAT_FHM,     "hw.optional.armv8_2_fhm"},
+        {FeatureId::FEAT_SHA512,  "hw.optional.armv8_2_sha512"},
+        {FeatureId::FEAT_SHA3,    "hw.optional.armv8_2_sha3"},
+        {FeatureId::FEAT_FCMA,    "hw.optional.armv8_3_compnum"},
+    };
+
+    // Get a boolean sysctl, false if it does not exist.
+    bool GetSysctl(const char* name)
+    {
+        int value = 0;
+        size_t len = sizeof(value);
+        return ::sysctlbyname(name, &value, &len, nullptr, 0) == 0 && value != 0;
+    }
+}
+#endif
+
+static_assert(std::size(AllFeatures) == FeatureSet::COUNT, "inconsistent _armfeatures.h and _armfeatureids.h");
+
+
+//----------------------------------------------------------------------------
+// Load, clear, set.
+//----------------------------------------------------------------------------
+
+void FeatureSet::load(const ArmFeatures& features)
+{
+    clear();
+    for (size_t i = 0; i < COUNT; ++i) {
+        if ((features.*AllFeatures[i].get)()) {
+            _bits[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+}
+
+bool FeatureSet::loadSysctl()
+{
+    clear();
+#if defined(__APPLE__)
+    for (size_t i = 0; i < COUNT; ++i) {
+        const std::string name("hw.optional.arm." + std::string(AllFeatures[i].name));
+        if (GetSysctl(name.c_str())) {
+            _bits[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    for (const auto& legacy : LegacySysctls) {
+        if (!has(legacy.id) && GetSysctl(legacy.name)) {
+            set(legacy.id);
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool FeatureSet::loadCurrentSystem(std::string& error, csr_u64_t* midr)
+{
+    // On other systems, mrs at EL0 would trap: the snapshots of the system must be used instead.
+    ArmFeatures feat;
+    ArmFeatures::LinuxReport report;
+    csr_u64_t value = 0;
+    RegAccess regaccess(false, false);
+    if (regaccess.isOpen()) {
+        feat.load(regaccess);
+        regaccess.read(CSR_REGID_MIDR_EL1, value);
+        load(feat);
+    }
+    else if (feat.loadLinuxSysfs(true, &report)) {
+        value = report.midr;
+        load(feat);
+    }
+    else if (!loadSysctl()) {
+        error = "cannot get the features of this system, load the kernel module or specify snapshots";
+        return false;
+    }
+    if (midr != nullptr) {
+        *midr = value;
+    }
+    return true;
+}
+
+void FeatureSet::clear()
+{
+    std::fill(std::begin(_bits), std::end(_bits), 0);
+}
+
+void FeatureSet::set(FeatureId id, bool value)
+{
+    const uint64_t mask = uint64_t(1) << (size_t(id) % 64);
+    if (value) {
+        _bits[size_t(id) / 64] |= mask;
+    }
+    else {
+        _bits[size_t(id) / 64] &= ~mask;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Set operations.
+//----------------------------------------------------------------------------
+
+size_t FeatureSet::count() const
+{
+    size_t total = 0;
+    for (uint64_t w : _bits) {
+        for (; w != 0; w &= w - 1) {
+            total++;
+        }
+    }
+    return total;
+}
+
+bool FeatureSet::includes(const FeatureSet& other) const
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        if ((other._bits[i] & ~_bits[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FeatureSet& FeatureSet::operator&=(const FeatureSet& other)
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        _bits[i] &= other._bits[i];
+    }
+    return *this;
+}
+
+FeatureSet& FeatureSet::operator|=(const FeatureSet& other)
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        _bits[i] |= other._bits[i];
+    }
+    return *this;
+}
+
+FeatureSet& FeatureSet::operator-=(const FeatureSet& other)
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        _bits[i] &= ~other._bits[i];
+    }
+    return *this;
+}
+
+FeatureSet& FeatureSet::operator^=(const FeatureSet& other)
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        _bits[i] ^= other._bits[i];
+    }
+    return *this;
+}
+
+bool FeatureSet::operator==(const FeatureSet& other) const
+{
+    return std::equal(std::begin(_bits), std::end(_bits), std::begin(other._bits));
+}
+
+
+//----------------------------------------------------------------------------
+// Feature names.
+//----------------------------------------------------------------------------
+
+std::string_view FeatureSet::name(FeatureId id)
+{
+    return size_t(id) < COUNT ? AllFeatures[size_t(id)].name : std::string_view();
+}
+
+bool FeatureSet::find(std::string_view name, FeatureId& id)
+{
+    // The table is sorted by name, case insensitive.
+    const auto it = std::lower_bound(std::begin(AllFeatures), std::end(AllFeatures), name,
+                                     [](const Feature& f, std::string_view n) { return LessName(f.name, n); });
+    if (it == std::end(AllFeatures) || LessName(name, it->name)) {
+        return false;
+    }
+    id = FeatureId(it - std::begin(AllFeatures));
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Serialization and hash.
+//----------------------------------------------------------------------------
+
+std::string FeatureSet::toString(const std::string& separator) const
+{
+    std::string str;
+    forEach([&](FeatureId id) {
+        if (!str.empty()) {
+            str.append(separator);
+        }
+        str.append(name(id));
+    });
+    return str;
+}
+
+bool FeatureSet::fromString(std::string_view list, std::string& error)
+{
+    clear();
+    error.clear();
+    size_t pos = 0;
+    while ((pos = list.find_first_not_of(" ,\t\r\n", pos)) != std::string_view::npos) {
+        const size_t end = std::min(list.size(), list.find_first_of(" ,\t\r\n", pos));
+        const std::string_view feat_name(list.substr(pos, end - pos));
+        FeatureId id;
+        if (find(feat_name, id)) {
+            set(id);
+        }
+        else {
+            error.append(error.empty() ? "unknown features: " : ", ").append(feat_name);
+        }
+        pos = end;
+    }
+    return error.empty();
+}
+
+uint64_t FeatureSet::hash() const
+{
+    // Each name is followed by a nul character, to separate names.
+    uint64_t hash = 14695981039346656037ull;
+    forEach([&](FeatureId id) {
+        for (char c : name(id)) {
+            hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+        }
+        hash *= 1099511628211ull;
+    });
+    return hash;
+}
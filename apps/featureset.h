@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A set of Arm features, as a dense bitset.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+//
+// Identifiers of all FEAT_xxx predicates in ArmFeatures, sorted by name (case insensitive).
+// The values may change when features are added, they must not be stored. Use the names.
+//
+enum class FeatureId : uint16_t {
+    // Automatically generated file:
+    #include "_armfeatureids.h"
+    COUNT
+};
+
+//
+// A set of Arm features, as a dense bitset indexed by FeatureId.
+//
+// The FEAT_xxx predicates of ArmFeatures are evaluated once, when the set is
+// loaded. Then, testing a feature and operations on sets are done on bitmaps.
+//
+class FeatureSet
+{
+public:
+    // Number of known features.
+    static constexpr size_t COUNT = size_t(FeatureId::COUNT);
+
+    // Constructors.
+    FeatureSet() = default;
+    explicit FeatureSet(const ArmFeatures& features) { load(features); }
+
+    // Evaluate all FEAT_xxx predicates from an ArmFeatures instance.
+    void load(const ArmFeatures& features);
+
+    // On macOS, load the features of the current system from the sysctl hw.optional.arm.FEAT_xxx
+    // or their legacy names (hw.optional.floatingpoint, etc.), without trap. The features without
+    // sysctl are absent. Return false on other systems.
+    bool loadSysctl();
+
+    // Load the features of the current system, without trap: from the kernel module when
+    // available, else from the auxiliary vector on Linux, else from the sysctl on macOS.
+    // When midr is not null, it receives MIDR_EL1, zero when unknown (always on macOS).
+    // Return false when none is available, with an error message.
+    bool loadCurrentSystem(std::string& error, csr_u64_t* midr = nullptr);
+
+    // Clear, test, set a feature.
+    void clear();
+    bool has(FeatureId id) const { return (_bits[size_t(id) / 64] >> (size_t(id) % 64)) & 1; }
+    void set(FeatureId id, bool value = true);
+
+    // Number of features in the set.
+    size_t count() const;
+    bool empty() const { return count() == 0; }
+
+    // Check if all features of another set are also in this set.
+    bool includes(const FeatureSet& other) const;
+
+    // Set operations: intersection, union, difference, symmetric difference.
+    FeatureSet& operator&=(const FeatureSet& other);
+    FeatureSet& operator|=(const FeatureSet& other);
+    FeatureSet& operator-=(const FeatureSet& other);
+    FeatureSet& operator^=(const FeatureSet& other);
+    FeatureSet operator&(const FeatureSet& other) const { return FeatureSet(*this) &= other; }
+    FeatureSet operator|(const FeatureSet& other) const { return FeatureSet(*this) |= other; }
+    FeatureSet operator-(const FeatureSet& other) const { return FeatureSet(*this) -= other; }
+    FeatureSet operator^(const FeatureSet& other) const { return FeatureSet(*this) ^= other; }
+    bool operator==(const FeatureSet& other) const;
+    bool operator!=(const FeatureSet& other) const { return !operator==(other); }
+
+    // Call a function with the identifier of each feature in the set, in identifier order.
+    template <class FUNC>
+    void forEach(FUNC func) const;
+
+    // Name of a feature, e.g. "FEAT_PAuth".
+    static std::string_view name(FeatureId id);
+
+    // Find a feature by name (case insensitive). Return false if not found.
+    static bool find(std::string_view name, FeatureId& id);
+
+    // Serialize the set as a list of feature names. The serialized form and the hash
+    // only depend on the names of the features, they are stable across versions.
+    std::string toString(const std::string& separator = " ") const;
+
+    // Load a list of feature names, separated by spaces or commas.
+    // Unknown names are ignored. Return false if there are unknown names, with an error message.
+    bool fromString(std::string_view list, std::string& error);
+
+    // 64-bit hash of the set (FNV-1a of the names of the features).
+    uint64_t hash() const;
+
+private:
+    static constexpr size_t WORDS = (COUNT + 63) / 64;
+    uint64_t _bits[WORDS] {};
+};
+
+// Template definitions.
+template <class FUNC>
+void FeatureSet::forEach(FUNC func) const
+{
+    for (size_t i = 0; i < WORDS; ++i) {
+        for (uint64_t w = _bits[i]; w != 0; w &= w - 1) {
+            size_t bit = 0;
+            while (((w >> bit) & 1) == 0) {
+                bit++;
+            }
+            func(FeatureId(64 * i + bit));
+        }
+    }
+}
@@ -0,0 +1,685 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Index register snapshots from a fleet of hosts and query their features.
+// The snapshots are loaded in parallel in a columnar store, with one column
+// per register and one bitmap per Arm feature.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include "featureset.h"
+#include "regcolumns.h"
+#include "regsnapshot.h"
+#include "regview.h"
+#include "snapfile.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::vector<std::string> inputs;
+    std::vector<std::string> queries;
+    std::string group_by;
+    size_t threads;
+    bool list_hosts;
+    bool verbose;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Syntax: " << command << " [options] path ..." << std::endl
+              << std::endl
+              << "  path : binary snapshot file (sysregs --save), registers file (sysregs -a -v),"  << std::endl
+              << "         or directory, recursively searched for snapshots and collect/ subdirectories" << std::endl
+              << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -g key : group matching hosts by midr, kernel, host, FEAT_xxx, REG or REG.FIELD" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -l : list matching hosts" << std::endl
+              << "  -q query : select hosts, can be repeated (default: all hosts)" << std::endl
+              << "  -t count : number of loading threads (default: number of CPU's)" << std::endl
+              << "  -v : verbose, display loading and query times" << std::endl
+              << std::endl
+              << "A query is a list of space-separated terms, all of them must be true:" << std::endl
+              << std::endl
+              << "  FEAT_xxx : the feature is present, !FEAT_xxx : the feature is absent" << std::endl
+              << "  REG.FIELD<op>value, REG<op>value, midr<op>value : compare a value," << std::endl
+              << "  where <op> is one of = != < <= > >=" << std::endl
+              << std::endl
+              << "Example: " << command << " -q 'FEAT_PAuth2 !FEAT_FPAC' -g midr collect" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    inputs(),
+    queries(),
+    group_by(),
+    threads(std::max(1u, std::thread::hardware_concurrency())),
+    list_hosts(false),
+    verbose(false)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-g" && i+1 < argc) {
+            group_by = argv[++i];
+        }
+        else if (arg == "-l") {
+            list_hosts = true;
+        }
+        else if (arg == "-q" && i+1 < argc) {
+            queries.push_back(argv[++i]);
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            if ((threads = ::atol(argv[++i])) == 0) {
+                fatal("invalid number of threads");
+            }
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+    if (inputs.empty()) {
+        fatal("no input specified, try --help");
+    }
+    if (queries.empty()) {
+        queries.push_back("");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// A bitmap with one bit per host.
+//----------------------------------------------------------------------------
+
+class Bitmap
+{
+public:
+    Bitmap(size_t size = 0, bool value = false) { resize(size, value); }
+
+    void resize(size_t size, bool value = false);
+    size_t size() const { return _size; }
+
+    bool test(size_t index) const { return (_words[index / 64] >> (index % 64)) & 1; }
+    void set(size_t index, bool value = true);
+
+    // Bitwise operations, the two bitmaps must have the same size.
+    Bitmap& operator&=(const Bitmap&);
+    Bitmap& andNot(const Bitmap&);
+
+    // Number of bits which are set.
+    size_t count() const;
+
+    // Call a function with the index of each bit which is set.
+    template <class FUNC>
+    void forEach(FUNC func) const;
+
+private:
+    std::vector<uint64_t> _words {};
+    size_t _size = 0;
+};
+
+void Bitmap::resize(size_t size, bool value)
+{
+    // Unused bits in the last word are always zero.
+    for (size_t i = _size; i < size && i < 64 * _words.size(); ++i) {
+        set(i, value);
+    }
+    _words.resize((size + 63) / 64, value ? ~uint64_t(0) : 0);
+    _size = size;
+    if (size % 64 != 0) {
+        _words.back() &= (uint64_t(1) << (size % 64)) - 1;
+    }
+}
+
+void Bitmap::set(size_t index, bool value)
+{
+    if (value) {
+        _words[index / 64] |= uint64_t(1) << (index % 64);
+    }
+    else {
+        _words[index / 64] &= ~(uint64_t(1) << (index % 64));
+    }
+}
+
+Bitmap& Bitmap::operator&=(const Bitmap& other)
+{
+    for (size_t i = 0; i < _words.size(); ++i) {
+        _words[i] &= other._words[i];
+    }
+    return *this;
+}
+
+Bitmap& Bitmap::andNot(const Bitmap& other)
+{
+    for (size_t i = 0; i < _words.size(); ++i) {
+        _words[i] &= ~other._words[i];
+    }
+    return *this;
+}
+
+size_t Bitmap::count() const
+{
+    size_t total = 0;
+    for (uint64_t w : _words) {
+        for (; w != 0; w &= w - 1) {
+            total++;
+        }
+    }
+    return total;
+}
+
+template <class FUNC>
+void Bitmap::forEach(FUNC func) const
+{
+    for (size_t i = 0; i < _words.size(); ++i) {
+        for (uint64_t w = _words[i]; w != 0; w &= w - 1) {
+            size_t bit = 0;
+            while (((w >> bit) & 1) == 0) {
+                bit++;
+            }
+            func(64 * i + bit);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// A dictionary of strings, each distinct string is encoded as an integer.
+//----------------------------------------------------------------------------
+
+class Dictionary
+{
+public:
+    uint32_t encode(const std::string& value);
+    const std::string& decode(uint32_t code) const { return _values[code]; }
+    size_t size() const { return _values.size(); }
+
+private:
+    std::map<std::string, uint32_t> _codes {};
+    std::vector<std::string> _values {};
+};
+
+uint32_t Dictionary::encode(const std::string& value)
+{
+    const auto it = _codes.find(value);
+    if (it != _codes.end()) {
+        return it->second;
+    }
+    const uint32_t code = uint32_t(_values.size());
+    _codes[value] = code;
+    _values.push_back(value);
+    return code;
+}
+
+
+//----------------------------------------------------------------------------
+// Load one host snapshot.
+//----------------------------------------------------------------------------
+
+// Description of a host, as loaded from a snapshot.
+class Host
+{
+public:
+    std::string source {};             // snapshot file or directory
+    std::string name {};               // host name
+    std::string kernel {};             // kernel or operating system version
+    std::string error {};              // loading error, if any
+    csr_u64_t midr = 0;                // MIDR_EL1 of the first CPU
+    RegSnapshot registers {};          // registers of the first CPU
+    FeatureSet features {};            // features of the host
+
+    // Load the host snapshot. Return false on error.
+    bool load();
+};
+
+bool Host::load()
+{
+    std::error_code ec;
+    const std::string filename(RegSnapshot::FileName(source));
+    const bool is_dir = fs::is_directory(source, ec);
+
+    // Load registers and features. In a binary snapshot of several CPU's,
+    // a feature is present if it is present on all CPU's.
+    SnapFile file;
+    std::string ignored;
+    if (file.open(filename, ignored)) {
+        registers.load(file);
+        name = file.header().host;
+        kernel = file.header().kernel;
+        midr = file.header().midr;
+        file.getFeatures(features);
+    }
+    else if (registers.loadText(filename, error)) {
+        csr_pair_t reg {0, 0};
+        registers.get(CSR_REGID_MIDR_EL1, reg);
+        midr = reg.low;
+        ArmFeatures feat;
+        registers.getFeatures(feat);
+        features.load(feat);
+    }
+    else {
+        return false;
+    }
+    if (registers.size() == 0) {
+        error = "no register found in " + filename;
+        return false;
+    }
+
+    // In collect/ subdirectories, the host is anonymized, use the directory name.
+    // The kernel version is in the first section of cpusysregs-system.txt.
+    if (name.empty()) {
+        name = is_dir ? fs::path(source).filename().string() : fs::path(source).stem().string();
+    }
+    if (kernel.empty()) {
+        std::ifstream in(fs::path(filename).parent_path() / "cpusysregs-system.txt");
+        std::string line;
+        bool underline = false;
+        while (std::getline(in, line) && !(underline && !line.empty())) {
+            underline = underline || line.find("---") == 0;
+        }
+        kernel = underline ? line : "unknown";
+    }
+    return true;
+}
+
+// Search all host snapshots in a path.
+void SearchHosts(const std::string& path, std::vector<Host>& hosts)
+{
+    // A collect/ subdirectory is one host, other binary snapshot files (.csrsnap) are individual hosts.
+    for (const auto& source : RegSnapshot::Search(path)) {
+        hosts.emplace_back();
+        hosts.back().source = source;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Columnar store of all hosts.
+//----------------------------------------------------------------------------
+
+class FleetIndex
+{
+public:
+    FleetIndex();
+
+    // Add a host in the index.
+    void add(const Host& host);
+
+    // Number of hosts in the index.
+    size_t size() const { return _midr.size(); }
+
+    // Evaluate a query, return the bitmap of matching hosts. Return false on invalid query.
+    bool query(const std::string& query, Bitmap& result, std::string& error) const;
+
+    // Get the grouping key of a host. Return false on invalid key.
+    bool groupKey(const std::string& key, size_t host, std::string& value) const;
+
+    // Source and name of a host.
+    const std::string& source(size_t host) const { return _source[host]; }
+    const std::string& name(size_t host) const { return _names.decode(_name[host]); }
+
+private:
+    // Host metadata.
+    std::vector<std::string> _source {};
+    Dictionary               _names {};
+    Dictionary               _kernels {};
+    std::vector<uint32_t>    _name {};
+    std::vector<uint32_t>    _kernel {};
+    std::vector<csr_u64_t>   _midr {};
+
+    // One column per register (in RegView::AllRegisters order), one bitmap per feature.
+    std::vector<std::vector<csr_u64_t>> _regs;
+    std::vector<Bitmap>                 _reg_present;
+    std::vector<Bitmap>                 _features;
+
+    // Comparison operators in queries.
+    enum Operator {EQ, NE, LT, LE, GT, GE};
+    static bool compare(csr_u64_t value, Operator op, csr_u64_t ref);
+
+    // Locate a register or register field in the form REG or REG.FIELD.
+    static bool findField(const std::string& name, size_t& reg_index, const RegView::BitField*& field);
+
+    // Evaluate one query term.
+    bool term(const std::string& term, Bitmap& result, std::string& error) const;
+};
+
+FleetIndex::FleetIndex() :
+    _regs(RegView::AllRegisters.size()),
+    _reg_present(RegView::AllRegisters.size()),
+    _features(FeatureSet::COUNT)
+{
+}
+
+void FleetIndex::add(const Host& host)
+{
+    const size_t index = size();
+    _source.push_back(host.source);
+    _name.push_back(_names.encode(host.name));
+    _kernel.push_back(_kernels.encode(host.kernel));
+    _midr.push_back(host.midr);
+
+    size_t reg_index = 0;
+    for (const auto& desc : RegView::AllRegisters) {
+        csr_pair_t reg {0, 0};
+        const bool present = host.registers.get(desc.csr_index, reg);
+        _regs[reg_index].push_back(reg.low);
+        _reg_present[reg_index].resize(index + 1);
+        _reg_present[reg_index].set(index, present);
+        reg_index++;
+    }
+    for (size_t i = 0; i < _features.size(); ++i) {
+        _features[i].resize(index + 1);
+        _features[i].set(index, host.features.has(FeatureId(i)));
+    }
+}
+
+bool FleetIndex::compare(csr_u64_t value, Operator op, csr_u64_t ref)
+{
+    switch (op) {
+        case EQ: return value == ref;
+        case NE: return value != ref;
+        case LT: return value < ref;
+        case LE: return value <= ref;
+        case GT: return value > ref;
+        case GE: return value >= ref;
+        default: return false;
+    }
+}
+
+bool FleetIndex::findField(const std::string& name, size_t& reg_index, const RegView::BitField*& field)
+{
+    const size_t dot = name.find('.');
+    const auto& desc(RegView::getRegister(name.substr(0, dot)));
+    if (!desc.isValid()) {
+        return false;
+    }
+    reg_index = size_t(&desc - RegView::AllRegisters.begin());
+    field = nullptr;
+    if (dot == std::string::npos) {
+        return true;
+    }
+    const std::string field_name(ToUpper(name.substr(dot + 1)));
+    for (const auto& bf : desc.fields) {
+        if (ToUpper(std::string(bf.name)) == field_name) {
+            field = &bf;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FleetIndex::term(const std::string& term, Bitmap& result, std::string& error) const
+{
+    // Feature presence or absence, using the bitmap index.
+    const bool negate = !term.empty() && term[0] == '!';
+    FeatureId feat;
+    if (FeatureSet::find(term.substr(negate ? 1 : 0), feat)) {
+        if (negate) {
+            result.andNot(_features[size_t(feat)]);
+        }
+        else {
+            result &= _features[size_t(feat)];
+        }
+        return true;
+    }
+
+    // Comparison of a value: name<op>value.
+    static const std::pair<const char*, Operator> operators[] {
+        {"!=", NE}, {"<=", LE}, {">=", GE}, {"=", EQ}, {"<", LT}, {">", GT},
+    };
+    size_t pos = std::string::npos, len = 0;
+    Operator op = EQ;
+    for (const auto& o : operators) {
+        const size_t p = term.find(o.first);
+        if (p != std::string::npos && p < pos) {
+            pos = p;
+            len = ::strlen(o.first);
+            op = o.second;
+        }
+    }
+    if (pos == std::string::npos || pos == 0) {
+        error = "invalid query term '" + term + "'";
+        return false;
+    }
+    const std::string name(term.substr(0, pos));
+    const std::string value_str(term.substr(pos + len));
+    char* end = nullptr;
+    const csr_u64_t ref = ::strtoull(value_str.c_str(), &end, 0);
+    if (value_str.empty() || *end != '\0') {
+        error = "invalid value in '" + term + "'";
+        return false;
+    }
+
+    // Full scan of the selected column, only for hosts which are still selected.
+    Bitmap scan(result);
+    if (ToLower(name) == "midr") {
+        scan.forEach([&](size_t host) { result.set(host, compare(_midr[host], op, ref)); });
+        return true;
+    }
+    size_t reg_index = 0;
+    const RegView::BitField* field = nullptr;
+    if (!findField(name, reg_index, field)) {
+        error = "unknown feature, register or field '" + name + "'";
+        return false;
+    }
+    // Extract the bitfield from the whole column at once.
+    const RegView::Register& desc(RegView::AllRegisters.begin()[reg_index]);
+    const csr_u64_t* column = _regs[reg_index].data();
+    std::vector<csr_u64_t> decoded;
+    if (field != nullptr) {
+        const RegColumns columns(desc);
+        decoded.resize(size());
+        RegColumns::extract(columns.extractor(size_t(field - desc.fields.begin())), column, nullptr, size(), decoded.data());
+        column = decoded.data();
+    }
+    const Bitmap& present(_reg_present[reg_index]);
+    scan.forEach([&](size_t host) {
+        result.set(host, present.test(host) && compare(column[host], op, ref));
+    });
+    return true;
+}
+
+bool FleetIndex::query(const std::string& query, Bitmap& result, std::string& error) const
+{
+    result.resize(0);
+    result.resize(size(), true);
+    size_t start = 0;
+    while ((start = query.find_first_not_of(" \t,", start)) != std::string::npos) {
+        size_t end = query.find_first_of(" \t,", start);
+        if (end == std::string::npos) {
+            end = query.size();
+        }
+        if (!term(query.substr(start, end - start), result, error)) {
+            return false;
+        }
+        start = end;
+    }
+    return true;
+}
+
+bool FleetIndex::groupKey(const std::string& key, size_t host, std::string& value) const
+{
+    const std::string lkey(ToLower(key));
+    if (lkey == "midr") {
+        value = Format("0x%08llX", (unsigned long long)(_midr[host]));
+        return true;
+    }
+    if (lkey == "kernel") {
+        value = _kernels.decode(_kernel[host]);
+        return true;
+    }
+    if (lkey == "host") {
+        value = _names.decode(_name[host]);
+        return true;
+    }
+    FeatureId feat;
+    if (FeatureSet::find(key, feat)) {
+        value = YesNo(_features[size_t(feat)].test(host));
+        return true;
+    }
+    size_t reg_index = 0;
+    const RegView::BitField* field = nullptr;
+    if (!findField(key, reg_index, field)) {
+        return false;
+    }
+    if (!_reg_present[reg_index].test(host)) {
+        value = "absent";
+    }
+    else if (field == nullptr) {
+        value = ToHexa(_regs[reg_index][host]);
+    }
+    else {
+        value = field->valueName(field->get(csr_pair_t {_regs[reg_index][host], 0}));
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point.
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const auto start = std::chrono::steady_clock::now();
+
+    // Find all snapshots.
+    std::vector<Host> hosts;
+    for (const auto& path : opt.inputs) {
+        SearchHosts(path, hosts);
+    }
+    std::sort(hosts.begin(), hosts.end(), [](const Host& h1, const Host& h2) { return h1.source < h2.source; });
+
+    // Load all snapshots in parallel.
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(opt.threads, hosts.size()); ++i) {
+        threads.emplace_back([&]() {
+            for (size_t h = next++; h < hosts.size(); h = next++) {
+                hosts[h].load();
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    // Build the columnar store, in input order.
+    FleetIndex index;
+    for (const auto& host : hosts) {
+        if (host.error.empty()) {
+            index.add(host);
+        }
+        else {
+            std::cerr << opt.command << ": " << host.error << std::endl;
+        }
+    }
+    hosts.clear();
+    if (opt.verbose) {
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << Format("%s: loaded %zu hosts in %.3f ms", opt.command.c_str(), index.size(), ms) << std::endl;
+    }
+
+    // Execute all queries.
+    for (const auto& query : opt.queries) {
+        const auto qstart = std::chrono::steady_clock::now();
+        Bitmap result;
+        std::string error;
+        if (!index.query(query, result, error)) {
+            opt.fatal(error);
+        }
+
+        // Group hosts by key value.
+        std::map<std::string, size_t> groups;
+        std::string value;
+        bool valid = true;
+        if (!opt.group_by.empty()) {
+            result.forEach([&](size_t host) {
+                valid = valid && index.groupKey(opt.group_by, host, value);
+                groups[value]++;
+            });
+        }
+        if (!valid) {
+            opt.fatal("invalid grouping key " + opt.group_by);
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - qstart).count();
+
+        std::cout << "Query: " << (query.empty() ? "all" : query) << std::endl
+                  << "Matching hosts: " << result.count() << " / " << index.size();
+        if (opt.verbose) {
+            std::cout << Format(" (%.3f ms)", ms);
+        }
+        std::cout << std::endl;
+        if (!groups.empty()) {
+            std::vector<std::pair<std::string, size_t>> sorted(groups.begin(), groups.end());
+            std::stable_sort(sorted.begin(), sorted.end(), [](const auto& g1, const auto& g2) { return g1.second > g2.second; });
+            std::cout << std::endl << Pad("Count", 8, ' ', false) << "  " << opt.group_by << std::endl;
+            for (const auto& g : sorted) {
+                std::cout << Pad(std::to_string(g.second), 8, ' ', false) << "  " << g.first << std::endl;
+            }
+        }
+        if (opt.list_hosts) {
+            std::cout << std::endl;
+            result.forEach([&](size_t host) { std::cout << index.name(host) << "  (" << index.source(host) << ")" << std::endl; });
+        }
+        std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,682 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Arm features which are required by AArch64 instructions.
+//
+//----------------------------------------------------------------------------
+
+#include "insnfeatures.h"
+#include <iterator>
+#include <vector>
+
+#define F(name) FeatureId::FEAT_##name
+#define NONE    FeatureId::COUNT
+
+
+//----------------------------------------------------------------------------
+// Encoding groups, first match wins. More specific groups come first,
+// including groups without requirement which are excluded from larger ones.
+//----------------------------------------------------------------------------
+
+static constexpr InstructionFeatures::Encoding EncodingTable[] = {
+
+    // Data processing, register.
+    {0x7FE0E000, 0x1AC04000, F(CRC32),       "CRC32"},
+    {0xFFFF8000, 0xDAC10000, F(PAuth),       "PACxx/AUTxx/XPACx"},
+    {0xFFE0FC00, 0x9AC03000, F(PAuth),       "PACGA"},
+    {0xFFE0FC00, 0x9AC01000, F(MTE),         "IRG"},
+    {0xFFE0FC00, 0x9AC01400, F(MTE),         "GMI"},
+    {0xDFE0FC00, 0x9AC00000, F(MTE),         "SUBP"},
+    {0x7FFFF800, 0x5AC01800, F(CSSC),        "CTZ/CNT"},
+    {0x7FFFFC00, 0x5AC02000, F(CSSC),        "ABS"},
+    {0x7FE0F000, 0x1AC06000, F(CSSC),        "SMAX/SMIN/UMAX/UMIN"},
+    {0x7FF00000, 0x11C00000, F(CSSC),        "SMAX/SMIN/UMAX/UMIN (immediate)"},
+    {0xBFC0C000, 0x91800000, F(MTE),         "ADDG/SUBG"},
+    {0xFFE07C10, 0xBA000400, F(FlagM),       "RMIF"},
+    {0xFFFFBC1F, 0x3A00080D, F(FlagM),       "SETF8/SETF16"},
+
+    // Branches, exception generation, system instructions.
+    {0xFF000010, 0x54000010, F(HBC),         "BC.cond"},
+    {0xFE1FF800, 0xD61F0800, F(PAuth),       "BRAx/BLRAx/RETAx/ERETAx"},
+    {0xFFFFFFFF, 0xD500401F, F(FlagM),       "CFINV"},
+    {0xFFFFFFFF, 0xD500405F, F(FlagM2),      "AXFLAG"},
+    {0xFFFFFFFF, 0xD500403F, F(FlagM2),      "XAFLAG"},
+    {0xFFFFFEFF, 0xD503403F, F(SSBS),        "MSR SSBS"},
+    {0xFFFFFEFF, 0xD503427F, F(SME),         "SMSTART/SMSTOP"},
+    {0xFFFFFCFF, 0xD503447F, F(SME),         "SMSTART/SMSTOP"},
+    {0xFFFFFFFF, 0xD50330FF, F(SB),          "SB"},
+    {0xFFFFFFE0, 0xD5031000, F(WFxT),        "WFET"},
+    {0xFFFFFFE0, 0xD5031020, F(WFxT),        "WFIT"},
+    {0xFFFFFFE0, 0xD5233060, F(TME),         "TSTART"},
+    {0xFFFFFFE0, 0xD5233160, F(TME),         "TTEST"},
+    {0xFFFFFFFF, 0xD503307F, F(TME),         "TCOMMIT"},
+    {0xFFE0001F, 0xD4600000, F(TME),         "TCANCEL"},
+    {0xFFFFFFE0, 0xD50B7C20, F(DPB),         "DC CVAP"},
+    {0xFFFFFFE0, 0xD50B7D20, F(DPB2),        "DC CVADP"},
+    {0xFFFFFFE0, 0xD50B7380, F(SPECRES),     "CFP RCTX"},
+    {0xFFFFFFE0, 0xD50B73A0, F(SPECRES),     "DVP RCTX"},
+    {0xFFFFFFE0, 0xD50B73E0, F(SPECRES),     "CPP RCTX"},
+    {0xFFFFFFE0, 0xD50B7460, F(MTE),         "DC GVA"},
+    {0xFFFFFFE0, 0xD50B7480, F(MTE),         "DC GZVA"},
+    {0xFFFFFFE0, 0xD53B2400, F(RNG),         "MRS RNDR"},
+    {0xFFFFFFE0, 0xD53B2420, F(RNG),         "MRS RNDRRS"},
+    {0xFFDFFFE0, 0xD51B42C0, F(SSBS),        "MRS/MSR SSBS"},
+
+    // Loads and stores.
+    {0xFFFFFC00, 0xF83F9000, F(LS64),        "ST64B"},
+    {0xFFFFFC00, 0xF83FD000, F(LS64),        "LD64B"},
+    {0xFFE0FC00, 0xF820B000, F(LS64),        "ST64BV"},
+    {0xFFE0FC00, 0xF820A000, F(LS64),        "ST64BV0"},
+    {0x3FFFFC00, 0x38BFC000, F(LRCPC),       "LDAPR"},
+    {0x3F200C00, 0x38200000, F(LSE),         "LDADD/LDCLR/LDEOR/LDSET/LDxMAX/LDxMIN/SWP"},
+    {0x3FA07C00, 0x08A07C00, F(LSE),         "CAS"},
+    {0xBFA07C00, 0x08207C00, F(LSE),         "CASP"},
+    {0x3FBFFC00, 0x089F7C00, F(LOR),         "LDLAR/STLLR"},
+    {0x3F200C00, 0x19000000, F(LRCPC2),      "LDAPUR/STLUR"},
+    {0x3B200C00, 0x19000400, F(MOPS),        "CPYx/SETx"},
+    {0xFF200400, 0xF8200400, F(PAuth),       "LDRAA/LDRAB"},
+    {0xFF200000, 0xD9200000, F(MTE),         "STG/LDG/STZG/ST2G/STGP"},
+    {0xFFC00000, 0x69000000, F(MTE),         "STGP"},
+    {0xFFC00000, 0x68800000, F(MTE),         "STGP"},
+    {0xFFC00000, 0x69800000, F(MTE),         "STGP"},
+
+    // Cryptographic extensions.
+    {0xFFFFCC00, 0x4E284800, F(AES),         "AESE/AESD/AESMC/AESIMC"},
+    {0xBFE0FC00, 0x0EE0E000, F(PMULL),       "PMULL (64-bit)"},
+    {0xFFE0CC00, 0x5E000000, F(SHA1),        "SHA1C/SHA1P/SHA1M/SHA1SU0"},
+    {0xFFE0CC00, 0x5E004000, F(SHA256),      "SHA256H/SHA256H2/SHA256SU1"},
+    {0xFFFFFC00, 0x5E280800, F(SHA1),        "SHA1H"},
+    {0xFFFFFC00, 0x5E281800, F(SHA1),        "SHA1SU1"},
+    {0xFFFFFC00, 0x5E282800, F(SHA256),      "SHA256SU0"},
+    {0xFFE0FC00, 0xCE608C00, F(SHA3),        "RAX1"},
+    {0xFFE0F000, 0xCE608000, F(SHA512),      "SHA512H/SHA512H2/SHA512SU1"},
+    {0xFFFFFC00, 0xCEC08000, F(SHA512),      "SHA512SU0"},
+    {0xFFE08000, 0xCE000000, F(SHA3),        "EOR3"},
+    {0xFFE08000, 0xCE200000, F(SHA3),        "BCAX"},
+    {0xFFE00000, 0xCE800000, F(SHA3),        "XAR"},
+    {0xFFE08000, 0xCE400000, F(SM3),         "SM3SS1"},
+    {0xFFE0C000, 0xCE408000, F(SM3),         "SM3TT1A/SM3TT1B/SM3TT2A/SM3TT2B"},
+    {0xFFE0F800, 0xCE60C000, F(SM3),         "SM3PARTW1/SM3PARTW2"},
+    {0xFFE0FC00, 0xCE60C800, F(SM4),         "SM4EKEY"},
+    {0xFFFFFC00, 0xCEC08400, F(SM4),         "SM4E"},
+
+    // Floating point, scalar. FCVT from and to half precision is Armv8.0.
+    {0xFFFE7C00, 0x1EE24000, NONE,           "FCVT (from half-precision)"},
+    {0xFF3FFC00, 0x1E23C000, NONE,           "FCVT (to half-precision)"},
+    {0xFFFFFC00, 0x1E7E0000, F(JSCVT),       "FJCVTZS"},
+    {0xFFFFFC00, 0x1E634000, F(BF16),        "BFCVT"},
+    {0xFFBE7C00, 0x1E284000, F(FRINTTS),     "FRINT32x/FRINT64x"},
+    {0x7FE00000, 0x1EE00000, F(FP16),        "FP half-precision"},
+    {0x7FE00000, 0x1EC00000, F(FP16),        "SCVTF/UCVTF/FCVTZS/FCVTZU (half-precision, scalar, fixed-point)"},
+    {0xFFC00000, 0x1FC00000, F(FP16),        "FMADD/FMSUB/FNMADD/FNMSUB (half-precision)"},
+
+    // Advanced SIMD.
+    {0xBF20F400, 0x2E008400, F(RDM),         "SQRDMLAH/SQRDMLSH (vector)"},
+    {0xFF20F400, 0x7E008400, F(RDM),         "SQRDMLAH/SQRDMLSH (scalar)"},
+    {0xBF00D400, 0x2F00D000, F(RDM),         "SQRDMLAH/SQRDMLSH (by element)"},
+    {0xFF00D400, 0x7F00D000, F(RDM),         "SQRDMLAH/SQRDMLSH (scalar, by element)"},
+    {0xBFE0FC00, 0x0E809C00, F(I8MM),        "USDOT (vector)"},
+    {0x9FE0FC00, 0x0E809400, F(DotProd),     "SDOT/UDOT (vector)"},
+    {0xBFC0F400, 0x0F80F000, F(I8MM),        "USDOT (by element)"},
+    {0xBFC0F400, 0x0F00F000, F(I8MM),        "SUDOT (by element)"},
+    {0x9FC0F400, 0x0F80E000, F(DotProd),     "SDOT/UDOT (by element)"},
+    {0xFFE0FC00, 0x4E80A400, F(I8MM),        "SMMLA"},
+    {0xFFE0FC00, 0x6E80A400, F(I8MM),        "UMMLA"},
+    {0xFFE0FC00, 0x4E80AC00, F(I8MM),        "USMMLA"},
+    {0xBFE0FC00, 0x2E40FC00, F(BF16),        "BFDOT (vector)"},
+    {0xFFE0FC00, 0x6E40EC00, F(BF16),        "BFMMLA"},
+    {0xBFE0FC00, 0x2EC0FC00, F(BF16),        "BFMLALB/BFMLALT"},
+    {0xBFFFFC00, 0x0EA16800, F(BF16),        "BFCVTN/BFCVTN2"},
+    {0xBFC0F400, 0x0F40F000, F(BF16),        "BFDOT (by element)"},
+    {0xBFC0F400, 0x0FC0F000, F(BF16),        "BFMLALB/BFMLALT (by element)"},
+    {0xBF60FC00, 0x0E20EC00, F(FHM),         "FMLAL/FMLSL (vector)"},
+    {0xBF60FC00, 0x2E20CC00, F(FHM),         "FMLAL2/FMLSL2 (vector)"},
+    {0xBFC0B400, 0x0F800000, F(FHM),         "FMLAL/FMLSL (by element)"},
+    {0xBFC0B400, 0x2F808000, F(FHM),         "FMLAL2/FMLSL2 (by element)"},
+    {0xBF20E400, 0x2E00C400, F(FCMA),        "FCMLA (vector)"},
+    {0xBF20EC00, 0x2E00E400, F(FCMA),        "FCADD"},
+    {0xBF009400, 0x2F001000, F(FCMA),        "FCMLA (by element)"},
+    {0x9FBFEC00, 0x0E21E800, F(FRINTTS),     "FRINT32x/FRINT64x (vector)"},
+    {0x9F60C400, 0x0E400400, F(FP16),        "FP half-precision (vector)"},
+    {0xDF60C400, 0x5E400400, F(FP16),        "FP half-precision (scalar)"},
+    {0x9F7E0C00, 0x0E780800, F(FP16),        "FP half-precision (vector, two registers)"},
+    {0xDF7E0C00, 0x5E780800, F(FP16),        "FP half-precision (scalar, two registers)"},
+    {0x9FC03400, 0x0F001000, F(FP16),        "FMLA/FMLS/FMUL/FMULX (half-precision, by element)"},
+    {0xDFC03400, 0x5F001000, F(FP16),        "FMLA/FMLS/FMUL/FMULX (half-precision, scalar, by element)"},
+    {0xBF7FCC00, 0x0E30C800, F(FP16),        "FMAXV/FMINV/FMAXNMV/FMINNMV (half-precision)"},
+    {0xFF7FCC00, 0x5E30C800, F(FP16),        "FADDP/FMAXP/FMINP/FMAXNMP/FMINNMP (half-precision, scalar)"},
+    {0x9FF0FC00, 0x0F10E400, F(FP16),        "SCVTF/UCVTF (half-precision, fixed-point)"},
+    {0x9FF0FC00, 0x0F10FC00, F(FP16),        "FCVTZS/FCVTZU (half-precision, fixed-point)"},
+    {0xDFF0FC00, 0x5F10E400, F(FP16),        "SCVTF/UCVTF (half-precision, scalar, fixed-point)"},
+    {0xDFF0FC00, 0x5F10FC00, F(FP16),        "FCVTZS/FCVTZU (half-precision, scalar, fixed-point)"},
+    {0x9FF8FC00, 0x0F00FC00, F(FP16),        "FMOV (half-precision, vector, immediate)"},
+
+    // SME. The instructions of the SME extensions are listed before the SME catch-all.
+    {0xFEC00008, 0xA0C00000, F(SME_I16I64),  "SMOPA/SMOPS/UMOPA/UMOPS/SUMOPA/SUMOPS/USMOPA/USMOPS (64-bit)"},
+    {0xFFFE0018, 0xC0D00000, F(SME_I16I64),  "ADDHA/ADDVA (64-bit)"},
+    {0xFFE00008, 0x80C00000, F(SME_F64F64),  "FMOPA/FMOPS (64-bit)"},
+    {0x9E000000, 0x80000000, F(SME),         "SME"},
+    {0xFFFFF800, 0x04BF5800, F(SME),         "RDSVL"},
+    {0xFFA0F800, 0x04205800, F(SME),         "ADDSVL/ADDSPL"},
+    {0xFF20C210, 0x25204000, F(SME),         "PSEL"},
+    {0xFFFFE010, 0x052E8000, F(SME),         "REVD"},
+    {0xFF20F800, 0x4400C000, F(SME),         "SCLAMP/UCLAMP"},
+
+    // SVE encoding space. The instructions of SVE2 and other extensions
+    // are listed before the SVE catch-all.
+    {0xFFE0FC00, 0x64A0E400, F(F32MM),       "FMMLA (single-precision)"},
+    {0xFFE0FC00, 0x64E0E400, F(F64MM),       "FMMLA (double-precision)"},
+    {0xFE60C000, 0xA4200000, F(F64MM),       "LD1ROB/LD1ROH/LD1ROW/LD1ROD"},
+    {0xFFE0E000, 0x05A00000, F(F64MM),       "ZIP1/ZIP2/UZP1/UZP2/TRN1/TRN2 (quadwords)"},
+    {0xFF20FC00, 0x45009800, F(I8MM),        "SMMLA/UMMLA/USMMLA (SVE)"},
+    {0xFFE0FC00, 0x44A01C00, F(I8MM),        "SUDOT (SVE)"},
+    {0xFFE0FC00, 0x44A01800, F(I8MM),        "USDOT (SVE, indexed)"},
+    {0xFFE0FC00, 0x44807800, F(I8MM),        "USDOT (SVE, vectors)"},
+    {0xFFFFE000, 0x658AA000, F(BF16),        "BFCVT (SVE)"},
+    {0xFFFFE000, 0x648AA000, F(BF16),        "BFCVTNT"},
+    {0xFFE0FC00, 0x6460E400, F(BF16),        "BFMMLA (SVE)"},
+    {0xFFE0FC00, 0x64608000, F(BF16),        "BFDOT (SVE, vectors)"},
+    {0xFFE0FC00, 0x64604000, F(BF16),        "BFDOT (SVE, indexed)"},
+    {0xFFE0FC00, 0x64E08000, F(BF16),        "BFMLALB (SVE, vectors)"},
+    {0xFFE0FC00, 0x64E08400, F(BF16),        "BFMLALT (SVE, vectors)"},
+    {0xFFE0F000, 0x64E04000, F(BF16),        "BFMLALB/BFMLALT (SVE, indexed)"},
+    {0xFFFDF800, 0x4520E000, F(SVE_AES),     "AESE/AESD/AESMC/AESIMC (SVE)"},
+    {0xFFE0F800, 0x45006800, F(SVE_PMULL128),"PMULLB/PMULLT (128-bit)"},
+    {0xFFE0FC00, 0x4520F400, F(SVE_SHA3),    "RAX1 (SVE)"},
+    {0xFFFFFC00, 0x4523E000, F(SVE_SM4),     "SM4E (SVE)"},
+    {0xFFE0FC00, 0x4520F000, F(SVE_SM4),     "SM4EKEY (SVE)"},
+    {0xFF20F000, 0x4500B000, F(SVE_BitPerm), "BDEP/BEXT/BGRP"},
+    {0xFF80F800, 0x44800000, F(SVE),         "SDOT/UDOT (SVE)"},
+    {0xFE000000, 0x44000000, F(SVE2),        "SVE2 integer"},
+    {0xFF20F800, 0x04203800, F(SVE2),        "EOR3/BCAX/BSL/BSL1N/BSL2N/NBSL"},
+    {0xFF20FC00, 0x04203400, F(SVE2),        "XAR (SVE)"},
+    {0xFF20F000, 0x04206000, F(SVE2),        "MUL/PMUL/SMULH/UMULH (unpredicated)"},
+    {0xFF20F800, 0x04207000, F(SVE2),        "SQDMULH/SQRDMULH (unpredicated)"},
+    {0xFF3EE000, 0x04068000, F(SVE2),        "SQSHL/UQSHL (immediate)"},
+    {0xFF3EE000, 0x040C8000, F(SVE2),        "SRSHR/URSHR"},
+    {0xFF3FE000, 0x040F8000, F(SVE2),        "SQSHLU"},
+    {0xFFE0E000, 0x05600000, F(SVE2),        "EXT (constructive)"},
+    {0xFF3FE000, 0x052D8000, F(SVE2),        "SPLICE (constructive)"},
+    {0xFF20F800, 0x05202800, F(SVE2),        "TBL (two registers)/TBX"},
+    {0xFF20E400, 0x25200000, F(SVE2),        "WHILEGE/WHILEGT/WHILEHI/WHILEHS"},
+    {0xFF20FC00, 0x25203000, F(SVE2),        "WHILERW/WHILEWR"},
+    {0xFF38E000, 0x64108000, F(SVE2),        "FADDP/FMAXP/FMINP/FMAXNMP/FMINNMP (SVE)"},
+    {0xFFBCE000, 0x6488A000, F(SVE2),        "FCVTLT/FCVTNT"},
+    {0xFEFFE000, 0x640AA000, F(SVE2),        "FCVTX/FCVTXNT"},
+    {0xFFF9E000, 0x6518A000, F(SVE2),        "FLOGB"},
+    {0xFFE0D800, 0x64A08000, F(SVE2),        "FMLALB/FMLALT/FMLSLB/FMLSLT (SVE, vectors)"},
+    {0xFFE0D000, 0x64A04000, F(SVE2),        "FMLALB/FMLALT/FMLSLB/FMLSLT (SVE, indexed)"},
+    {0xFE60C000, 0x84008000, F(SVE2),        "LDNT1 (vector plus scalar, 32-bit)"},
+    {0xFE60A000, 0xC4008000, F(SVE2),        "LDNT1 (vector plus scalar, 64-bit)"},
+    {0xFE20E000, 0xE4002000, F(SVE2),        "STNT1 (vector plus scalar)"},
+    {0x1E000000, 0x04000000, F(SVE),         "SVE"},
+};
+
+
+//----------------------------------------------------------------------------
+// Self-check of the table, at compile time.
+//
+// KnownEncodings are sample instructions with the feature they require.
+// The encodings were produced by "llvm-mc -triple=aarch64 -show-encoding"
+// (LLVM 14) with all extensions enabled. LLVM 14 does not know CSSC and
+// RDSVL/ADDSVL/ADDSPL, these ones are hand-encoded from the Arm ARM.
+//
+// Each sample must be decoded to its feature using the first match rule.
+// Each group in the table must be reachable: its own value must not be
+// captured by a preceding group (e.g. LDAPR must come before the LSE
+// catch-all, RAX1 before SHA512H/SHA512H2/SHA512SU1).
+//----------------------------------------------------------------------------
+
+namespace {
+    struct KnownEncoding {
+        uint32_t    insn;
+        FeatureId   feature;
+        const char* text;
+    };
+
+    constexpr KnownEncoding KnownEncodings[] = {
+    // Data processing, register.
+    {0x9AC25C20, F(CRC32),         "crc32cx w0, w1, x2"},
+    {0x1AC24020, F(CRC32),         "crc32b w0, w1, w2"},
+    {0xDAC10020, F(PAuth),         "pacia x0, x1"},
+    {0xDAC13FE3, F(PAuth),         "autdzb x3"},
+    {0xDAC143E0, F(PAuth),         "xpaci x0"},
+    {0x9AC23020, F(PAuth),         "pacga x0, x1, x2"},
+    {0x9AC21020, F(MTE),           "irg x0, x1, x2"},
+    {0x9AC21420, F(MTE),           "gmi x0, x1, x2"},
+    {0x9AC20020, F(MTE),           "subp x0, x1, x2"},
+    {0xBAC20020, F(MTE),           "subps x0, x1, x2"},
+    {0xDAC01820, F(CSSC),          "ctz x0, x1"},  // hand-encoded
+    {0x5AC01C20, F(CSSC),          "cnt w0, w1"},  // hand-encoded
+    {0xDAC02020, F(CSSC),          "abs x0, x1"},  // hand-encoded
+    {0x9AC26020, F(CSSC),          "smax x0, x1, x2"},  // hand-encoded
+    {0x1AC26C20, F(CSSC),          "umin w0, w1, w2"},  // hand-encoded
+    {0x91C00C20, F(CSSC),          "smax x0, x1, #3"},  // hand-encoded
+    {0x11CC0C20, F(CSSC),          "umin w0, w1, #3"},  // hand-encoded
+    {0x91810420, F(MTE),           "addg x0, x1, #16, #1"},
+    {0xD1810420, F(MTE),           "subg x0, x1, #16, #1"},
+    {0xBA018402, F(FlagM),         "rmif x0, #3, #2"},
+    {0x3A00080D, F(FlagM),         "setf8 w0"},
+    {0x3A00480D, F(FlagM),         "setf16 w0"},
+
+    // Branches, exception generation, system instructions.
+    {0x54000050, F(HBC),           "bc.eq #8"},
+    {0xD71F0801, F(PAuth),         "braa x0, x1"},
+    {0xD63F081F, F(PAuth),         "blraaz x0"},
+    {0xD65F0BFF, F(PAuth),         "retaa"},
+    {0xD69F0FFF, F(PAuth),         "eretab"},
+    {0xD500401F, F(FlagM),         "cfinv"},
+    {0xD500405F, F(FlagM2),        "axflag"},
+    {0xD500403F, F(FlagM2),        "xaflag"},
+    {0xD503413F, F(SSBS),          "msr ssbs, #1"},
+    {0xD503477F, F(SME),           "smstart"},
+    {0xD503437F, F(SME),           "smstart sm"},
+    {0xD503447F, F(SME),           "smstop za"},
+    {0xD50330FF, F(SB),            "sb"},
+    {0xD5031000, F(WFxT),          "wfet x0"},
+    {0xD5031021, F(WFxT),          "wfit x1"},
+    {0xD5233060, F(TME),           "tstart x0"},
+    {0xD5233160, F(TME),           "ttest x0"},
+    {0xD503307F, F(TME),           "tcommit"},
+    {0xD4600020, F(TME),           "tcancel #1"},
+    {0xD50B7C20, F(DPB),           "dc cvap, x0"},
+    {0xD50B7D20, F(DPB2),          "dc cvadp, x0"},
+    {0xD50B7380, F(SPECRES),       "cfp rctx, x0"},
+    {0xD50B73A0, F(SPECRES),       "dvp rctx, x0"},
+    {0xD50B73E0, F(SPECRES),       "cpp rctx, x0"},
+    {0xD50B7460, F(MTE),           "dc gva, x0"},
+    {0xD50B7480, F(MTE),           "dc gzva, x0"},
+    {0xD53B2400, F(RNG),           "mrs x0, rndr"},
+    {0xD53B2421, F(RNG),           "mrs x1, rndrrs"},
+    {0xD53B42C0, F(SSBS),          "mrs x0, ssbs"},
+    {0xD51B42C0, F(SSBS),          "msr ssbs, x0"},
+
+    // Loads and stores.
+    {0xF83F9020, F(LS64),          "st64b x0, [x1]"},
+    {0xF83FD020, F(LS64),          "ld64b x0, [x1]"},
+    {0xF822B020, F(LS64),          "st64bv x2, x0, [x1]"},
+    {0xF822A020, F(LS64),          "st64bv0 x2, x0, [x1]"},
+    {0xF8BFC020, F(LRCPC),         "ldapr x0, [x1]"},
+    {0x38BFC020, F(LRCPC),         "ldaprb w0, [x1]"},
+    {0xF8200041, F(LSE),           "ldadd x0, x1, [x2]"},
+    {0x78E03041, F(LSE),           "ldsetalh w0, w1, [x2]"},
+    {0xF8608041, F(LSE),           "swpl x0, x1, [x2]"},
+    {0x38A06041, F(LSE),           "ldumaxab w0, w1, [x2]"},
+    {0xC8A07C41, F(LSE),           "cas x0, x1, [x2]"},
+    {0x08E0FC41, F(LSE),           "casalb w0, w1, [x2]"},
+    {0x48207C82, F(LSE),           "casp x0, x1, x2, x3, [x4]"},
+    {0x0860FC82, F(LSE),           "caspal w0, w1, w2, w3, [x4]"},
+    {0xC8DF7C20, F(LOR),           "ldlar x0, [x1]"},
+    {0x089F7C20, F(LOR),           "stllrb w0, [x1]"},
+    {0xD9408020, F(LRCPC2),        "ldapur x0, [x1, #8]"},
+    {0x191FF020, F(LRCPC2),        "stlurb w0, [x1, #-1]"},
+    {0x99800020, F(LRCPC2),        "ldapursw x0, [x1]"},
+    {0x19010440, F(MOPS),          "cpyfp [x0]!, [x1]!, x2!"},
+    {0x1D81C440, F(MOPS),          "cpyen [x0]!, [x1]!, x2!"},
+    {0x19C20420, F(MOPS),          "setp [x0]!, x1!, x2"},
+    {0x1DC28420, F(MOPS),          "setge [x0]!, x1!, x2"},
+    {0xF8201420, F(PAuth),         "ldraa x0, [x1, #8]"},
+    {0xF8FFFC20, F(PAuth),         "ldrab x0, [x1, #-8]!"},
+    {0xD9200820, F(MTE),           "stg x0, [x1]"},
+    {0xD9600020, F(MTE),           "ldg x0, [x1]"},
+    {0xD9A01C20, F(MTE),           "st2g x0, [x1, #16]!"},
+    {0xD9601420, F(MTE),           "stzg x0, [x1], #16"},
+    {0x69000440, F(MTE),           "stgp x0, x1, [x2]"},
+    {0x68808440, F(MTE),           "stgp x0, x1, [x2], #16"},
+    {0x69808440, F(MTE),           "stgp x0, x1, [x2, #16]!"},
+
+    // Cryptographic extensions.
+    {0x4E284820, F(AES),           "aese v0.16b, v1.16b"},
+    {0x4E287820, F(AES),           "aesimc v0.16b, v1.16b"},
+    {0x0EE2E020, F(PMULL),         "pmull v0.1q, v1.1d, v2.1d"},
+    {0x4EE2E020, F(PMULL),         "pmull2 v0.1q, v1.2d, v2.2d"},
+    {0x5E020020, F(SHA1),          "sha1c q0, s1, v2.4s"},
+    {0x5E023020, F(SHA1),          "sha1su0 v0.4s, v1.4s, v2.4s"},
+    {0x5E024020, F(SHA256),        "sha256h q0, q1, v2.4s"},
+    {0x5E026020, F(SHA256),        "sha256su1 v0.4s, v1.4s, v2.4s"},
+    {0x5E280820, F(SHA1),          "sha1h s0, s1"},
+    {0x5E281820, F(SHA1),          "sha1su1 v0.4s, v1.4s"},
+    {0x5E282820, F(SHA256),        "sha256su0 v0.4s, v1.4s"},
+    {0xCE628C20, F(SHA3),          "rax1 v0.2d, v1.2d, v2.2d"},
+    {0xCE628020, F(SHA512),        "sha512h q0, q1, v2.2d"},
+    {0xCE628820, F(SHA512),        "sha512su1 v0.2d, v1.2d, v2.2d"},
+    {0xCEC08020, F(SHA512),        "sha512su0 v0.2d, v1.2d"},
+    {0xCE020C20, F(SHA3),          "eor3 v0.16b, v1.16b, v2.16b, v3.16b"},
+    {0xCE220C20, F(SHA3),          "bcax v0.16b, v1.16b, v2.16b, v3.16b"},
+    {0xCE822820, F(SHA3),          "xar v0.2d, v1.2d, v2.2d, #10"},
+    {0xCE420C20, F(SM3),           "sm3ss1 v0.4s, v1.4s, v2.4s, v3.4s"},
+    {0xCE429020, F(SM3),           "sm3tt1a v0.4s, v1.4s, v2.s[1]"},
+    {0xCE42BC20, F(SM3),           "sm3tt2b v0.4s, v1.4s, v2.s[3]"},
+    {0xCE62C020, F(SM3),           "sm3partw1 v0.4s, v1.4s, v2.4s"},
+    {0xCE62C420, F(SM3),           "sm3partw2 v0.4s, v1.4s, v2.4s"},
+    {0xCE62C820, F(SM4),           "sm4ekey v0.4s, v1.4s, v2.4s"},
+    {0xCEC08420, F(SM4),           "sm4e v0.4s, v1.4s"},
+
+    // Floating point, scalar.
+    {0x1EE24020, NONE,             "fcvt s0, h1"},
+    {0x1EE2C020, NONE,             "fcvt d0, h1"},
+    {0x1E23C020, NONE,             "fcvt h0, s1"},
+    {0x1E63C020, NONE,             "fcvt h0, d1"},
+    {0x1E7E0020, F(JSCVT),         "fjcvtzs w0, d1"},
+    {0x1E634020, F(BF16),          "bfcvt h0, s1"},
+    {0x1E28C020, F(FRINTTS),       "frint32x s0, s1"},
+    {0x1E694020, F(FRINTTS),       "frint64z d0, d1"},
+    {0x1EE22820, F(FP16),          "fadd h0, h1, h2"},
+    {0x1EE70020, F(FP16),          "fmov h0, w1"},
+    {0x1EF80020, F(FP16),          "fcvtzs w0, h1"},
+    {0x1EE02008, F(FP16),          "fcmp h0, #0.0"},
+    {0x1EE20C20, F(FP16),          "fcsel h0, h1, h2, eq"},
+    {0x1EC2F420, F(FP16),          "scvtf h0, w1, #3"},
+    {0x9ED9EC20, F(FP16),          "fcvtzu x0, h1, #5"},
+    {0x1FC20C20, F(FP16),          "fmadd h0, h1, h2, h3"},
+    {0x1FE28C20, F(FP16),          "fnmsub h0, h1, h2, h3"},
+
+    // Advanced SIMD.
+    {0x6E828420, F(RDM),           "sqrdmlah v0.4s, v1.4s, v2.4s"},
+    {0x2E428C20, F(RDM),           "sqrdmlsh v0.4h, v1.4h, v2.4h"},
+    {0x7E828420, F(RDM),           "sqrdmlah s0, s1, s2"},
+    {0x6FA2D020, F(RDM),           "sqrdmlah v0.4s, v1.4s, v2.s[1]"},
+    {0x6F72F820, F(RDM),           "sqrdmlsh v0.8h, v1.8h, v2.h[7]"},
+    {0x7F72F020, F(RDM),           "sqrdmlsh h0, h1, v2.h[3]"},
+    {0x4E829C20, F(I8MM),          "usdot v0.4s, v1.16b, v2.16b"},
+    {0x4E829420, F(DotProd),       "sdot v0.4s, v1.16b, v2.16b"},
+    {0x2E829420, F(DotProd),       "udot v0.2s, v1.8b, v2.8b"},
+    {0x4FA2F820, F(I8MM),          "usdot v0.4s, v1.16b, v2.4b[3]"},
+    {0x0F22F020, F(I8MM),          "sudot v0.2s, v1.8b, v2.4b[1]"},
+    {0x4FA2E820, F(DotProd),       "sdot v0.4s, v1.16b, v2.4b[3]"},
+    {0x2F82E020, F(DotProd),       "udot v0.2s, v1.8b, v2.4b[0]"},
+    {0x4E82A420, F(I8MM),          "smmla v0.4s, v1.16b, v2.16b"},
+    {0x6E82A420, F(I8MM),          "ummla v0.4s, v1.16b, v2.16b"},
+    {0x4E82AC20, F(I8MM),          "usmmla v0.4s, v1.16b, v2.16b"},
+    {0x6E42FC20, F(BF16),          "bfdot v0.4s, v1.8h, v2.8h"},
+    {0x6E42EC20, F(BF16),          "bfmmla v0.4s, v1.8h, v2.8h"},
+    {0x2EC2FC20, F(BF16),          "bfmlalb v0.4s, v1.8h, v2.8h"},
+    {0x6EC2FC20, F(BF16),          "bfmlalt v0.4s, v1.8h, v2.8h"},
+    {0x0EA16820, F(BF16),          "bfcvtn v0.4h, v1.4s"},
+    {0x4EA16820, F(BF16),          "bfcvtn2 v0.8h, v1.4s"},
+    {0x0F62F020, F(BF16),          "bfdot v0.2s, v1.4h, v2.2h[1]"},
+    {0x4FF2F820, F(BF16),          "bfmlalt v0.4s, v1.8h, v2.h[7]"},
+    {0x0E22EC20, F(FHM),           "fmlal v0.2s, v1.2h, v2.2h"},
+    {0x4EA2EC20, F(FHM),           "fmlsl v0.4s, v1.4h, v2.4h"},
+    {0x6E22CC20, F(FHM),           "fmlal2 v0.4s, v1.4h, v2.4h"},
+    {0x2EA2CC20, F(FHM),           "fmlsl2 v0.2s, v1.2h, v2.2h"},
+    {0x4FB20820, F(FHM),           "fmlal v0.4s, v1.4h, v2.h[7]"},
+    {0x0F824020, F(FHM),           "fmlsl v0.2s, v1.2h, v2.h[0]"},
+    {0x6F928820, F(FHM),           "fmlal2 v0.4s, v1.4h, v2.h[5]"},
+    {0x2F92C020, F(FHM),           "fmlsl2 v0.2s, v1.2h, v2.h[1]"},
+    {0x6E82CC20, F(FCMA),          "fcmla v0.4s, v1.4s, v2.4s, #90"},
+    {0x6EC2F420, F(FCMA),          "fcadd v0.2d, v1.2d, v2.2d, #270"},
+    {0x6F825820, F(FCMA),          "fcmla v0.4s, v1.4s, v2.s[1], #180"},
+    {0x6F621820, F(FCMA),          "fcmla v0.8h, v1.8h, v2.h[3], #0"},
+    {0x6E21E820, F(FRINTTS),       "frint32x v0.4s, v1.4s"},
+    {0x4E61F820, F(FRINTTS),       "frint64z v0.2d, v1.2d"},
+    {0x4E421420, F(FP16),          "fadd v0.8h, v1.8h, v2.8h"},
+    {0x0E420420, F(FP16),          "fmaxnm v0.4h, v1.4h, v2.4h"},
+    {0x7EC21420, F(FP16),          "fabd h0, h1, h2"},
+    {0x5E422420, F(FP16),          "fcmeq h0, h1, h2"},
+    {0x6EF8F820, F(FP16),          "fneg v0.8h, v1.8h"},
+    {0x0E798820, F(FP16),          "frintn v0.4h, v1.4h"},
+    {0x4EF9B820, F(FP16),          "fcvtzs v0.8h, v1.8h"},
+    {0x4EF8D820, F(FP16),          "fcmeq v0.8h, v1.8h, #0.0"},
+    {0x6EF9F820, F(FP16),          "fsqrt v0.8h, v1.8h"},
+    {0x5EF9D820, F(FP16),          "frecpe h0, h1"},
+    {0x5E79A820, F(FP16),          "fcvtns h0, h1"},
+    {0x4F321820, F(FP16),          "fmla v0.8h, v1.8h, v2.h[7]"},
+    {0x2F129020, F(FP16),          "fmulx v0.4h, v1.4h, v2.h[1]"},
+    {0x5F329020, F(FP16),          "fmul h0, h1, v2.h[3]"},
+    {0x4E30F820, F(FP16),          "fmaxv h0, v1.8h"},
+    {0x0EB0C820, F(FP16),          "fminnmv h0, v1.4h"},
+    {0x5E30D820, F(FP16),          "faddp h0, v1.2h"},
+    {0x5E30C820, F(FP16),          "fmaxnmp h0, v1.2h"},
+    {0x4F1DE420, F(FP16),          "scvtf v0.8h, v1.8h, #3"},
+    {0x2F10FC20, F(FP16),          "fcvtzu v0.4h, v1.4h, #16"},
+    {0x7F1DE420, F(FP16),          "ucvtf h0, h1, #3"},
+    {0x5F1FFC20, F(FP16),          "fcvtzs h0, h1, #1"},
+    {0x4F03FE00, F(FP16),          "fmov v0.8h, #1.0"},
+
+    // SME.
+    {0xA0C12000, F(SME_I16I64),    "smopa za0.d, p0/m, p1/m, z0.h, z1.h"},
+    {0xA1C12017, F(SME_I16I64),    "usmops za7.d, p0/m, p1/m, z0.h, z1.h"},
+    {0xC0D02000, F(SME_I16I64),    "addha za0.d, p0/m, p1/m, z0.d"},
+    {0xC0D12007, F(SME_I16I64),    "addva za7.d, p0/m, p1/m, z0.d"},
+    {0x80C12000, F(SME_F64F64),    "fmopa za0.d, p0/m, p1/m, z0.d, z1.d"},
+    {0x80C12017, F(SME_F64F64),    "fmops za7.d, p0/m, p1/m, z0.d, z1.d"},
+    {0x80812000, F(SME),           "fmopa za0.s, p0/m, p1/m, z0.s, z1.s"},
+    {0xA0812000, F(SME),           "smopa za0.s, p0/m, p1/m, z0.b, z1.b"},
+    {0xE09F0000, F(SME),           "ld1w {za0h.s[w12, 0]}, p0/z, [x0]"},
+    {0xE0FF8001, F(SME),           "st1d {za0v.d[w12, 1]}, p0, [x0]"},
+    {0xE1000000, F(SME),           "ldr za[w12, 0], [x0]"},
+    {0xC0820000, F(SME),           "mova z0.s, p0/m, za0h.s[w12, 0]"},
+    {0xC00800FF, F(SME),           "zero {za}"},
+    {0xC0902000, F(SME),           "addha za0.s, p0/m, p1/m, z0.s"},
+    {0x04BF5820, F(SME),           "rdsvl x0, #1"},  // hand-encoded
+    {0x043F583F, F(SME),           "addsvl sp, sp, #1"},  // hand-encoded
+    {0x04615FE0, F(SME),           "addspl x0, x1, #-1"},  // hand-encoded
+    {0x25304440, F(SME),           "psel p0, p1, p2.s[w12, 0]"},
+    {0x052E8020, F(SME),           "revd z0.q, p0/m, z1.q"},
+    {0x4482C020, F(SME),           "sclamp z0.s, z1.s, z2.s"},
+    {0x4402C420, F(SME),           "uclamp z0.b, z1.b, z2.b"},
+
+    // SVE.
+    {0x64A2E420, F(F32MM),         "fmmla z0.s, z1.s, z2.s"},
+    {0x64E2E420, F(F64MM),         "fmmla z0.d, z1.d, z2.d"},
+    {0xA4202000, F(F64MM),         "ld1rob {z0.b}, p0/z, [x0]"},
+    {0xA5A10000, F(F64MM),         "ld1rod {z0.d}, p0/z, [x0, x1, lsl #3]"},
+    {0x05A20020, F(F64MM),         "zip1 z0.q, z1.q, z2.q"},
+    {0x05A21C20, F(F64MM),         "trn2 z0.q, z1.q, z2.q"},
+    {0x45029820, F(I8MM),          "smmla z0.s, z1.b, z2.b"},
+    {0x45829820, F(I8MM),          "usmmla z0.s, z1.b, z2.b"},
+    {0x44BA1C20, F(I8MM),          "sudot z0.s, z1.b, z2.b[3]"},
+    {0x44AA1820, F(I8MM),          "usdot z0.s, z1.b, z2.b[1]"},
+    {0x44827820, F(I8MM),          "usdot z0.s, z1.b, z2.b"},
+    {0x658AA020, F(BF16),          "bfcvt z0.h, p0/m, z1.s"},
+    {0x648AA020, F(BF16),          "bfcvtnt z0.h, p0/m, z1.s"},
+    {0x6462E420, F(BF16),          "bfmmla z0.s, z1.h, z2.h"},
+    {0x64628020, F(BF16),          "bfdot z0.s, z1.h, z2.h"},
+    {0x647A4020, F(BF16),          "bfdot z0.s, z1.h, z2.h[3]"},
+    {0x64E28020, F(BF16),          "bfmlalb z0.s, z1.h, z2.h"},
+    {0x64E28420, F(BF16),          "bfmlalt z0.s, z1.h, z2.h"},
+    {0x64FA4820, F(BF16),          "bfmlalb z0.s, z1.h, z2.h[7]"},
+    {0x64E24420, F(BF16),          "bfmlalt z0.s, z1.h, z2.h[0]"},
+    {0x4522E020, F(SVE_AES),       "aese z0.b, z0.b, z1.b"},
+    {0x4520E400, F(SVE_AES),       "aesimc z0.b, z0.b"},
+    {0x45026820, F(SVE_PMULL128),  "pmullb z0.q, z1.d, z2.d"},
+    {0x45026C20, F(SVE_PMULL128),  "pmullt z0.q, z1.d, z2.d"},
+    {0x4522F420, F(SVE_SHA3),      "rax1 z0.d, z1.d, z2.d"},
+    {0x4523E020, F(SVE_SM4),       "sm4e z0.s, z0.s, z1.s"},
+    {0x4522F020, F(SVE_SM4),       "sm4ekey z0.s, z1.s, z2.s"},
+    {0x4582B420, F(SVE_BitPerm),   "bdep z0.s, z1.s, z2.s"},
+    {0x45C2B820, F(SVE_BitPerm),   "bgrp z0.d, z1.d, z2.d"},
+    {0x44820020, F(SVE),           "sdot z0.s, z1.b, z2.b"},
+    {0x44C20420, F(SVE),           "udot z0.d, z1.h, z2.h"},
+    {0x44BA0020, F(SVE),           "sdot z0.s, z1.b, z2.b[3]"},
+    {0x44F20420, F(SVE),           "udot z0.d, z1.h, z2.h[1]"},
+    {0x44827020, F(SVE2),          "sqrdmlah z0.s, z1.s, z2.s"},
+    {0x45420020, F(SVE2),          "saddlb z0.h, z1.b, z2.b"},
+    {0x44E22820, F(SVE2),          "sqdmlalb z0.d, z1.s, z2.s[1]"},
+    {0x4484A020, F(SVE2),          "sadalp z0.s, p0/m, z1.h"},
+    {0x44821420, F(SVE2),          "cdot z0.s, z1.b, z2.b, #90"},
+    {0x45A2C020, F(SVE2),          "histcnt z0.s, p0/z, z1.s, z2.s"},
+    {0x45218400, F(SVE2),          "match p0.b, p1/z, z0.b, z1.b"},
+    {0x04213840, F(SVE2),          "eor3 z0.d, z0.d, z1.d, z2.d"},
+    {0x04E13C40, F(SVE2),          "nbsl z0.d, z0.d, z1.d, z2.d"},
+    {0x047D3420, F(SVE2),          "xar z0.s, z0.s, z1.s, #3"},
+    {0x04A26020, F(SVE2),          "mul z0.s, z1.s, z2.s"},
+    {0x04226420, F(SVE2),          "pmul z0.b, z1.b, z2.b"},
+    {0x04E26C20, F(SVE2),          "umulh z0.d, z1.d, z2.d"},
+    {0x04627420, F(SVE2),          "sqrdmulh z0.h, z1.h, z2.h"},
+    {0x04468060, F(SVE2),          "sqshl z0.s, p0/m, z0.s, #3"},
+    {0x044D83A0, F(SVE2),          "urshr z0.s, p0/m, z0.s, #3"},
+    {0x048F8020, F(SVE2),          "sqshlu z0.d, p0/m, z0.d, #1"},
+    {0x05600C20, F(SVE2),          "ext z0.b, {z1.b, z2.b}, #3"},
+    {0x05AD8020, F(SVE2),          "splice z0.s, p0, {z1.s, z2.s}"},
+    {0x05A32820, F(SVE2),          "tbl z0.s, {z1.s, z2.s}, z3.s"},
+    {0x05A22C20, F(SVE2),          "tbx z0.s, z1.s, z2.s"},
+    {0x25A11000, F(SVE2),          "whilege p0.s, x0, x1"},
+    {0x25210810, F(SVE2),          "whilehi p0.b, w0, w1"},
+    {0x25A13010, F(SVE2),          "whilerw p0.s, x0, x1"},
+    {0x25E13000, F(SVE2),          "whilewr p0.d, x0, x1"},
+    {0x64908020, F(SVE2),          "faddp z0.s, p0/m, z0.s, z1.s"},
+    {0x64D58020, F(SVE2),          "fminnmp z0.d, p0/m, z0.d, z1.d"},
+    {0x6489A020, F(SVE2),          "fcvtlt z0.s, p0/m, z1.h"},
+    {0x64CAA020, F(SVE2),          "fcvtnt z0.s, p0/m, z1.d"},
+    {0x650AA020, F(SVE2),          "fcvtx z0.s, p0/m, z1.d"},
+    {0x640AA020, F(SVE2),          "fcvtxnt z0.s, p0/m, z1.d"},
+    {0x651CA020, F(SVE2),          "flogb z0.s, p0/m, z1.s"},
+    {0x64A28020, F(SVE2),          "fmlalb z0.s, z1.h, z2.h"},
+    {0x64A2A420, F(SVE2),          "fmlslt z0.s, z1.h, z2.h"},
+    {0x64BA4C20, F(SVE2),          "fmlalt z0.s, z1.h, z2.h[7]"},
+    {0x64A26020, F(SVE2),          "fmlslb z0.s, z1.h, z2.h[0]"},
+    {0x8500A020, F(SVE2),          "ldnt1w {z0.s}, p0/z, [z1.s, x0]"},
+    {0x84008020, F(SVE2),          "ldnt1sb {z0.s}, p0/z, [z1.s, x0]"},
+    {0xC580C020, F(SVE2),          "ldnt1d {z0.d}, p0/z, [z1.d, x0]"},
+    {0xC51F8020, F(SVE2),          "ldnt1sw {z0.d}, p0/z, [z1.d]"},
+    {0xE5402020, F(SVE2),          "stnt1w {z0.s}, p0, [z1.s, x0]"},
+    {0xE5802020, F(SVE2),          "stnt1d {z0.d}, p0, [z1.d, x0]"},
+    {0x04A20020, F(SVE),           "add z0.s, z1.s, z2.s"},
+    {0xA540A000, F(SVE),           "ld1w {z0.s}, p0/z, [x0]"},
+    {0xE5E14000, F(SVE),           "st1d {z0.d}, p0, [x0, x1, lsl #3]"},
+    {0x2598E3E0, F(SVE),           "ptrue p0.s"},
+    {0x65A20020, F(SVE),           "fmla z0.s, p0/m, z1.s, z2.s"},
+    {0x25A11C00, F(SVE),           "whilelo p0.s, x0, x1"},
+    {0x04E0E3E0, F(SVE),           "cntd x0"},
+    {0x04BF5020, F(SVE),           "rdvl x0, #1"},
+    {0x043F57DF, F(SVE),           "addvl sp, sp, #-2"},
+    {0x8540C000, F(SVE),           "ld1rw {z0.s}, p0/z, [x0]"},
+    {0x85C04000, F(SVE),           "prfw pldl1keep, p0, [x0]"},
+    {0x04A14000, F(SVE),           "index z0.s, #0, #1"},
+    {0x05A03800, F(SVE),           "dup z0.s, w0"},
+    {0x05A2C020, F(SVE),           "sel z0.s, p0, z1.s, z2.s"},
+
+    // Armv8.0 instructions, without requirement.
+    {0x8B020020, NONE,             "add x0, x1, x2"},
+    {0xF9400020, NONE,             "ldr x0, [x1]"},
+    {0x4E22CC20, NONE,             "fmla v0.4s, v1.4s, v2.4s"},
+    {0x1E222820, NONE,             "fadd s0, s1, s2"},
+    {0xC85FFC20, NONE,             "ldaxr x0, [x1]"},
+    {0xC89FFC20, NONE,             "stlr x0, [x1]"},
+    {0x88DFFC20, NONE,             "ldar w0, [x1]"},
+    {0xC87F0440, NONE,             "ldxp x0, x1, [x2]"},
+    {0xA8C107E0, NONE,             "ldp x0, x1, [sp], #16"},
+    {0x385FF020, NONE,             "ldurb w0, [x1, #-1]"},
+    {0xD53BD040, NONE,             "mrs x0, tpidr_el0"},
+    {0xD50B7B20, NONE,             "dc cvau, x0"},
+    {0xD50B7420, NONE,             "dc zva, x0"},
+    {0xD503233F, NONE,             "paciasp"},
+    {0xD503245F, NONE,             "bti c"},
+    {0x54000040, NONE,             "b.eq #8"},
+    {0xD65F03C0, NONE,             "ret"},
+    {0x4E020020, NONE,             "tbl v0.16b, {v1.16b}, v2.16b"},
+    {0x1E380020, NONE,             "fcvtzs w0, s1"},
+    {0x9E42F420, NONE,             "scvtf d0, x1, #3"},
+    {0x1F420C20, NONE,             "fmadd d0, d1, d2, d3"},
+    {0x4F03F600, NONE,             "fmov v0.4s, #1.0"},
+    {0x6E30C820, NONE,             "fmaxnmv s0, v1.4s"},
+    {0x7E30D820, NONE,             "faddp s0, v1.2s"},
+    {0x4F3DFC20, NONE,             "fcvtzs v0.4s, v1.4s, #3"},
+    {0x4FA29020, NONE,             "fmul v0.4s, v1.4s, v2.s[1]"},
+    {0x6EA2B420, NONE,             "sqrdmulh v0.4s, v1.4s, v2.4s"},
+    {0x6E021820, NONE,             "ext v0.16b, v1.16b, v2.16b, #3"},
+    {0x2EA2C020, NONE,             "umull v0.2d, v1.2s, v2.2s"},
+    {0x0E22E020, NONE,             "pmull v0.8h, v1.8b, v2.8b"},
+    };
+
+    constexpr size_t NOT_FOUND = ~size_t(0);
+
+    // Index of the first group in EncodingTable which matches an instruction.
+    constexpr size_t FirstMatch(uint32_t insn)
+    {
+        for (size_t i = 0; i < std::size(EncodingTable); ++i) {
+            if ((insn & EncodingTable[i].mask) == EncodingTable[i].value) {
+                return i;
+            }
+        }
+        return NOT_FOUND;
+    }
+
+    // Index of the first group which can never match, NOT_FOUND if none.
+    constexpr size_t UnreachableGroup()
+    {
+        for (size_t i = 0; i < std::size(EncodingTable); ++i) {
+            if ((EncodingTable[i].value & ~EncodingTable[i].mask) != 0 || FirstMatch(EncodingTable[i].value) != i) {
+                return i;
+            }
+        }
+        return NOT_FOUND;
+    }
+
+    // Index of the first sample which is decoded to the wrong feature, NOT_FOUND if none.
+    constexpr size_t WrongKnownEncoding()
+    {
+        for (size_t i = 0; i < std::size(KnownEncodings); ++i) {
+            const size_t match = FirstMatch(KnownEncodings[i].insn);
+            const FeatureId feature = match == NOT_FOUND ? NONE : EncodingTable[match].feature;
+            if (feature != KnownEncodings[i].feature) {
+                return i;
+            }
+        }
+        return NOT_FOUND;
+    }
+
+    // On failure, the compiler displays the index of the faulty entry.
+    static_assert(UnreachableGroup() == NOT_FOUND, "unreachable group in EncodingTable");
+    static_assert(WrongKnownEncoding() == NOT_FOUND, "sample instruction with wrong feature in KnownEncodings");
+}
+
+
+//----------------------------------------------------------------------------
+// Index of the table by the 11 most significant bits of the instruction.
+//----------------------------------------------------------------------------
+
+namespace {
+    constexpr int      INDEX_SHIFT = 21;
+    constexpr uint32_t INDEX_SIZE = 1 << (32 - INDEX_SHIFT);
+
+    class EncodingIndex
+    {
+    public:
+        EncodingIndex();
+        std::vector<uint16_t> first {};    // per index: first position in entries
+        std::vector<uint16_t> entries {};  // indexes in EncodingTable, in table order
+    };
+
+    EncodingIndex::EncodingIndex() :
+        first(INDEX_SIZE + 1)
+    {
+        for (uint32_t top = 0; top < INDEX_SIZE; ++top) {
+            first[top] = uint16_t(entries.size());
+            const uint32_t bits = top << INDEX_SHIFT;
+            for (size_t i = 0; i < std::size(EncodingTable); ++i) {
+                const uint32_t mask = EncodingTable[i].mask & (~0u << INDEX_SHIFT);
+                if ((bits & mask) == (EncodingTable[i].value & mask)) {
+                    entries.push_back(uint16_t(i));
+                }
+            }
+        }
+        first[INDEX_SIZE] = uint16_t(entries.size());
+    }
+}
+
+const InstructionFeatures::Encoding* InstructionFeatures::find(uint32_t insn)
+{
+    // Thread-safe initialization, on first use.
+    static const EncodingIndex index;
+
+    const uint32_t top = insn >> INDEX_SHIFT;
+    for (size_t i = index.first[top]; i < index.first[top + 1]; ++i) {
+        const Encoding& enc(EncodingTable[index.entries[i]]);
+        if ((insn & enc.mask) == enc.value) {
+            return enc.feature == NONE ? nullptr : &enc;
+        }
+    }
+    return nullptr;
+}
+
+const InstructionFeatures::Encoding* InstructionFeatures::table(size_t& count)
+{
+    count = std::size(EncodingTable);
+    return EncodingTable;
+}
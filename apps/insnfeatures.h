@@ -0,0 +1,50 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Arm features which are required by AArch64 instructions.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include "featureset.h"
+#include <cstdint>
+
+//
+// Arm features which are required by AArch64 instructions.
+//
+// The instructions are identified by groups of encodings, as a mask and a value,
+// following the classes of instructions in docs/instructions.md. Only the
+// instructions which raise an undefined instruction exception (SIGILL) at EL0
+// when the feature is not implemented are listed. The instructions of Armv8.0
+// with FP and AdvSIMD, and the instructions in the hint space (BTI, PACIASP,
+// etc.), are not listed. The feature is FeatureId::COUNT for these instructions.
+//
+class InstructionFeatures
+{
+public:
+    // An encoding group in the table.
+    struct Encoding {
+        uint32_t    mask;
+        uint32_t    value;
+        FeatureId   feature;  // FeatureId::COUNT for an instruction without requirement
+        const char* name;     // instruction or class of instructions
+    };
+
+    // Find the encoding group of an instruction. Return nullptr if the instruction
+    // does not require any feature or is not a known instruction.
+    static const Encoding* find(uint32_t insn);
+
+    // Get the feature which is required by an instruction, FeatureId::COUNT if none.
+    static FeatureId feature(uint32_t insn)
+    {
+        const Encoding* enc = find(insn);
+        return enc == nullptr ? FeatureId::COUNT : enc->feature;
+    }
+
+    // Direct access to the table, in decoding order.
+    static const Encoding* table(size_t& count);
+};
@@ -0,0 +1,604 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Linux userland stand-in for the /dev/cpusysregs kernel module, using CUSE
+// (character device in user space). Implements the CSR_IOC_ protocol and
+// serves register values from a snapshot, such as a collect/ directory.
+// Used to test and benchmark applications on systems without the kernel
+// module, including non-Arm systems. Requires root privileges.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "regsnapshot.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <linux/fuse.h>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::string snapshot;
+    std::string devname;
+    std::chrono::microseconds latency;
+    size_t threads;
+    bool verbose;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Syntax: " << command << " [options] snapshot" << std::endl
+              << std::endl
+              << "  snapshot : registers file (sysregs -a, -a -v, --save) or collect/ subdirectory" << std::endl
+              << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -l usec : latency to inject in each command (default: none)" << std::endl
+              << "  -n name : device name (default: " CSR_MODULE_NAME ")" << std::endl
+              << "  -t count : number of server threads (default: 4)" << std::endl
+              << "  -v : verbose, display all commands" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    snapshot(),
+    devname(CSR_MODULE_NAME),
+    latency(0),
+    threads(4),
+    verbose(false)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-l" && i+1 < argc) {
+            latency = std::chrono::microseconds(::atol(argv[++i]));
+        }
+        else if (arg == "-n" && i+1 < argc) {
+            devname = argv[++i];
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            threads = std::max(1L, ::atol(argv[++i]));
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else if (!arg.empty() && arg[0] != '-' && snapshot.empty()) {
+            snapshot = arg;
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+    if (snapshot.empty()) {
+        usage();
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// The CUSE server.
+//----------------------------------------------------------------------------
+
+class Server
+{
+public:
+    // Constructor.
+    Server(const Options& opt, RegSnapshot& snapshot) : _opt(opt), _snapshot(snapshot) {}
+
+    // Register the device. Exit on error.
+    void init();
+
+    // Process requests until the device is removed.
+    void run();
+
+private:
+    // Size of a request buffer, enough for the largest batch.
+    static constexpr size_t MAX_WRITE = 64 * 1024;
+    static constexpr size_t BUFFER_SIZE = MAX_WRITE + 4096;
+
+    const Options&    _opt;
+    RegSnapshot&      _snapshot;
+    std::shared_mutex _mutex {};         // protect the snapshot
+    std::mutex        _log_mutex {};     // serialize verbose messages
+    int               _fd = -1;          // file descriptor on /dev/cuse
+    std::atomic<uint64_t> _calls[_CSR_STAT_END] {};
+    std::atomic<uint64_t> _errors[_CSR_STAT_END] {};
+    std::atomic<uint64_t> _nanoseconds[_CSR_STAT_END] {};
+
+    // Send a reply. Return false if the device was removed.
+    bool reply(uint64_t unique, int error, const void* data1 = nullptr, size_t size1 = 0, const void* data2 = nullptr, size_t size2 = 0);
+
+    // Process an ioctl() request.
+    void ioctl(uint64_t unique, const fuse_ioctl_in& arg, const uint8_t* data, size_t size);
+
+    // Execute an ioctl() command, with all input data. Return a positive error code.
+    int execute(unsigned int cmd, const uint8_t* in, uint8_t* out);
+
+    // Get the type of an ioctl() command in statistics.
+    static int statType(unsigned int cmd);
+
+    // Emulate a PAC instruction, not a real cryptographic PAC.
+    static void emulateInstr(int instr, csr_instr_t& args);
+
+    // Inject latency in a command.
+    void delay() const;
+};
+
+
+//----------------------------------------------------------------------------
+// Register the device.
+//----------------------------------------------------------------------------
+
+void Server::init()
+{
+    if ((_fd = ::open("/dev/cuse", O_RDWR)) < 0) {
+        _opt.fatal("error opening /dev/cuse: " + Error(errno));
+    }
+
+    // The first request is CUSE_INIT.
+    std::vector<uint8_t> buffer(BUFFER_SIZE);
+    const ssize_t size = ::read(_fd, buffer.data(), buffer.size());
+    const fuse_in_header* hdr = reinterpret_cast<const fuse_in_header*>(buffer.data());
+    const cuse_init_in* in = reinterpret_cast<const cuse_init_in*>(hdr + 1);
+    if (size < ssize_t(sizeof(*hdr) + sizeof(*in)) || hdr->opcode != CUSE_INIT) {
+        _opt.fatal("unexpected initial request on /dev/cuse");
+    }
+    if (in->major != FUSE_KERNEL_VERSION) {
+        _opt.fatal(Format("unsupported FUSE protocol %d.%d", in->major, in->minor));
+    }
+
+    // Unrestricted ioctl() are required to read and write the batches in user memory.
+    cuse_init_out out;
+    Zero(&out, sizeof(out));
+    out.major = FUSE_KERNEL_VERSION;
+    out.minor = std::min<uint32_t>(in->minor, FUSE_KERNEL_MINOR_VERSION);
+    out.flags = CUSE_UNRESTRICTED_IOCTL;
+    out.max_read = MAX_WRITE;
+    out.max_write = MAX_WRITE;
+    const std::string info("DEVNAME=" + _opt.devname);
+    if (!reply(hdr->unique, 0, &out, sizeof(out), info.c_str(), info.size() + 1)) {
+        _opt.fatal("error registering the device");
+    }
+
+    // The device node is asynchronously created, make it accessible to all users, like the kernel module.
+    const std::string path("/dev/" + _opt.devname);
+    for (int i = 0; i < 50 && ::chmod(path.c_str(), 0666) < 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    std::cout << _opt.command << ": serving " << path << " with " << _snapshot.size() << " registers" << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// Send a reply.
+//----------------------------------------------------------------------------
+
+bool Server::reply(uint64_t unique, int error, const void* data1, size_t size1, const void* data2, size_t size2)
+{
+    fuse_out_header hdr;
+    hdr.len = uint32_t(sizeof(hdr) + size1 + size2);
+    hdr.error = -error;
+    hdr.unique = unique;
+    ::iovec iov[3] {
+        {&hdr, sizeof(hdr)},
+        {const_cast<void*>(data1), size1},
+        {const_cast<void*>(data2), size2},
+    };
+    // ENOENT means that the request was interrupted, not an error.
+    return ::writev(_fd, iov, 3) >= 0 || errno != ENODEV;
+}
+
+
+//----------------------------------------------------------------------------
+// Process requests until the device is removed.
+//----------------------------------------------------------------------------
+
+void Server::run()
+{
+    std::vector<uint8_t> buffer(BUFFER_SIZE);
+    for (;;) {
+        const ssize_t size = ::read(_fd, buffer.data(), buffer.size());
+        if (size < 0 && (errno == EINTR || errno == ENOENT || errno == EAGAIN)) {
+            continue;
+        }
+        if (size < ssize_t(sizeof(fuse_in_header))) {
+            if (size < 0 && errno != ENODEV) {
+                std::cerr << _opt.command << ": error reading /dev/cuse: " << Error(errno) << std::endl;
+            }
+            break;
+        }
+        const fuse_in_header* hdr = reinterpret_cast<const fuse_in_header*>(buffer.data());
+        const uint8_t* data = buffer.data() + sizeof(*hdr);
+        const size_t data_size = size_t(size) - sizeof(*hdr);
+        bool ok = true;
+
+        switch (hdr->opcode) {
+            case FUSE_OPEN: {
+                fuse_open_out out;
+                Zero(&out, sizeof(out));
+                out.open_flags = FOPEN_DIRECT_IO;
+                ok = reply(hdr->unique, 0, &out, sizeof(out));
+                break;
+            }
+            case FUSE_RELEASE:
+            case FUSE_FLUSH:
+            case FUSE_FSYNC:
+                ok = reply(hdr->unique, 0);
+                break;
+            case FUSE_INTERRUPT:
+                // All commands are short, no reply to interrupts.
+                break;
+            case FUSE_IOCTL:
+                if (data_size < sizeof(fuse_ioctl_in)) {
+                    ok = reply(hdr->unique, EINVAL);
+                }
+                else {
+                    const fuse_ioctl_in* arg = reinterpret_cast<const fuse_ioctl_in*>(data);
+                    ioctl(hdr->unique, *arg, data + sizeof(*arg), data_size - sizeof(*arg));
+                }
+                break;
+            default:
+                // Like the kernel module, read() and write() are not supported.
+                ok = reply(hdr->unique, ENOSYS);
+                break;
+        }
+        if (!ok) {
+            break;
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Process an ioctl() request.
+//----------------------------------------------------------------------------
+
+// Unrestricted ioctl() protocol: The kernel does not know the data to transfer.
+// The first request has no data. The server replies with FUSE_IOCTL_RETRY and
+// the list of memory areas to read (in) and write (out) in the user process.
+// The kernel sends the request again with the input data. For batches, there
+// are two retries: the first one reads the batch header, the second one reads
+// and writes the entries.
+
+void Server::ioctl(uint64_t unique, const fuse_ioctl_in& arg, const uint8_t* data, size_t size)
+{
+    const unsigned int cmd = arg.cmd;
+    std::vector<fuse_ioctl_iovec> in_iovs;
+    std::vector<fuse_ioctl_iovec> out_iovs;
+    const int regid = csr_ioc_to_regid(cmd);
+
+    if (cmd == CSR_IOC_GET_SREGS || cmd == CSR_IOC_INSTRS) {
+        const bool sregs = cmd == CSR_IOC_GET_SREGS;
+        const size_t hsize = sregs ? sizeof(csr_sreg_batch_t) : sizeof(csr_instr_batch_t);
+        const size_t esize = sregs ? sizeof(csr_sreg_t) : sizeof(csr_instr_t);
+        in_iovs.push_back({arg.arg, hsize});
+        if (size >= hsize) {
+            const csr_u64_t count = sregs ? reinterpret_cast<const csr_sreg_batch_t*>(data)->count : reinterpret_cast<const csr_instr_batch_t*>(data)->count;
+            const csr_u64_t entries = sregs ? reinterpret_cast<const csr_sreg_batch_t*>(data)->entries : reinterpret_cast<const csr_instr_batch_t*>(data)->entries;
+            if (count > (sregs ? CSR_SREG_BATCH_MAX : CSR_INSTR_BATCH_MAX)) {
+                reply(unique, EINVAL);
+                return;
+            }
+            if (count > 0) {
+                in_iovs.push_back({entries, count * esize});
+                out_iovs.push_back({entries, count * esize});
+            }
+        }
+    }
+    else if (cmd == CSR_IOC_GET_SREG) {
+        in_iovs.push_back({arg.arg, sizeof(csr_sreg_t)});
+        out_iovs.push_back({arg.arg, sizeof(csr_sreg_t)});
+    }
+    else if (cmd == CSR_IOC_GET_STATS) {
+        in_iovs.push_back({arg.arg, sizeof(csr_stats_t)});
+        out_iovs.push_back({arg.arg, sizeof(csr_stats_t)});
+    }
+    else if (csr_ioc_to_instr(cmd) != CSR_INSTR_INVALID) {
+        in_iovs.push_back({arg.arg, sizeof(csr_instr_t)});
+        out_iovs.push_back({arg.arg, sizeof(csr_instr_t)});
+    }
+    else if (csr_regid_is_valid(regid)) {
+        const size_t rsize = csr_regid_is_pair(regid) ? sizeof(csr_pair_t) : sizeof(csr_u64_t);
+        if (_IOC_SIZE(cmd) != rsize) {
+            reply(unique, EPROTO);
+            return;
+        }
+        if (_IOC_DIR(cmd) == _IOC_READ) {
+            out_iovs.push_back({arg.arg, rsize});
+        }
+        else if (_IOC_DIR(cmd) == _IOC_WRITE) {
+            in_iovs.push_back({arg.arg, rsize});
+        }
+    }
+    else if (cmd != CSR_IOC_RESET_STATS) {
+        reply(unique, EINVAL);
+        return;
+    }
+
+    // Compute the total data sizes. Retry when the kernel did not send enough data.
+    size_t in_size = 0, out_size = 0;
+    for (const auto& iov : in_iovs) {
+        in_size += iov.len;
+    }
+    for (const auto& iov : out_iovs) {
+        out_size += iov.len;
+    }
+    if (size < in_size || arg.out_size < out_size) {
+        fuse_ioctl_out out;
+        Zero(&out, sizeof(out));
+        out.flags = FUSE_IOCTL_RETRY;
+        out.in_iovs = uint32_t(in_iovs.size());
+        out.out_iovs = uint32_t(out_iovs.size());
+        std::vector<fuse_ioctl_iovec> iovs(in_iovs);
+        iovs.insert(iovs.end(), out_iovs.begin(), out_iovs.end());
+        reply(unique, 0, &out, sizeof(out), iovs.data(), iovs.size() * sizeof(fuse_ioctl_iovec));
+        return;
+    }
+
+    // All data are available, execute the command. Batch entries follow the header in input data.
+    // The output data are the command argument or the batch entries.
+    const size_t entries_offset = in_iovs.size() > 1 ? in_iovs[0].len : 0;
+    std::vector<uint8_t> out_data(out_size);
+    if (in_size > 0 && out_size > 0) {
+        ::memcpy(out_data.data(), data + entries_offset, out_size);
+    }
+
+    const int type = statType(cmd);
+    const auto start = std::chrono::steady_clock::now();
+    const int error = execute(cmd, data, out_data.data());
+    delay();
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    if (cmd != CSR_IOC_GET_STATS && cmd != CSR_IOC_RESET_STATS) {
+        _calls[type]++;
+        _nanoseconds[type] += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        if (error != 0) {
+            _errors[type]++;
+        }
+    }
+    if (_opt.verbose) {
+        std::lock_guard<std::mutex> lock(_log_mutex);
+        std::cerr << Format("ioctl 0x%08X, in: %zu bytes, out: %zu bytes, status: %d", cmd, in_size, out_size, error) << std::endl;
+    }
+
+    // Like the kernel module, the output data are returned, even with an error.
+    fuse_ioctl_out out;
+    Zero(&out, sizeof(out));
+    out.result = -error;
+    reply(unique, 0, &out, sizeof(out), out_data.data(), out_data.size());
+}
+
+
+//----------------------------------------------------------------------------
+// Execute an ioctl() command.
+//----------------------------------------------------------------------------
+
+int Server::execute(unsigned int cmd, const uint8_t* in, uint8_t* out)
+{
+    const int regid = csr_ioc_to_regid(cmd);
+    const int instr = csr_ioc_to_instr(cmd);
+
+    if (cmd == CSR_IOC_GET_SREG || cmd == CSR_IOC_GET_SREGS) {
+        // Read registers by encoding, out contains the entries.
+        const size_t count = cmd == CSR_IOC_GET_SREG ? 1 : reinterpret_cast<const csr_sreg_batch_t*>(in)->count;
+        csr_sreg_t* regs = reinterpret_cast<csr_sreg_t*>(out);
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        for (size_t i = 0; i < count; ++i) {
+            regs[i].value = 0;
+            if (!csr_sreg_is_valid(regs[i].sreg)) {
+                regs[i].status = CSR_SREG_INVALID;
+            }
+            else {
+                regs[i].status = _snapshot.getSysReg(regs[i].sreg, regs[i].value) ? CSR_SREG_OK : CSR_SREG_UNDEFINED;
+            }
+        }
+        if (cmd == CSR_IOC_GET_SREG) {
+            return regs[0].status == CSR_SREG_OK ? 0 : (regs[0].status == CSR_SREG_INVALID ? EINVAL : EIO);
+        }
+        return 0;
+    }
+    else if (cmd == CSR_IOC_INSTRS) {
+        const csr_instr_batch_t* batch = reinterpret_cast<const csr_instr_batch_t*>(in);
+        if (batch->instr == CSR_INSTR_INVALID || batch->instr >= _CSR_INSTR_END) {
+            return EINVAL;
+        }
+        csr_instr_t* args = reinterpret_cast<csr_instr_t*>(out);
+        for (size_t i = 0; i < batch->count; ++i) {
+            emulateInstr(int(batch->instr), args[i]);
+        }
+        return 0;
+    }
+    else if (instr != CSR_INSTR_INVALID) {
+        emulateInstr(instr, *reinterpret_cast<csr_instr_t*>(out));
+        return 0;
+    }
+    else if (cmd == CSR_IOC_GET_STATS) {
+        csr_stats_t* stats = reinterpret_cast<csr_stats_t*>(out);
+        if (stats->cpu != CSR_STATS_ALL_CPUS && stats->cpu != 0) {
+            return EINVAL;
+        }
+        // All statistics are accounted on one single virtual CPU.
+        stats->cpu_count = 1;
+        for (int type = 0; type < _CSR_STAT_END; ++type) {
+            stats->stats[type].calls = _calls[type];
+            stats->stats[type].errors = _errors[type];
+            stats->stats[type].nanoseconds = _nanoseconds[type];
+        }
+        return 0;
+    }
+    else if (cmd == CSR_IOC_RESET_STATS) {
+        for (int type = 0; type < _CSR_STAT_END; ++type) {
+            _calls[type] = _errors[type] = _nanoseconds[type] = 0;
+        }
+        return 0;
+    }
+    else if (_IOC_DIR(cmd) == _IOC_READ) {
+        // Registers which are not in the snapshot are reported as unsupported by the CPU.
+        csr_pair_t reg {0, 0};
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        if (!_snapshot.get(regid, reg)) {
+            return EINVAL;
+        }
+        ::memcpy(out, &reg, csr_regid_is_pair(regid) ? sizeof(reg) : sizeof(reg.low));
+        return 0;
+    }
+    else {
+        // Written registers are updated in the snapshot.
+        csr_pair_t reg {0, 0};
+        ::memcpy(&reg, in, csr_regid_is_pair(regid) ? sizeof(reg) : sizeof(reg.low));
+        std::unique_lock<std::shared_mutex> lock(_mutex);
+        _snapshot.set(regid, reg);
+        return 0;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Get the type of an ioctl() command in statistics.
+//----------------------------------------------------------------------------
+
+int Server::statType(unsigned int cmd)
+{
+    if (cmd == CSR_IOC_GET_SREG || cmd == CSR_IOC_GET_SREGS) {
+        return CSR_STAT_SREG;
+    }
+    else if (cmd == CSR_IOC_INSTRS || csr_ioc_to_instr(cmd) != CSR_INSTR_INVALID) {
+        return CSR_STAT_INSTR;
+    }
+    else if (csr_ioc_to_regid(cmd) != CSR_REGID_INVALID) {
+        return _IOC_DIR(cmd) == _IOC_WRITE ? CSR_STAT_SET_REG : CSR_STAT_GET_REG;
+    }
+    else {
+        return CSR_STAT_OTHER;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Emulate a PAC instruction.
+//----------------------------------------------------------------------------
+
+// The snapshot does not contain the PAC keys and the layout of the PAC depends
+// on the configuration of the kernel. We only produce deterministic values which
+// look like PAC's: PACxx insert a hash in bits 54:48, AUTxx clear them.
+
+void Server::emulateInstr(int instr, csr_instr_t& args)
+{
+    // Hash function from splitmix64.
+    csr_u64_t hash = args.value ^ (args.modifier * 0x9E3779B97F4A7C15ull) ^ csr_u64_t(instr);
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    hash ^= hash >> 31;
+
+    const csr_u64_t pac_mask = 0x007F000000000000ull;
+    switch (instr) {
+        case CSR_INSTR_PACIA:
+        case CSR_INSTR_PACIB:
+        case CSR_INSTR_PACDA:
+        case CSR_INSTR_PACDB:
+            args.value = (args.value & ~pac_mask) | (hash & pac_mask);
+            break;
+        case CSR_INSTR_PACGA:
+            args.value = hash & 0xFFFFFFFF00000000ull;
+            break;
+        default:
+            args.value &= ~pac_mask;
+            break;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Inject latency in a command.
+//----------------------------------------------------------------------------
+
+void Server::delay() const
+{
+    // Short delays are busy loops, like the CPU time of a system call.
+    if (_opt.latency >= std::chrono::microseconds(200)) {
+        std::this_thread::sleep_for(_opt.latency);
+    }
+    else if (_opt.latency.count() > 0) {
+        const auto end = std::chrono::steady_clock::now() + _opt.latency;
+        while (std::chrono::steady_clock::now() < end) {
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Options opt(argc, argv);
+
+    // Load the snapshot, from a file or a collect/ subdirectory.
+    RegSnapshot snapshot;
+    std::string error;
+    if (!snapshot.load(opt.snapshot, error)) {
+        opt.fatal(error);
+    }
+    if (snapshot.size() == 0) {
+        opt.fatal("no register found in " + opt.snapshot);
+    }
+
+    // Register the device and serve requests from several threads.
+    Server server(opt, snapshot);
+    server.init();
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < opt.threads; ++i) {
+        threads.emplace_back(&Server::run, &server);
+    }
+    server.run();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return EXIT_SUCCESS;
+}
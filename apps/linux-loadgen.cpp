@@ -0,0 +1,366 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Linux load generator for the kernel module: run an increasing number of
+// threads, pinned on distinct CPU's, which read a register or execute an
+// instruction in a loop. Report the throughput and the latency percentiles.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "regaccess.h"
+#include "regview.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <pthread.h>
+#include <sched.h>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::string register_name;
+    int instr;
+    std::vector<size_t> threads;
+    double duration;
+    bool pin;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -d seconds : duration of each step (default: 2)" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -i instr : execute pacia, pacib, pacda, pacdb, pacga, autia, autib, autda, autdb" << std::endl
+              << "  -n : do not pin threads on CPU's" << std::endl
+              << "  -r name : read the named register (default: MIDR_EL1)" << std::endl
+              << "  -t n,n,... : list of thread counts (default: 1, 2, 4, ... up to CPU count)" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    register_name("MIDR_EL1"),
+    instr(CSR_INSTR_INVALID),
+    threads(),
+    duration(2.0),
+    pin(true)
+{
+    static const std::map<std::string, int> instructions {
+        {"PACIA", CSR_INSTR_PACIA}, {"PACIB", CSR_INSTR_PACIB}, {"PACDA", CSR_INSTR_PACDA},
+        {"PACDB", CSR_INSTR_PACDB}, {"PACGA", CSR_INSTR_PACGA}, {"AUTIA", CSR_INSTR_AUTIA},
+        {"AUTIB", CSR_INSTR_AUTIB}, {"AUTDA", CSR_INSTR_AUTDA}, {"AUTDB", CSR_INSTR_AUTDB},
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-d" && i+1 < argc) {
+            duration = ::atof(argv[++i]);
+            if (duration <= 0) {
+                fatal("invalid duration");
+            }
+        }
+        else if (arg == "-i" && i+1 < argc) {
+            const auto it = instructions.find(ToUpper(argv[++i]));
+            if (it == instructions.end()) {
+                fatal("unknown instruction " + std::string(argv[i]));
+            }
+            instr = it->second;
+        }
+        else if (arg == "-n") {
+            pin = false;
+        }
+        else if (arg == "-r" && i+1 < argc) {
+            register_name = argv[++i];
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            for (const char* p = argv[++i]; *p != '\0'; ) {
+                char* end = nullptr;
+                const unsigned long count = ::strtoul(p, &end, 10);
+                if (end == p || count == 0 || (*end != '\0' && *end != ',')) {
+                    fatal("invalid thread counts");
+                }
+                threads.push_back(count);
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Latency histogram with log-linear buckets: each power of two is split in
+// 16 buckets. The precision is 6% of the value, with a fixed memory size.
+//----------------------------------------------------------------------------
+
+class Histogram
+{
+public:
+    // Add one sample, in nanoseconds.
+    void add(uint64_t ns)
+    {
+        _buckets[index(ns)]++;
+        _count++;
+        _max = std::max(_max, ns);
+    }
+
+    // Merge another histogram.
+    void merge(const Histogram& other)
+    {
+        for (size_t i = 0; i < _buckets.size(); ++i) {
+            _buckets[i] += other._buckets[i];
+        }
+        _count += other._count;
+        _max = std::max(_max, other._max);
+    }
+
+    // Get the value of a percentile (0.0 to 1.0), upper bound of the bucket.
+    uint64_t percentile(double p) const
+    {
+        const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(p * double(_count))));
+        uint64_t sum = 0;
+        for (size_t i = 0; i < _buckets.size(); ++i) {
+            sum += _buckets[i];
+            if (sum >= rank) {
+                return std::min(upper(i), _max);
+            }
+        }
+        return _max;
+    }
+
+    uint64_t count() const { return _count; }
+    uint64_t max() const { return _max; }
+
+private:
+    static constexpr int SUB_BITS = 4;
+    std::array<uint64_t, 64 << SUB_BITS> _buckets {};
+    uint64_t _count = 0;
+    uint64_t _max = 0;
+
+    // Bucket index for a value. Values under 16 have exact buckets.
+    static size_t index(uint64_t ns)
+    {
+        if (ns < (1 << SUB_BITS)) {
+            return size_t(ns);
+        }
+        const int msb = 63 - __builtin_clzll(ns);
+        return (size_t(msb - SUB_BITS + 1) << SUB_BITS) | size_t((ns >> (msb - SUB_BITS)) & ((1 << SUB_BITS) - 1));
+    }
+
+    // Highest value in a bucket.
+    static uint64_t upper(size_t index)
+    {
+        if (index < (1 << SUB_BITS)) {
+            return index;
+        }
+        const int msb = int(index >> SUB_BITS) + SUB_BITS - 1;
+        const uint64_t sub = index & ((1 << SUB_BITS) - 1);
+        return ((uint64_t(1) << msb) | (sub << (msb - SUB_BITS))) + (uint64_t(1) << (msb - SUB_BITS)) - 1;
+    }
+};
+
+
+//----------------------------------------------------------------------------
+// Run one step of the load with a given number of threads.
+//----------------------------------------------------------------------------
+
+// Result of one thread, in distinct cache lines.
+struct alignas(64) ThreadResult
+{
+    Histogram hist;
+    uint64_t  errors = 0;
+};
+
+void RunThread(const Options& opt, int csr_index, int cpu, std::atomic<int>& ready, std::atomic<bool>& stop, ThreadResult& result)
+{
+    // Pin the thread on its CPU before any measurement (cpu is negative when not pinned).
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        const int err = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            std::cerr << opt.command << ": pthread_setaffinity_np: " << Error(err) << std::endl;
+        }
+    }
+
+    // Each thread uses its own file descriptor, as independent applications do.
+    RegAccess regaccess(false, true);
+    csr_pair_t reg {0, 0};
+    csr_instr_t args {0x0123456789ABCDEF, 0xFEDCBA9876543210};
+
+    // Wait for all threads to be started.
+    ready--;
+    while (ready > 0) {
+        std::this_thread::yield();
+    }
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        const auto start = std::chrono::steady_clock::now();
+        const bool ok = opt.instr != CSR_INSTR_INVALID ? regaccess.executeInstr(opt.instr, args) : regaccess.read(csr_index, reg);
+        const auto end = std::chrono::steady_clock::now();
+        result.hist.add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        if (!ok) {
+            result.errors++;
+        }
+    }
+}
+
+void RunStep(const Options& opt, RegAccess& regaccess, int csr_index, const std::vector<int>& cpus, size_t thread_count, std::ostream& out)
+{
+    std::atomic<int> ready(int(thread_count) + 1);
+    std::atomic<bool> stop(false);
+    std::vector<ThreadResult> results(thread_count);
+    std::vector<std::thread> threads;
+
+    // Statistics of the kernel module before the test. Don't reset them, other applications may use them.
+    const int stat_type = opt.instr != CSR_INSTR_INVALID ? CSR_STAT_INSTR : CSR_STAT_GET_REG;
+    csr_stats_t kstats_start, kstats_end;
+    const bool kstats = regaccess.getStats(kstats_start);
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        const int cpu = opt.pin && !cpus.empty() ? cpus[i % cpus.size()] : -1;
+        threads.emplace_back(RunThread, std::cref(opt), csr_index, cpu, std::ref(ready), std::ref(stop), std::ref(results[i]));
+    }
+
+    // Start all threads at the same time, wait for the duration of the step.
+    ready--;
+    while (ready > 0) {
+        std::this_thread::yield();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.duration));
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Merge the results of all threads.
+    Histogram hist;
+    uint64_t errors = 0;
+    for (const auto& res : results) {
+        hist.merge(res.hist);
+        errors += res.errors;
+    }
+
+    // Average time in kernel module, per call.
+    std::string kernel_ns("-");
+    if (kstats && regaccess.getStats(kstats_end)) {
+        const csr_u64_t calls = kstats_end.stats[stat_type].calls - kstats_start.stats[stat_type].calls;
+        const csr_u64_t ns = kstats_end.stats[stat_type].nanoseconds - kstats_start.stats[stat_type].nanoseconds;
+        if (calls > 0) {
+            kernel_ns = Format("%llu", (unsigned long long)(ns / calls));
+        }
+    }
+
+    out << Pad(Format("%zu", thread_count), 7, ' ', false)
+        << Pad(Format("%.0f", double(hist.count()) / seconds), 12, ' ', false)
+        << Pad(Format("%llu", (unsigned long long)errors), 8, ' ', false)
+        << Pad(Format("%llu", (unsigned long long)hist.percentile(0.50)), 9, ' ', false)
+        << Pad(Format("%llu", (unsigned long long)hist.percentile(0.90)), 9, ' ', false)
+        << Pad(Format("%llu", (unsigned long long)hist.percentile(0.99)), 9, ' ', false)
+        << Pad(Format("%llu", (unsigned long long)hist.max()), 10, ' ', false)
+        << Pad(kernel_ns, 10, ' ', false) << std::endl;
+}
+
+
+//----------------------------------------------------------------------------
+// Application entry point
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    Options opt(argc, argv);
+    RegAccess regaccess(false, true);
+
+    // Check the register to read.
+    int csr_index = CSR_REGID_INVALID;
+    if (opt.instr == CSR_INSTR_INVALID) {
+        const auto& desc(RegView::getRegister(opt.register_name));
+        if (!desc.isValid()) {
+            opt.fatal("unknown register " + opt.register_name + ", try sysregs -l");
+        }
+        if (!desc.canRead(regaccess)) {
+            opt.fatal("register " + opt.register_name + " is not readable on this CPU");
+        }
+        csr_index = desc.csr_index;
+    }
+
+    // List of CPU's on which this process can run.
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
+    // Default list of thread counts: 1, 2, 4, ... up to CPU count.
+    if (opt.threads.empty()) {
+        const size_t max = std::max<size_t>(1, cpus.size());
+        for (size_t count = 1; count < max; count *= 2) {
+            opt.threads.push_back(count);
+        }
+        opt.threads.push_back(max);
+    }
+
+    std::cout << "Operation: " << (opt.instr != CSR_INSTR_INVALID ? "execute instruction" : "read " + opt.register_name)
+              << ", " << cpus.size() << " CPU's, " << opt.duration << " s per step" << std::endl
+              << "Latencies in nanoseconds, kernel: average time in kernel module" << std::endl
+              << std::endl
+              << "Threads       Ops/s  Errors      p50      p90      p99       max    kernel" << std::endl
+              << "-------  ----------  ------  -------  -------  -------  --------  --------" << std::endl;
+
+    for (size_t count : opt.threads) {
+        RunStep(opt, regaccess, csr_index, cpus, count, std::cout);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A read-only file, mapped in memory.
+//
+//----------------------------------------------------------------------------
+
+#include "mappedfile.h"
+#include "strutils.h"
+#include <cerrno>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Map a file in memory.
+//----------------------------------------------------------------------------
+
+bool MappedFile::open(const std::string& filename, std::string& error)
+{
+    close();
+
+#if defined(__linux__) || defined(__APPLE__)
+
+    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) < 0) {
+        error = filename + ": " + Error(errno);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    if (st.st_size > 0) {
+        void* base = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+            error = filename + ": " + Error(errno);
+            ::close(fd);
+            return false;
+        }
+        _base = static_cast<const char*>(base);
+        _size = size_t(st.st_size);
+    }
+    ::close(fd);
+
+#elif defined(WINDOWS)
+
+    ::LARGE_INTEGER size;
+    _file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE || !::GetFileSizeEx(_file, &size)) {
+        error = filename + ": " + Error(::GetLastError());
+        close();
+        return false;
+    }
+    if (size.QuadPart > 0) {
+        _mapping = ::CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void* base = _mapping == nullptr ? nullptr : ::MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (base == nullptr) {
+            error = filename + ": " + Error(::GetLastError());
+            close();
+            return false;
+        }
+        _base = static_cast<const char*>(base);
+        _size = size_t(size.QuadPart);
+    }
+
+#endif
+
+    _open = true;
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Unmap the file.
+//----------------------------------------------------------------------------
+
+void MappedFile::close()
+{
+#if defined(__linux__) || defined(__APPLE__)
+    if (_base != nullptr) {
+        ::munmap(const_cast<char*>(_base), _size);
+    }
+#elif defined(WINDOWS)
+    if (_base != nullptr) {
+        ::UnmapViewOfFile(_base);
+    }
+    if (_mapping != nullptr) {
+        ::CloseHandle(_mapping);
+        _mapping = nullptr;
+    }
+    if (_file != INVALID_HANDLE_VALUE) {
+        ::CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+#endif
+    _open = false;
+    _base = nullptr;
+    _size = 0;
+}
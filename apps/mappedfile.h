@@ -0,0 +1,51 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A read-only file, mapped in memory.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <string>
+#include <string_view>
+
+//
+// A read-only file, mapped in memory.
+//
+class MappedFile
+{
+public:
+    // Constructor and destructor.
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    // Forbid copy (keep only one instance per mapping).
+    MappedFile(MappedFile&&) = delete;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map a file in memory. An empty file is successfully open, with a null address.
+    // Return false on error, with an error message.
+    bool open(const std::string& filename, std::string& error);
+    void close();
+    bool isOpen() const { return _open; }
+
+    // Access the file content.
+    const char* data() const { return _base; }
+    size_t size() const { return _size; }
+    std::string_view view() const { return std::string_view(_base, _size); }
+
+private:
+    bool        _open = false;
+    const char* _base = nullptr;  // mapped file content
+    size_t      _size = 0;        // mapped size
+#if defined(WINDOWS)
+    ::HANDLE    _file = INVALID_HANDLE_VALUE;
+    ::HANDLE    _mapping = nullptr;
+#endif
+};
@@ -0,0 +1,249 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A buffered output stream with fast formatting of register values.
+//
+//----------------------------------------------------------------------------
+
+#include "outbuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#if defined(WINDOWS)
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+// Nibble conversion tables.
+static constexpr char HexDigits[] = "0123456789ABCDEF";
+static constexpr char BinDigits[16][4] = {
+    {'0','0','0','0'}, {'0','0','0','1'}, {'0','0','1','0'}, {'0','0','1','1'},
+    {'0','1','0','0'}, {'0','1','0','1'}, {'0','1','1','0'}, {'0','1','1','1'},
+    {'1','0','0','0'}, {'1','0','0','1'}, {'1','0','1','0'}, {'1','0','1','1'},
+    {'1','1','0','0'}, {'1','1','0','1'}, {'1','1','1','0'}, {'1','1','1','1'},
+};
+
+
+//----------------------------------------------------------------------------
+// Constructors.
+//----------------------------------------------------------------------------
+
+OutBuffer::OutBuffer(int fd, size_t size) :
+    _fd(fd),
+    _buffer(new char[std::max<size_t>(size, 256)]),
+    _capacity(std::max<size_t>(size, 256))
+{
+}
+
+OutBuffer::OutBuffer(std::ostream& strm, size_t size) :
+    _strm(&strm),
+    _buffer(new char[std::max<size_t>(size, 256)]),
+    _capacity(std::max<size_t>(size, 256))
+{
+}
+
+
+//----------------------------------------------------------------------------
+// Write data to the output.
+//----------------------------------------------------------------------------
+
+void OutBuffer::write(const char* data, size_t size)
+{
+    if (_failed) {
+        return;
+    }
+    if (_strm != nullptr) {
+        _strm->write(data, std::streamsize(size));
+        _failed = !*_strm;
+        return;
+    }
+    while (size > 0) {
+#if defined(WINDOWS)
+        const int ret = ::_write(_fd, data, unsigned(std::min<size_t>(size, 0x40000000)));
+#else
+        const ssize_t ret = ::write(_fd, data, size);
+#endif
+        if (ret > 0) {
+            data += ret;
+            size -= size_t(ret);
+        }
+        else if (ret < 0 && errno != EINTR) {
+            _failed = true;
+            return;
+        }
+    }
+}
+
+bool OutBuffer::flush()
+{
+    write(_buffer.get(), _size);
+    _size = 0;
+    return !_failed;
+}
+
+bool OutBuffer::reserve(size_t size)
+{
+    if (_size + size > _capacity) {
+        flush();
+    }
+    return size <= _capacity;
+}
+
+
+//----------------------------------------------------------------------------
+// Raw output.
+//----------------------------------------------------------------------------
+
+OutBuffer& OutBuffer::put(char c, size_t count)
+{
+    while (count > 0) {
+        reserve(1);
+        const size_t chunk = std::min(count, _capacity - _size);
+        ::memset(_buffer.get() + _size, c, chunk);
+        _size += chunk;
+        count -= chunk;
+    }
+    return *this;
+}
+
+OutBuffer& OutBuffer::put(std::string_view str)
+{
+    if (reserve(str.size())) {
+        ::memcpy(_buffer.get() + _size, str.data(), str.size());
+        _size += str.size();
+    }
+    else {
+        // Too large for the buffer, write directly.
+        write(str.data(), str.size());
+    }
+    return *this;
+}
+
+OutBuffer& OutBuffer::pad(std::string_view str, size_t width, char pad, bool right)
+{
+    const size_t count = str.size() < width ? width - str.size() : 0;
+    if (!right) {
+        put(pad, count);
+    }
+    put(str);
+    if (right) {
+        put(pad, count);
+    }
+    return *this;
+}
+
+
+//----------------------------------------------------------------------------
+// Integer formatting.
+//----------------------------------------------------------------------------
+
+OutBuffer& OutBuffer::hexa(csr_u64_t value)
+{
+    // Format: XXXXXXXX-XXXXXXXX
+    reserve(17);
+    char* p = _buffer.get() + _size;
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        *p++ = HexDigits[(value >> shift) & 0x0F];
+        if (shift == 32) {
+            *p++ = '-';
+        }
+    }
+    _size += 17;
+    return *this;
+}
+
+OutBuffer& OutBuffer::hexa(const csr_pair_t& value)
+{
+    hexa(value.high);
+    put('-');
+    return hexa(value.low);
+}
+
+OutBuffer& OutBuffer::hexa(csr_u64_t value, int digits)
+{
+    // Same as "0x%0*llX": at least the specified number of digits, more if the value is larger.
+    int count = 1;
+    while (count < 16 && (value >> (4 * count)) != 0) {
+        count++;
+    }
+    count = std::max(count, std::min(digits, 64));
+    reserve(count + 2);
+    char* p = _buffer.get() + _size;
+    *p++ = '0';
+    *p++ = 'x';
+    for (int i = count - 1; i >= 0; --i) {
+        *p++ = i < 16 ? HexDigits[(value >> (4 * i)) & 0x0F] : '0';
+    }
+    _size += count + 2;
+    return *this;
+}
+
+OutBuffer& OutBuffer::binary(csr_u64_t value)
+{
+    // Format: 16 nibbles, separated by spaces, " - " between the two 32-bit halves.
+    reserve(81);
+    char* p = _buffer.get() + _size;
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        ::memcpy(p, BinDigits[(value >> shift) & 0x0F], 4);
+        p += 4;
+        if (shift == 32) {
+            ::memcpy(p, " - ", 3);
+            p += 3;
+        }
+        else if (shift > 0) {
+            *p++ = ' ';
+        }
+    }
+    _size += 81;
+    return *this;
+}
+
+OutBuffer& OutBuffer::decimal(long long value)
+{
+    char digits[24];
+    char* p = digits + sizeof(digits);
+    unsigned long long uvalue = value < 0 ? 0ull - (unsigned long long)(value) : (unsigned long long)(value);
+    do {
+        *--p = char('0' + uvalue % 10);
+        uvalue /= 10;
+    } while (uvalue != 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    return put(std::string_view(p, size_t(digits + sizeof(digits) - p)));
+}
+
+
+//----------------------------------------------------------------------------
+// Serialization formats.
+//----------------------------------------------------------------------------
+
+OutBuffer& OutBuffer::json(std::string_view str)
+{
+    put('"');
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            put('\\').put(c);
+        }
+        else if ((unsigned char)(c) < 0x20) {
+            put("\\u00").put(HexDigits[(c >> 4) & 0x0F]).put(HexDigits[c & 0x0F]);
+        }
+        else {
+            put(c);
+        }
+    }
+    return put('"');
+}
+
+OutBuffer& OutBuffer::littleEndian(csr_u64_t value, size_t size)
+{
+    for (size_t i = 0; i < size && i < 8; ++i) {
+        put(char(value >> (8 * i)));
+    }
+    return *this;
+}
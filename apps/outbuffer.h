@@ -0,0 +1,98 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A buffered output stream with fast formatting of register values.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <ostream>
+#include <string_view>
+#include <memory>
+
+//
+// A buffered output stream with fast formatting of register values.
+//
+// The output is written in large chunks to a file descriptor or to a std::ostream.
+// All formatting methods write directly in the buffer, without memory allocation.
+// The buffer is flushed when full and by the destructor.
+//
+class OutBuffer
+{
+public:
+    // Default size of the buffer.
+    static constexpr size_t DEFAULT_SIZE = 64 * 1024;
+
+    // Size of a short-lived buffer, for a few lines on a std::ostream.
+    static constexpr size_t SMALL_SIZE = 1024;
+
+    // File descriptor of the standard output.
+    static constexpr int STDOUT = 1;
+
+    // Constructors and destructor.
+    OutBuffer(int fd, size_t size = DEFAULT_SIZE);
+    OutBuffer(std::ostream& strm, size_t size = DEFAULT_SIZE);
+    ~OutBuffer() { flush(); }
+
+    // Forbid copy.
+    OutBuffer(OutBuffer&&) = delete;
+    OutBuffer(const OutBuffer&) = delete;
+    OutBuffer& operator=(OutBuffer&&) = delete;
+    OutBuffer& operator=(const OutBuffer&) = delete;
+
+    // Write all buffered data. Return false on output error.
+    // After an output error, all subsequent output is dropped.
+    bool flush();
+
+    // Check if an output error occurred.
+    bool failed() const { return _failed; }
+
+    // Raw output.
+    OutBuffer& put(char c) { if (_size >= _capacity) { flush(); } _buffer[_size++] = c; return *this; }
+    OutBuffer& put(char c, size_t count);
+    OutBuffer& put(std::string_view str);
+    OutBuffer& endl() { return put('\n'); }
+
+    // Output a string, padded to a given width. Same semantics as Pad() in strutils.h.
+    OutBuffer& pad(std::string_view str, size_t width, char pad = '.', bool right = true);
+
+    // Same formats as ToHexa() and ToBinary() in strutils.h.
+    OutBuffer& hexa(csr_u64_t value);
+    OutBuffer& hexa(const csr_pair_t& value);
+    OutBuffer& binary(csr_u64_t value);
+
+    // Hexadecimal value with a given number of digits and a "0x" prefix, "0x%0*llX".
+    OutBuffer& hexa(csr_u64_t value, int digits);
+
+    // Decimal value, "%lld".
+    OutBuffer& decimal(long long value);
+
+    // JSON string, with quotes and escaped characters.
+    OutBuffer& json(std::string_view str);
+
+    // Binary integer in little endian representation, size in bytes (up to 8).
+    OutBuffer& littleEndian(csr_u64_t value, size_t size);
+
+    // Stream-like output of strings and characters.
+    OutBuffer& operator<<(std::string_view str) { return put(str); }
+    OutBuffer& operator<<(const char* str) { return put(std::string_view(str)); }
+    OutBuffer& operator<<(char c) { return put(c); }
+
+private:
+    int                     _fd = -1;           // output file descriptor
+    std::ostream*           _strm = nullptr;    // or output stream
+    std::unique_ptr<char[]> _buffer;
+    size_t                  _capacity = 0;
+    size_t                  _size = 0;
+    bool                    _failed = false;
+
+    // Make sure that size bytes are available in the buffer. Return false if too large for the buffer.
+    bool reserve(size_t size);
+
+    // Write data to the output.
+    void write(const char* data, size_t size);
+};
@@ -10,7 +10,9 @@
 
 #include "regaccess.h"
 #include "strutils.h"
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 
 #if defined(__linux__)
@@ -283,3 +285,115 @@ bool RegAccess::executeInstr(int instr, csr_instr_t& args)
 #endif
     return true;
 }
+
+bool RegAccess::executeInstrs(int instr, csr_instr_t* args, size_t count)
+{
+#if defined(__linux__)
+    while (count > 0) {
+        csr_instr_batch_t batch;
+        batch.instr = csr_u64_t(instr);
+        batch.count = std::min<size_t>(count, CSR_INSTR_BATCH_MAX);
+        batch.entries = csr_u64_t(uintptr_t(args));
+        if (::ioctl(_fd, CSR_IOC_INSTRS, &batch) < 0) {
+            return setError(errno, "ioctl(INSTRS)");
+        }
+        args += batch.count;
+        count -= batch.count;
+    }
+    return true;
+#else
+    for (size_t i = 0; i < count; ++i) {
+        if (!executeInstr(instr, args[i])) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Read CPU registers using their MRS encoding.
+//----------------------------------------------------------------------------
+
+bool RegAccess::readSysReg(csr_u64_t sreg, csr_u64_t& value)
+{
+    if (!csr_sreg_is_valid(sreg)) {
+        return setError(EINVAL, Format("invalid register encoding 0x%08llX", (unsigned long long)sreg));
+    }
+#if defined(__linux__)
+    csr_sreg_t reg {sreg, 0, CSR_SREG_OK};
+    if (::ioctl(_fd, CSR_IOC_GET_SREG, &reg) < 0) {
+        return setError(errno, "ioctl(GET_SREG)");
+    }
+    value = reg.value;
+    if (reg.status == CSR_SREG_DISABLED) {
+        return setError(EPERM, "read by encoding disabled, see module parameter sreg_unsafe (Linux 6.4+)");
+    }
+    else if (reg.status != CSR_SREG_OK) {
+        return setError(ENXIO, "register not accessible");
+    }
+    return true;
+#elif defined(__APPLE__)
+    return setError(ENOTSUP, "read by encoding");
+#elif defined(WINDOWS)
+    return setError(ERROR_NOT_SUPPORTED, "read by encoding");
+#endif
+}
+
+bool RegAccess::readSysRegs(csr_sreg_t* regs, size_t count)
+{
+#if defined(__linux__)
+    // Send batches of no more than CSR_SREG_BATCH_MAX entries.
+    while (count > 0) {
+        csr_sreg_batch_t batch;
+        batch.count = std::min<size_t>(count, CSR_SREG_BATCH_MAX);
+        batch.entries = csr_u64_t(uintptr_t(regs));
+        if (::ioctl(_fd, CSR_IOC_GET_SREGS, &batch) < 0) {
+            return setError(errno, "ioctl(GET_SREGS)");
+        }
+        regs += batch.count;
+        count -= batch.count;
+    }
+    return true;
+#elif defined(__APPLE__)
+    return setError(ENOTSUP, "read by encoding");
+#elif defined(WINDOWS)
+    return setError(ERROR_NOT_SUPPORTED, "read by encoding");
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Get or reset the statistics of the kernel module.
+//----------------------------------------------------------------------------
+
+bool RegAccess::getStats(csr_stats_t& stats, csr_u64_t cpu)
+{
+#if defined(__linux__)
+    Zero(&stats, sizeof(stats));
+    stats.cpu = cpu;
+    if (::ioctl(_fd, CSR_IOC_GET_STATS, &stats) < 0) {
+        return setError(errno, "ioctl(GET_STATS)");
+    }
+    return true;
+#elif defined(__APPLE__)
+    return setError(ENOTSUP, "kernel module statistics");
+#elif defined(WINDOWS)
+    return setError(ERROR_NOT_SUPPORTED, "kernel module statistics");
+#endif
+}
+
+bool RegAccess::resetStats()
+{
+#if defined(__linux__)
+    if (::ioctl(_fd, CSR_IOC_RESET_STATS) < 0) {
+        return setError(errno, "ioctl(RESET_STATS)");
+    }
+    return true;
+#elif defined(__APPLE__)
+    return setError(ENOTSUP, "kernel module statistics");
+#elif defined(WINDOWS)
+    return setError(ERROR_NOT_SUPPORTED, "kernel module statistics");
+#endif
+}
@@ -53,6 +53,23 @@ public:
     // Execute a PACxx or AUTxx in kernel mode.
     bool executeInstr(int instr, csr_instr_t& args);
 
+    // Execute the same PACxx or AUTxx in kernel mode on a set of values.
+    // Use one system call per CSR_INSTR_BATCH_MAX values on Linux.
+    bool executeInstrs(int instr, csr_instr_t* args, size_t count);
+
+    // Read one CPU register using its MRS encoding (CSR_SREG value), Linux only.
+    // The register does not need to be known by the kernel module.
+    bool readSysReg(csr_u64_t sreg, csr_u64_t& value);
+
+    // Read a set of CPU registers using their MRS encodings, Linux only.
+    // Return false on global error only. Check the status of each entry.
+    bool readSysRegs(csr_sreg_t* regs, size_t count);
+
+    // Get or reset the statistics of the kernel module, Linux only.
+    // The statistics are global to the kernel module, not specific to this instance.
+    bool getStats(csr_stats_t& stats, csr_u64_t cpu = CSR_STATS_ALL_CPUS);
+    bool resetStats();
+
 private:
 
     // File descriptor, device handle, per system.
@@ -0,0 +1,128 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Bulk decoding of a series of register values into bitfield columns.
+//
+//----------------------------------------------------------------------------
+
+#include "regcolumns.h"
+#include "strutils.h"
+#include <algorithm>
+
+// Number of values which are decoded in a row for all bitfields.
+// The block of input values remains in the cache while decoding all columns.
+static constexpr size_t BLOCK_SIZE = 4096;
+
+
+//----------------------------------------------------------------------------
+// Constructor.
+//----------------------------------------------------------------------------
+
+RegColumns::RegColumns(const RegView::Register& reg) :
+    _reg(reg)
+{
+    for (const auto& bf : reg.fields) {
+        const int width = bf.msb - bf.lsb + 1;
+        _extractors.push_back({&bf, bf.lsb >= 64, bf.lsb % 64, width >= 64 ? ~csr_u64_t(0) : (csr_u64_t(1) << width) - 1});
+    }
+    _columns.resize(_extractors.size());
+    _names.resize(_extractors.size());
+}
+
+size_t RegColumns::findField(std::string_view name) const
+{
+    const std::string uname(ToUpper(std::string(name)));
+    size_t index = 0;
+    while (index < _extractors.size() && ToUpper(std::string(_extractors[index].field->name)) != uname) {
+        index++;
+    }
+    return index;
+}
+
+
+//----------------------------------------------------------------------------
+// Decode a series of register values.
+//----------------------------------------------------------------------------
+
+void RegColumns::extract(const Extractor& ext, const csr_u64_t* low, const csr_u64_t* high, size_t count, csr_u64_t* out)
+{
+    const csr_u64_t* in = ext.high ? high : low;
+    if (in == nullptr) {
+        std::fill(out, out + count, 0);
+        return;
+    }
+    // Keep this loop simple enough to be vectorized.
+    const int shift = ext.shift;
+    const csr_u64_t mask = ext.mask;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = (in[i] >> shift) & mask;
+    }
+}
+
+void RegColumns::decode(const csr_u64_t* low, const csr_u64_t* high, size_t count)
+{
+    _size = count;
+    for (auto& col : _columns) {
+        col.resize(count);
+    }
+    for (size_t start = 0; start < count; start += BLOCK_SIZE) {
+        const size_t size = std::min(BLOCK_SIZE, count - start);
+        for (size_t f = 0; f < _extractors.size(); ++f) {
+            extract(_extractors[f], low + start, high == nullptr ? nullptr : high + start, size, _columns[f].data() + start);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Get the name of a decoded value.
+//----------------------------------------------------------------------------
+
+std::string_view RegColumns::name(size_t field_index, csr_u64_t code) const
+{
+    const Extractor& ext(_extractors[field_index]);
+    const RegView::BitField& bf(*ext.field);
+    if (bf.values.empty() || bf.msb - bf.lsb + 1 > NAME_TABLE_BITS) {
+        return bf.findName(code);
+    }
+    std::vector<std::string_view>& names(_names[field_index]);
+    if (names.empty()) {
+        names.resize(size_t(ext.mask) + 1, "reserved");
+        // Reverse order: the first name wins for duplicate values, as in findName().
+        for (auto nm = bf.values.end(); nm != bf.values.begin(); ) {
+            --nm;
+            if (nm->value <= ext.mask) {
+                names[nm->value] = nm->name;
+            }
+        }
+    }
+    return names[code & ext.mask];
+}
+
+
+//----------------------------------------------------------------------------
+// Display the bitfields of one decoded value.
+//----------------------------------------------------------------------------
+
+void RegColumns::display(OutBuffer& out, size_t index) const
+{
+    const size_t name_width = _reg.fieldsNameWidth();
+    for (size_t f = 0; f < _extractors.size(); ++f) {
+        const RegView::BitField& bf(*_extractors[f].field);
+        const csr_u64_t value = _columns[f][index];
+        out << "  " << bf.name << ":";
+        out.put(' ', name_width - bf.name.length() + 1);
+        out.hexa(value, (bf.msb - bf.lsb) / 4 + 1) << " (";
+        if (bf.values.empty()) {
+            out.decimal((long long)(value));
+        }
+        else {
+            out << name(f, value);
+        }
+        out << ")";
+        out.endl();
+    }
+}
@@ -0,0 +1,83 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Bulk decoding of a series of register values into bitfield columns.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include "regview.h"
+#include "outbuffer.h"
+#include <string_view>
+#include <vector>
+
+//
+// Bulk decoding of a series of values of one register, typically a large
+// number of samples of the same register, into one column per bitfield.
+//
+// This is the columnar equivalent of RegView::Register::display(). The shift
+// and mask of each bitfield are computed once. Each column is decoded in a
+// separate loop without branch, which the compiler can vectorize. The value
+// names are not resolved during decoding: a decoded bitfield value is also the
+// code of its name, which is looked up only when required.
+//
+class RegColumns
+{
+public:
+    // Precomputed extraction of one bitfield.
+    struct Extractor {
+        const RegView::BitField* field;  // bitfield description
+        bool      high;                  // the bitfield is in the high part of a pair
+        int       shift;                 // right shift in the 64-bit part
+        csr_u64_t mask;                  // mask after shift
+    };
+
+    // Constructor, for a given register description.
+    RegColumns(const RegView::Register& reg);
+
+    // Register description and its bitfields.
+    const RegView::Register& reg() const { return _reg; }
+    size_t fieldCount() const { return _extractors.size(); }
+    const RegView::BitField& field(size_t field_index) const { return *_extractors[field_index].field; }
+    const Extractor& extractor(size_t field_index) const { return _extractors[field_index]; }
+
+    // Find a bitfield by name (case insensitive), return its index or fieldCount().
+    size_t findField(std::string_view name) const;
+
+    // Decode a series of register values. The previous content is replaced.
+    // For a pair of registers, 'high' contains the high parts. When null,
+    // the high parts are zero.
+    void decode(const csr_u64_t* low, const csr_u64_t* high, size_t count);
+    void decode(const std::vector<csr_u64_t>& values) { decode(values.data(), nullptr, values.size()); }
+
+    // Decode one bitfield only from a series of register values.
+    static void extract(const Extractor& ext, const csr_u64_t* low, const csr_u64_t* high, size_t count, csr_u64_t* out);
+
+    // Number of decoded values.
+    size_t size() const { return _size; }
+
+    // Column of decoded values of a bitfield. Each value is also the code of its name.
+    const std::vector<csr_u64_t>& column(size_t field_index) const { return _columns[field_index]; }
+
+    // Get the name of a decoded value, same as RegView::BitField::findName().
+    // The names of narrow bitfields are resolved by a table which is built on first use.
+    // Not thread-safe: concurrent calls on the same instance must be serialized.
+    std::string_view name(size_t field_index, csr_u64_t code) const;
+
+    // Display the bitfields of one decoded value, same format as RegView::Register::display().
+    void display(OutBuffer& out, size_t index) const;
+
+private:
+    // Maximum width of bitfields with a name table.
+    static constexpr int NAME_TABLE_BITS = 8;
+
+    const RegView::Register& _reg;
+    std::vector<Extractor> _extractors {};
+    std::vector<std::vector<csr_u64_t>> _columns {};
+    size_t _size = 0;
+    mutable std::vector<std::vector<std::string_view>> _names {};  // built on first use, indexed by code
+};
@@ -0,0 +1,262 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A snapshot of Arm64 system registers values.
+//
+//----------------------------------------------------------------------------
+
+#include "regsnapshot.h"
+#include "regview.h"
+#include "snapfile.h"
+#include "armfeatures.h"
+#include "featureset.h"
+#include "mappedfile.h"
+#include "strutils.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+
+//----------------------------------------------------------------------------
+// Clear the content of the snapshot.
+//----------------------------------------------------------------------------
+
+void RegSnapshot::clear()
+{
+    _regs.clear();
+    _sregs.clear();
+}
+
+
+//----------------------------------------------------------------------------
+// Get a register value.
+//----------------------------------------------------------------------------
+
+bool RegSnapshot::get(int regid, csr_pair_t& value) const
+{
+    const auto it = _regs.find(regid);
+    if (it == _regs.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+bool RegSnapshot::getSysReg(csr_u64_t sreg, csr_u64_t& value) const
+{
+    const auto it = _sregs.find(sreg);
+    if (it == _sregs.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Load a text file.
+//----------------------------------------------------------------------------
+
+bool RegSnapshot::loadText(const std::string& filename, std::string& error)
+{
+    MappedFile file;
+    if (!file.open(filename, error)) {
+        return false;
+    }
+    loadText(file.view());
+    return true;
+}
+
+void RegSnapshot::loadText(std::istream& in)
+{
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    loadText(std::string_view(text));
+}
+
+// Get the next line in a text, without end of line, update the position.
+static std::string_view NextLine(std::string_view text, size_t& pos)
+{
+    const size_t start = pos;
+    const void* eol = ::memchr(text.data() + start, '\n', text.size() - start);
+    size_t end = eol == nullptr ? text.size() : size_t(static_cast<const char*>(eol) - text.data());
+    pos = eol == nullptr ? end : end + 1;
+    if (end > start && text[end - 1] == '\r') {
+        end--;
+    }
+    return text.substr(start, end - start);
+}
+
+void RegSnapshot::loadText(std::string_view text)
+{
+    size_t pos = 0;
+    while (pos < text.size()) {
+        // Register values start at the beginning of a line, bitfields are indented.
+        const std::string_view ln(NextLine(text, pos));
+        if (ln.empty() || ln[0] == ' ' || ln[0] == '\t') {
+            continue;
+        }
+
+        // Format "NAME: binary" ("sysregs -a -v") or "NAME  hexa" ("sysregs -a").
+        std::string_view name, value;
+        const size_t colon = ln.find(':');
+        if (colon != std::string_view::npos) {
+            name = ln.substr(0, colon);
+            value = ln.substr(colon + 1);
+        }
+        else {
+            const size_t space = ln.find_first_of(" \t");
+            if (space == std::string_view::npos) {
+                continue;
+            }
+            name = ln.substr(0, space);
+            value = ln.substr(space);
+        }
+
+        csr_pair_t reg {0, 0};
+        if (colon != std::string_view::npos) {
+            if (!DecodeBinary(reg.low, value)) {
+                continue;
+            }
+            // A pair of registers uses a second indented binary line for the low part.
+            size_t next_pos = pos;
+            const std::string_view next(NextLine(text, next_pos));
+            if (!next.empty() && next[0] == ' ' && DecodeBinary(reg.high, next)) {
+                std::swap(reg.low, reg.high);
+                pos = next_pos;
+            }
+        }
+        else if (!DecodeHexa(reg, value)) {
+            continue;
+        }
+
+        // Store the register if known.
+        const auto& desc(RegView::getRegister(name));
+        csr_u64_t sreg = 0;
+        if (desc.isValid()) {
+            set(desc.csr_index, reg);
+        }
+        else if (RegView::decodeGenericName(std::string(name), sreg)) {
+            setSysReg(sreg, reg.low);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Find all snapshots in a path.
+//----------------------------------------------------------------------------
+
+std::vector<std::string> RegSnapshot::Search(const std::string& path)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    std::vector<std::string> list;
+    if (!fs::is_directory(path, ec) || fs::exists(fs::path(path) / TEXT_FILE, ec) || fs::exists(fs::path(path) / BINARY_FILE, ec)) {
+        list.push_back(path);
+        return list;
+    }
+    for (auto it = fs::recursive_directory_iterator(path, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        const fs::path& file(it->path());
+        if (file.filename() == BINARY_FILE || (file.filename() == TEXT_FILE && !fs::exists(file.parent_path() / BINARY_FILE, ec))) {
+            list.push_back(file.parent_path().string());
+        }
+        else if (file.extension() == ".csrsnap" && it->is_regular_file(ec)) {
+            list.push_back(file.string());
+        }
+    }
+    std::sort(list.begin(), list.end());
+    return list;
+}
+
+std::string RegSnapshot::FileName(const std::string& path)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (!fs::is_directory(path, ec)) {
+        return path;
+    }
+    const fs::path binary(fs::path(path) / BINARY_FILE);
+    return (fs::exists(binary, ec) ? binary : fs::path(path) / TEXT_FILE).string();
+}
+
+
+//----------------------------------------------------------------------------
+// Load a snapshot of any supported format.
+//----------------------------------------------------------------------------
+
+bool RegSnapshot::load(const std::string& path, std::string& error)
+{
+    const std::string filename(FileName(path));
+
+    // Binary snapshot files are identified by their magic number.
+    char magic[sizeof(SnapFile::MAGIC)];
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if (!in) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    if (in.read(magic, sizeof(magic)) && ::memcmp(magic, SnapFile::MAGIC, sizeof(magic)) == 0) {
+        SnapFile file;
+        if (!file.open(filename, error)) {
+            return false;
+        }
+        load(file);
+        return true;
+    }
+    in.close();
+    return loadText(filename, error);
+}
+
+void RegSnapshot::load(const SnapFile& file, size_t cpu_index)
+{
+    clear();
+    for (const auto& reg : file.registers(cpu_index)) {
+        _regs[int(reg.regid)] = csr_pair_t {reg.low, reg.high};
+    }
+    for (const auto& sreg : file.sysRegisters(cpu_index)) {
+        _sregs[sreg.sreg] = sreg.value;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Load the CPU features from the registers in the snapshot.
+//----------------------------------------------------------------------------
+
+void RegSnapshot::getFeatures(ArmFeatures& features) const
+{
+    // Missing registers are considered as zero, meaning "feature not implemented".
+    csr_u64_t values[ArmFeatures::REGISTER_COUNT];
+    for (size_t i = 0; i < ArmFeatures::REGISTER_COUNT; ++i) {
+        csr_pair_t reg {0, 0};
+        get(ArmFeatures::registerId(i), reg);
+        values[i] = reg.low;
+    }
+    features.loadRegisters(values);
+}
+
+bool RegSnapshot::GetFeatures(const std::string& path, FeatureSet& features, std::string& error)
+{
+    const std::string filename(FileName(path));
+    if (std::filesystem::path(filename).extension() == ".csrsnap") {
+        SnapFile file;
+        if (!file.open(filename, error)) {
+            return false;
+        }
+        file.getFeatures(features);
+        return true;
+    }
+    RegSnapshot snap;
+    if (!snap.loadText(filename, error)) {
+        return false;
+    }
+    ArmFeatures feat;
+    snap.getFeatures(feat);
+    features.load(feat);
+    return true;
+}
@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// A snapshot of Arm64 system registers values.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+
+class SnapFile;
+class ArmFeatures;
+class FeatureSet;
+
+//
+// A snapshot of Arm64 system registers values, typically from another system.
+//
+// The registers are identified by their CSR_REGID_ or CSR_REGID2_ index. Registers
+// which are unknown to this project can be stored using their MRS encoding.
+//
+class RegSnapshot
+{
+public:
+    // Names of the register files in a collect/ subdirectory.
+    static constexpr const char* TEXT_FILE = "cpusysregs-registers.txt";
+    static constexpr const char* BINARY_FILE = "cpusysregs-registers.csrsnap";
+
+    // Find all snapshots in a path, sorted by name. A file or a collect/ subdirectory is
+    // one snapshot. Other directories are searched recursively for collect/ subdirectories
+    // and other binary snapshot files (.csrsnap).
+    static std::vector<std::string> Search(const std::string& path);
+
+    // Name of the file of a snapshot. In a collect/ subdirectory, the binary snapshot
+    // file is preferred over the text file.
+    static std::string FileName(const std::string& path);
+
+    // Get the CPU features of a snapshot of any supported format. In a binary snapshot,
+    // a feature is present only if it is present on all CPU's.
+    // Return false on file error, with an error message.
+    static bool GetFeatures(const std::string& path, FeatureSet& features, std::string& error);
+
+    // Clear the content of the snapshot.
+    void clear();
+
+    // Load a text file, as produced by "sysregs -a" or "sysregs -a -v", for instance
+    // the cpusysregs-registers.txt files in the collect directory. Registers with
+    // a generic name (e.g. S3_0_C15_C2_0) are stored by encoding. Unknown register
+    // names are ignored. Return false on file error, with an error message.
+    // The file is mapped in memory and parsed without copy.
+    bool loadText(const std::string& filename, std::string& error);
+    void loadText(std::istream& in);
+    void loadText(std::string_view text);
+
+    // Load a snapshot of any supported format: binary snapshot file (.csrsnap),
+    // text file or collect/ subdirectory (see FileName()).
+    // From a binary snapshot, use the registers of the first CPU.
+    // Return false on file error, with an error message.
+    bool load(const std::string& path, std::string& error);
+
+    // Load the registers of a CPU, by index in an open binary snapshot file.
+    void load(const SnapFile& file, size_t cpu_index = 0);
+
+    // Load the CPU features from the registers in the snapshot.
+    void getFeatures(ArmFeatures& features) const;
+
+    // Number of registers in the snapshot.
+    size_t size() const { return _regs.size() + _sregs.size(); }
+
+    // Get or set a register by CSR_REGID_ or CSR_REGID2_ index.
+    // For individual registers, only the low part of the pair is used.
+    bool get(int regid, csr_pair_t& value) const;
+    void set(int regid, const csr_pair_t& value) { _regs[regid] = value; }
+
+    // Get or set a register by MRS encoding (CSR_SREG value).
+    bool getSysReg(csr_u64_t sreg, csr_u64_t& value) const;
+    void setSysReg(csr_u64_t sreg, csr_u64_t value) { _sregs[sreg] = value; }
+
+    // Direct access to the registers.
+    const std::map<int, csr_pair_t>& registers() const { return _regs; }
+    const std::map<csr_u64_t, csr_u64_t>& sysRegisters() const { return _sregs; }
+
+private:
+    std::map<int, csr_pair_t>      _regs;   // indexed by CSR_REGID_ or CSR_REGID2_
+    std::map<csr_u64_t, csr_u64_t> _sregs;  // indexed by MRS encoding
+};
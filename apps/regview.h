@@ -11,29 +11,66 @@
 #pragma once
 #include "cpusysregs.h"
 #include "regaccess.h"
+#include "outbuffer.h"
 #include <ostream>
 #include <string>
-#include <list>
-#include <map>
+#include <string_view>
+#include <cstdint>
+
+class ArmFeatures;
 
 //
 // A class with static fields to describe Arm64 system registers.
 //
+// All descriptions are constant tables which are generated from regview.def.
+// There is no dynamic initialization and no memory allocation.
+//
 class RegView
 {
 public:
+    // A contiguous range of elements in a constant table.
+    template <typename T>
+    class Range
+    {
+    public:
+        constexpr Range() = default;
+        constexpr Range(const T* first, size_t size) : _first(first), _size(size) {}
+        constexpr const T* begin() const { return _first; }
+        constexpr const T* end() const { return _first + _size; }
+        constexpr size_t size() const { return _size; }
+        constexpr bool empty() const { return _size == 0; }
+    private:
+        const T* _first = nullptr;
+        size_t   _size = 0;
+    };
+
     // Description of one value in a bitfield in a register.
     struct Name {
-        csr_u64_t   value;
-        std::string name;
+        csr_u64_t        value;
+        std::string_view name;
     };
 
     // Description of one bit-field in a register.
     struct BitField {
-        std::string     name;    // bitfield name
-        int             msb;     // most significant bit index
-        int             lsb;     // least significant bit index
-        std::list<Name> values;  // known values, end with a NULL name
+        std::string_view name;    // bitfield name
+        int              msb;     // most significant bit index
+        int              lsb;     // least significant bit index
+        Range<Name>      values;  // known values
+
+        // Extract the value of the bitfield from a register value.
+        csr_u64_t get(const csr_pair_t& reg) const;
+
+        // Get the name of a bitfield value, "reserved" if unknown, decimal value when there is no name.
+        std::string valueName(csr_u64_t value) const;
+
+        // Format a bitfield value in hexadecimal, with the number of digits of the bitfield.
+        std::string hexa(csr_u64_t value) const;
+
+        // Get the name of a bitfield value without allocation, "reserved" if unknown, empty when there is no name.
+        std::string_view findName(csr_u64_t value) const;
+
+        // Output a bitfield value in hexadecimal, followed by its name in parentheses.
+        void display(OutBuffer& out, csr_u64_t value) const;
     };
 
     // Define the properties and condition of existence of a register.
@@ -62,10 +99,10 @@ public:
     class Register
     {
     public:
-        std::string         name;       // register name
+        std::string_view    name;       // register name
         int                 csr_index;  // CSR_REGID_ or CSR_REGID2_ value from cpusysregs.h
         int                 features;   // required features (bit mask)
-        std::list<BitField> fields;     // known bitfields
+        Range<BitField>     fields;     // known bitfields
 
         // Get a string version of the features field.
         std::string featuresList() const;
@@ -83,31 +120,58 @@ public:
         // Display a detailed descriptions of one register value.
         void display(std::ostream& out, csr_u64_t value) const;
         void display(std::ostream& out, const csr_pair_t& value) const;
+        void display(OutBuffer& out, const csr_pair_t& value) const;
+
+        // Display the bitfields which changed between two register values.
+        // Return the number of changed bitfields.
+        size_t displayChanges(std::ostream& out, const csr_pair_t& previous, const csr_pair_t& value) const;
+        size_t displayChanges(OutBuffer& out, const csr_pair_t& previous, const csr_pair_t& value) const;
+
+        // Maximum length of the names of the bitfields.
+        size_t fieldsNameWidth() const;
 
         // Check if the register is supported on this CPU.
+        // Use the ArmFeatures versions when checking many registers, the features are loaded once.
         bool isSupported(RegAccess&) const;
+        bool isSupported(const ArmFeatures&) const;
         bool canRead(RegAccess&) const;
+        bool canRead(const ArmFeatures&) const;
         bool canWrite(RegAccess&) const;
+        bool canWrite(const ArmFeatures&) const;
     };
 
     // This value of 'csr_index' fields indicates an invalid register description.
     static constexpr int INVALID = ~0;
 
     // Descriptions of all known registers.
-    static const std::list<Register> AllRegisters;
+    static const Range<Register> AllRegisters;
 
     // Get the description of register by its csr_index or name (case insensitive).
     static const Register& getRegister(int csr_index);
-    static const Register& getRegister(const std::string& name);
+    static const Register& getRegister(std::string_view name);
+
+    // Decode a generic register name "S<op0>_<op1>_C<n>_C<m>_<op2>" (case insensitive)
+    // into an MRS encoding (CSR_SREG value, Linux and macOS layout).
+    static bool decodeGenericName(const std::string& name, csr_u64_t& sreg);
+
+    // Build the generic name of an MRS encoding.
+    static std::string genericName(csr_u64_t sreg);
 
 private:
     // A dummy empty description.
     static const Register EmptyRegister;
 
-    // Map view of AllRegisters, indexed by CMD_REG_ values and names.
-    static std::map<int, Register> AllRegistersByIndex;
-    static std::map<std::string, Register> AllRegistersByName;
+    // Generated constant tables.
+    struct Tables;
 
-    // Initialize AllRegistersByIndex and AllRegistersByName.
-    static void initializeCache();
+    // Case-insensitive hash of a register name (FNV-1a), same as in build-regview-tables.py.
+    static constexpr char upper(char c) { return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c; }
+    static constexpr uint32_t nameHash(uint32_t seed, std::string_view name)
+    {
+        uint32_t hash = 2166136261u ^ seed;
+        for (char c : name) {
+            hash = (hash ^ uint8_t(upper(c))) * 16777619u;
+        }
+        return hash;
+    }
 };
@@ -0,0 +1,381 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Binary snapshot files of Arm64 system registers (.csrsnap).
+//
+//----------------------------------------------------------------------------
+
+#include "snapfile.h"
+#include "regaccess.h"
+#include "regsnapshot.h"
+#include "featureset.h"
+#include "strutils.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <ctime>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <sys/utsname.h>
+#endif
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+
+static_assert(sizeof(SnapFile::Header) == 256, "invalid SnapFile::Header size");
+static_assert(sizeof(SnapFile::Section) == 24, "invalid SnapFile::Section size");
+static_assert(sizeof(SnapFile::Register) == 24, "invalid SnapFile::Register size");
+static_assert(sizeof(SnapFile::Feature) == 16, "invalid SnapFile::Feature size");
+static_assert(sizeof(SnapFile::SysRegister) == 16, "invalid SnapFile::SysRegister size");
+
+
+//----------------------------------------------------------------------------
+// Create a snapshot file: read the registers of one CPU.
+//----------------------------------------------------------------------------
+
+namespace {
+    // Append structures in a buffer of 64-bit words, return the byte offset.
+    template <typename T>
+    uint64_t Append(std::vector<uint64_t>& buffer, const T* data, size_t count)
+    {
+        static_assert(sizeof(T) % 8 == 0, "structure not 8-byte aligned");
+        const size_t index = buffer.size();
+        buffer.resize(index + count * sizeof(T) / 8);
+        if (count > 0) {
+            ::memcpy(buffer.data() + index, data, count * sizeof(T));
+        }
+        return 8 * index;
+    }
+
+    // Copy a string in a fixed-size nul-terminated field.
+    void CopyString(char* field, size_t size, const std::string& value)
+    {
+        const size_t len = std::min(value.size(), size - 1);
+        ::memcpy(field, value.data(), len);
+        field[len] = '\0';
+    }
+
+    // Sort register entries by regid.
+    bool LessRegister(const SnapFile::Register& r1, const SnapFile::Register& r2)
+    {
+        return r1.regid < r2.regid;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Create a snapshot file from the system registers of the current system.
+//----------------------------------------------------------------------------
+
+bool SnapFile::create(const std::string& filename, std::string& error)
+{
+    RegAccess regaccess;
+    if (!regaccess.isOpen()) {
+        error = "cannot access the kernel module: " + Error(regaccess.lastError());
+        return false;
+    }
+
+    // Read all registers on the current CPU.
+    std::vector<CpuData> cpus;
+    const auto read_cpu = [&regaccess, &cpus](uint32_t cpu) {
+        cpus.emplace_back();
+        CpuData& data(cpus.back());
+        data.cpu = cpu;
+        const ArmFeatures feat(regaccess);
+        feat.saveRegisters(data.features);
+        for (const auto& desc : RegView::AllRegisters) {
+            csr_pair_t reg {0, 0};
+            if (desc.canRead(feat) && regaccess.read(desc.csr_index, reg)) {
+                const bool pair = desc.isPair();
+                data.regs.push_back({uint32_t(desc.csr_index), pair ? uint32_t(PAIR) : 0, reg.low, pair ? reg.high : 0});
+            }
+        }
+        std::sort(data.regs.begin(), data.regs.end(), LessRegister);
+    };
+
+    // Read the registers of all CPU's.
+#if defined(__linux__)
+    // Move the current thread on each CPU, then restore the initial affinity.
+    cpu_set_t initial;
+    CPU_ZERO(&initial);
+    if (::sched_getaffinity(0, sizeof(initial), &initial) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &initial)) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                if (::sched_setaffinity(0, sizeof(set), &set) == 0) {
+                    read_cpu(uint32_t(cpu));
+                }
+            }
+        }
+        ::sched_setaffinity(0, sizeof(initial), &initial);
+    }
+#endif
+    if (cpus.empty()) {
+        read_cpu(ANY_CPU);
+    }
+
+    // Identify the system.
+    std::string host, kernel;
+#if defined(__linux__) || defined(__APPLE__)
+    struct utsname uts;
+    if (::uname(&uts) == 0) {
+        host = uts.nodename;
+        kernel = Format("%s %s %s", uts.sysname, uts.release, uts.version);
+    }
+#elif defined(WINDOWS)
+    char name[MAX_COMPUTERNAME_LENGTH + 1];
+    ::DWORD name_size = sizeof(name);
+    if (::GetComputerNameA(name, &name_size)) {
+        host.assign(name, name_size);
+    }
+    kernel = "Windows";
+#endif
+
+    return write(filename, cpus, host, kernel, int64_t(::time(nullptr)), error);
+}
+
+
+//----------------------------------------------------------------------------
+// Create a snapshot file from the registers of one CPU.
+//----------------------------------------------------------------------------
+
+bool SnapFile::create(const std::string& filename, const RegSnapshot& snapshot, const std::string& host,
+                      const std::string& kernel, int64_t timestamp, std::string& error)
+{
+    // The registers in a RegSnapshot are already sorted by regid.
+    std::vector<CpuData> cpus(1);
+    for (const auto& it : snapshot.registers()) {
+        const bool pair = csr_regid_is_pair(it.first);
+        cpus[0].regs.push_back({uint32_t(it.first), pair ? uint32_t(PAIR) : 0, it.second.low, pair ? it.second.high : 0});
+    }
+    for (const auto& it : snapshot.sysRegisters()) {
+        cpus[0].sregs.push_back({it.first, it.second});
+    }
+    ArmFeatures feat;
+    snapshot.getFeatures(feat);
+    feat.saveRegisters(cpus[0].features);
+    return write(filename, cpus, host, kernel, timestamp, error);
+}
+
+
+//----------------------------------------------------------------------------
+// Write a snapshot file.
+//----------------------------------------------------------------------------
+
+bool SnapFile::write(const std::string& filename, const std::vector<CpuData>& cpus, const std::string& host,
+                     const std::string& kernel, int64_t timestamp, std::string& error)
+{
+    // Build the header.
+    Header header;
+    Zero(&header, sizeof(header));
+    ::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.header_size = sizeof(Header);
+    header.timestamp = timestamp;
+    header.cpu_count = uint32_t(cpus.size());
+    header.section_count = uint32_t(2 * cpus.size());
+    for (const auto& cpu : cpus) {
+        header.section_count += !cpu.sregs.empty();
+    }
+    header.section_offset = sizeof(Header);
+    CopyString(header.host, sizeof(header.host), host);
+    CopyString(header.kernel, sizeof(header.kernel), kernel);
+    if (!cpus.empty()) {
+        for (const auto& reg : cpus.front().regs) {
+            if (reg.regid == CSR_REGID_MIDR_EL1) {
+                header.midr = reg.low;
+            }
+        }
+    }
+
+    // Build the file content: header, section table, sections.
+    std::vector<Section> sections(header.section_count);
+    std::vector<uint64_t> buffer;
+    Append(buffer, &header, 1);
+    Append(buffer, sections.data(), sections.size());
+    Feature features[ArmFeatures::REGISTER_COUNT];
+    size_t next = 0;
+    for (const auto& cpu : cpus) {
+        for (size_t i = 0; i < ArmFeatures::REGISTER_COUNT; ++i) {
+            features[i] = {uint32_t(ArmFeatures::registerId(i)), 0, cpu.features[i]};
+        }
+        sections[next++] = {REGISTERS, cpu.cpu, Append(buffer, cpu.regs.data(), cpu.regs.size()), cpu.regs.size()};
+        sections[next++] = {FEATURES, cpu.cpu, Append(buffer, features, ArmFeatures::REGISTER_COUNT), ArmFeatures::REGISTER_COUNT};
+        if (!cpu.sregs.empty()) {
+            sections[next++] = {SYSREGS, cpu.cpu, Append(buffer, cpu.sregs.data(), cpu.sregs.size()), cpu.sregs.size()};
+        }
+    }
+    header.file_size = 8 * buffer.size();
+    ::memcpy(buffer.data(), &header, sizeof(header));
+    ::memcpy(buffer.data() + sizeof(Header) / 8, sections.data(), sections.size() * sizeof(Section));
+
+    // Write the file.
+    std::ofstream out(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) {
+        error = "cannot create " + filename;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(buffer.data()), std::streamsize(8 * buffer.size()));
+    out.close();
+    if (!out) {
+        error = "error writing " + filename;
+        return false;
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Map a snapshot file in memory.
+//----------------------------------------------------------------------------
+
+bool SnapFile::open(const std::string& filename, std::string& error)
+{
+    close();
+    if (!_file.open(filename, error)) {
+        return false;
+    }
+    _base = _file.data();
+    _size = _file.size();
+
+    // Check the structure of the file.
+    bool valid = _size >= sizeof(Header) &&
+        ::memcmp(header().magic, MAGIC, sizeof(MAGIC)) == 0 &&
+        header().version == VERSION &&
+        header().header_size == sizeof(Header) &&
+        header().file_size == _size &&
+        header().section_offset % 8 == 0 &&
+        header().section_offset <= _size &&
+        header().section_count <= (_size - header().section_offset) / sizeof(Section);
+    if (valid) {
+        size_t cpu_count = 0;
+        for (const auto& sec : sections()) {
+            const size_t entry_size = sec.type == REGISTERS ? sizeof(Register) : (sec.type == FEATURES ? sizeof(Feature) : sizeof(SysRegister));
+            valid = valid && sec.offset % 8 == 0 && sec.offset <= _size && sec.count <= (_size - sec.offset) / entry_size;
+            cpu_count += sec.type == REGISTERS;
+        }
+        valid = valid && cpu_count == header().cpu_count;
+    }
+    if (!valid) {
+        error = filename + ": invalid snapshot file";
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Unmap the snapshot file.
+//----------------------------------------------------------------------------
+
+void SnapFile::close()
+{
+    _file.close();
+    _base = nullptr;
+    _size = 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Access the file structures.
+//----------------------------------------------------------------------------
+
+RegView::Range<SnapFile::Section> SnapFile::sections() const
+{
+    return RegView::Range<Section>(reinterpret_cast<const Section*>(_base + header().section_offset), header().section_count);
+}
+
+const SnapFile::Section* SnapFile::findSection(uint32_t type, size_t cpu_index) const
+{
+    for (const auto& sec : sections()) {
+        if (sec.type == type && cpu_index-- == 0) {
+            return &sec;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t SnapFile::cpuNumber(size_t cpu_index) const
+{
+    const Section* sec = findSection(REGISTERS, cpu_index);
+    return sec == nullptr ? ANY_CPU : sec->cpu;
+}
+
+RegView::Range<SnapFile::Register> SnapFile::registers(size_t cpu_index) const
+{
+    const Section* sec = findSection(REGISTERS, cpu_index);
+    if (sec == nullptr) {
+        return RegView::Range<Register>();
+    }
+    return RegView::Range<Register>(reinterpret_cast<const Register*>(_base + sec->offset), size_t(sec->count));
+}
+
+RegView::Range<SnapFile::SysRegister> SnapFile::sysRegisters(size_t cpu_index) const
+{
+    // The SYSREGS sections are optional, they are found by CPU number, not by index.
+    const Section* regs = findSection(REGISTERS, cpu_index);
+    for (const auto& sec : sections()) {
+        if (regs != nullptr && sec.type == SYSREGS && sec.cpu == regs->cpu) {
+            return RegView::Range<SysRegister>(reinterpret_cast<const SysRegister*>(_base + sec.offset), size_t(sec.count));
+        }
+    }
+    return RegView::Range<SysRegister>();
+}
+
+bool SnapFile::get(int regid, csr_pair_t& value, size_t cpu_index) const
+{
+    const auto regs(registers(cpu_index));
+    const auto it = std::lower_bound(regs.begin(), regs.end(), uint32_t(regid),
+                                     [](const Register& reg, uint32_t id) { return reg.regid < id; });
+    if (it == regs.end() || it->regid != uint32_t(regid)) {
+        return false;
+    }
+    value.low = it->low;
+    value.high = it->high;
+    return true;
+}
+
+bool SnapFile::getFeatures(ArmFeatures& features, size_t cpu_index) const
+{
+    const Section* sec = findSection(FEATURES, cpu_index);
+    if (sec == nullptr) {
+        features.clear();
+        return false;
+    }
+    // The registers are matched by regid. Missing registers are considered as zero,
+    // meaning "feature not implemented", same as in RegSnapshot::getFeatures().
+    const RegView::Range<Feature> entries(reinterpret_cast<const Feature*>(_base + sec->offset), size_t(sec->count));
+    csr_u64_t values[ArmFeatures::REGISTER_COUNT] {};
+    for (size_t i = 0; i < ArmFeatures::REGISTER_COUNT; ++i) {
+        for (const auto& entry : entries) {
+            if (entry.regid == uint32_t(ArmFeatures::registerId(i))) {
+                values[i] = entry.value;
+                break;
+            }
+        }
+    }
+    features.loadRegisters(values);
+    return true;
+}
+
+void SnapFile::getFeatures(FeatureSet& features) const
+{
+    features.clear();
+    for (size_t cpu = 0; cpu < cpuCount(); ++cpu) {
+        ArmFeatures feat;
+        getFeatures(feat, cpu);
+        if (cpu == 0) {
+            features.load(feat);
+        }
+        else {
+            features &= FeatureSet(feat);
+        }
+    }
+}
@@ -0,0 +1,175 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Binary snapshot files of Arm64 system registers (.csrsnap).
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include "regview.h"
+#include "mappedfile.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class RegSnapshot;
+class FeatureSet;
+
+//
+// A binary snapshot file of Arm64 system registers (.csrsnap).
+//
+// The file is designed to be mapped in memory and used without parsing.
+// All structures have a fixed size and are 8-byte aligned. Integers are
+// stored in the native byte order (little endian on all supported systems).
+//
+// File layout:
+// - Header: identification of the system.
+// - Section table: header.section_count entries, at header.section_offset.
+// - Section contents, at the offsets in the section table.
+//
+// There is one REGISTERS and one FEATURES section per CPU. On Linux, the
+// registers are read on each CPU. On other systems, there is only one CPU
+// section, for the CPU on which the snapshot was created (number ANY_CPU).
+// A CPU may also have a SYSREGS section, for the registers which are only
+// known by their MRS encoding (typically converted from another system).
+//
+class SnapFile
+{
+public:
+    // File identification.
+    static constexpr char     MAGIC[8] = {'C', 'S', 'R', 'S', 'N', 'A', 'P', 0};
+    static constexpr uint32_t VERSION = 2;
+    static constexpr uint32_t ANY_CPU = 0xFFFFFFFF;
+
+    // Types of sections.
+    enum : uint32_t {
+        REGISTERS = 1,  // Register entries, sorted by regid.
+        FEATURES  = 2,  // Feature entries, raw values of the feature registers.
+        SYSREGS   = 3,  // SysRegister entries, sorted by encoding, optional.
+    };
+
+    // Flags in a Register entry.
+    enum : uint32_t {
+        PAIR = 0x0001,  // The register is a pair, the high part is valid.
+    };
+
+    // File header, 256 bytes. Strings are nul-terminated.
+    struct Header {
+        char     magic[8];        // MAGIC
+        uint32_t version;         // VERSION
+        uint32_t header_size;     // sizeof(Header)
+        uint64_t file_size;       // total file size in bytes
+        int64_t  timestamp;       // creation time, seconds since 1970-01-01 UTC
+        uint64_t midr;            // MIDR_EL1 of the first CPU
+        uint32_t cpu_count;       // number of REGISTERS sections
+        uint32_t section_count;   // number of entries in the section table
+        uint64_t section_offset;  // file offset of the section table
+        char     host[64];        // host name
+        char     kernel[136];     // operating system name and version
+    };
+
+    // Entry in the section table, 24 bytes.
+    struct Section {
+        uint32_t type;            // REGISTERS, FEATURES, SYSREGS
+        uint32_t cpu;             // logical CPU number or ANY_CPU
+        uint64_t offset;          // file offset of the section content
+        uint64_t count;           // number of entries in the section
+    };
+
+    // Entry in a REGISTERS section, 24 bytes.
+    struct Register {
+        uint32_t regid;           // CSR_REGID_ or CSR_REGID2_ value
+        uint32_t flags;           // PAIR
+        uint64_t low;             // register value or low part of a pair
+        uint64_t high;            // high part of a pair, zero otherwise
+    };
+
+    // Entry in a FEATURES section, 16 bytes. The registers are identified by
+    // regid, the list of feature registers may change in a later version.
+    struct Feature {
+        uint32_t regid;           // CSR_REGID_ value
+        uint32_t reserved;        // zero
+        uint64_t value;           // raw register value, as used by ArmFeatures
+    };
+
+    // Entry in a SYSREGS section, 16 bytes.
+    struct SysRegister {
+        uint64_t sreg;            // MRS encoding, see csr_sreg_t
+        uint64_t value;           // register value
+    };
+
+    // Create a snapshot file from the system registers of the current system.
+    // Return false on error, with an error message.
+    static bool create(const std::string& filename, std::string& error);
+
+    // Create a snapshot file from the registers of one CPU, typically from another system.
+    // The features are computed from the registers. Return false on error, with an error message.
+    static bool create(const std::string& filename, const RegSnapshot& snapshot, const std::string& host,
+                       const std::string& kernel, int64_t timestamp, std::string& error);
+
+    // Constructor and destructor.
+    SnapFile() = default;
+    ~SnapFile() { close(); }
+
+    // Forbid copy (keep only one instance per mapping).
+    SnapFile(SnapFile&&) = delete;
+    SnapFile(const SnapFile&) = delete;
+    SnapFile& operator=(SnapFile&&) = delete;
+    SnapFile& operator=(const SnapFile&) = delete;
+
+    // Map a snapshot file in memory. The structure of the file is checked but not parsed.
+    // Return false on error, with an error message.
+    bool open(const std::string& filename, std::string& error);
+    void close();
+    bool isOpen() const { return _base != nullptr; }
+
+    // Direct access to the file structures. The file must be open.
+    const Header& header() const { return *reinterpret_cast<const Header*>(_base); }
+    RegView::Range<Section> sections() const;
+
+    // Number of CPU's in the snapshot and logical number of a CPU, by index in the file.
+    size_t cpuCount() const { return header().cpu_count; }
+    uint32_t cpuNumber(size_t cpu_index) const;
+
+    // Registers of a CPU, by index in the file, sorted by regid.
+    RegView::Range<Register> registers(size_t cpu_index = 0) const;
+
+    // Registers of a CPU which are only known by their MRS encoding, sorted by encoding.
+    RegView::Range<SysRegister> sysRegisters(size_t cpu_index = 0) const;
+
+    // Get a register of a CPU, by index in the file. Use a binary search.
+    // For individual registers, only the low part of the pair is used.
+    bool get(int regid, csr_pair_t& value, size_t cpu_index = 0) const;
+
+    // Load the CPU features of a CPU, by index in the file.
+    bool getFeatures(ArmFeatures& features, size_t cpu_index = 0) const;
+
+    // Get the CPU features which are present on all CPU's of the file.
+    // A thread can run on any CPU, this is what an application can use.
+    void getFeatures(FeatureSet& features) const;
+
+private:
+    // Content of a snapshot file for one CPU.
+    struct CpuData {
+        uint32_t cpu = ANY_CPU;
+        std::vector<Register> regs {};
+        std::vector<SysRegister> sregs {};
+        csr_u64_t features[ArmFeatures::REGISTER_COUNT] {};
+    };
+
+    // Write a snapshot file.
+    static bool write(const std::string& filename, const std::vector<CpuData>& cpus, const std::string& host,
+                      const std::string& kernel, int64_t timestamp, std::string& error);
+
+    MappedFile  _file {};
+    const char* _base = nullptr;  // mapped file content
+    size_t      _size = 0;        // mapped size
+
+    // Find the section of a given type for a CPU, by index in the file.
+    const Section* findSection(uint32_t type, size_t cpu_index) const;
+};
@@ -0,0 +1,322 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Convert archives of text snapshots, in the collect/ format, into binary
+// snapshot files. The files are mapped in memory and parsed in parallel.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include "featureset.h"
+#include "mappedfile.h"
+#include "regsnapshot.h"
+#include "snapfile.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::vector<std::string> inputs;
+    std::string output_dir;
+    size_t threads;
+    bool check_features;
+    bool verbose;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Syntax: " << command << " [options] path ..." << std::endl
+              << std::endl
+              << "  path : collect/ subdirectory, registers file (sysregs -a or -a -v), or directory," << std::endl
+              << "         recursively searched for collect/ subdirectories" << std::endl
+              << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -c : check the features in cpusysregs-features.txt against the registers" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -o dir : create one binary snapshot file (.csrsnap) per host in this directory" << std::endl
+              << "  -t count : number of parsing threads (default: number of CPU's)" << std::endl
+              << "  -v : verbose, display the parsing throughput" << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    inputs(),
+    output_dir(),
+    threads(std::max(1u, std::thread::hardware_concurrency())),
+    check_features(false),
+    verbose(false)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-c") {
+            check_features = true;
+        }
+        else if (arg == "-o" && i+1 < argc) {
+            output_dir = argv[++i];
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            if ((threads = ::atol(argv[++i])) == 0) {
+                fatal("invalid number of threads");
+            }
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+    if (inputs.empty()) {
+        fatal("no input specified, try --help");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Text parsing utilities.
+//----------------------------------------------------------------------------
+
+// Iterate over all lines in a text, without end of line.
+template <class FUNC>
+void ForEachLine(std::string_view text, FUNC func)
+{
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const void* eol = ::memchr(text.data() + pos, '\n', text.size() - pos);
+        const size_t end = eol == nullptr ? text.size() : size_t(static_cast<const char*>(eol) - text.data());
+        const size_t len = end > pos && text[end - 1] == '\r' ? end - pos - 1 : end - pos;
+        if (!func(text.substr(pos, len))) {
+            return;
+        }
+        pos = end + 1;
+    }
+}
+
+// First and last words in a line.
+std::string_view FirstWord(std::string_view line)
+{
+    const size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+        return std::string_view();
+    }
+    const size_t end = line.find_first_of(" \t", start);
+    return line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+}
+
+std::string_view LastWord(std::string_view line)
+{
+    const size_t end = line.find_last_not_of(" \t");
+    if (end == std::string_view::npos) {
+        return std::string_view();
+    }
+    const size_t start = line.find_last_of(" \t", end);
+    return line.substr(start == std::string_view::npos ? 0 : start + 1, end - (start == std::string_view::npos ? 0 : start + 1) + 1);
+}
+
+
+//----------------------------------------------------------------------------
+// Parse one host in a collect/ subdirectory.
+//----------------------------------------------------------------------------
+
+class Host
+{
+public:
+    fs::path    dir {};              // collect/ subdirectory, if any
+    fs::path    registers_file {};   // registers file
+    std::string messages {};         // errors and warnings
+    size_t      bytes = 0;           // number of parsed bytes
+    bool        success = false;
+
+    // Parse the snapshot, write the binary snapshot if required.
+    void process(const Options& opt);
+};
+
+void Host::process(const Options& opt)
+{
+    std::string error;
+    const std::string name(dir.empty() ? registers_file.stem().string() : dir.filename().string());
+
+    // Registers file.
+    MappedFile file;
+    RegSnapshot snapshot;
+    if (!file.open(registers_file.string(), error)) {
+        messages += error + "\n";
+        return;
+    }
+    snapshot.loadText(file.view());
+    bytes += file.size();
+    if (snapshot.size() == 0) {
+        messages += registers_file.string() + ": no register found\n";
+        return;
+    }
+
+    // The file modification time is the best approximation of the snapshot time.
+    struct stat st;
+    const int64_t timestamp = ::stat(registers_file.string().c_str(), &st) == 0 ? int64_t(st.st_mtime) : 0;
+
+    // The kernel version is in the first section of cpusysregs-system.txt.
+    std::string kernel;
+    if (!dir.empty() && file.open((dir / "cpusysregs-system.txt").string(), error)) {
+        bool underline = false;
+        ForEachLine(file.view(), [&](std::string_view line) {
+            if (underline && !line.empty()) {
+                kernel = line;
+                return false;
+            }
+            underline = underline || line.substr(0, 3) == "---";
+            return true;
+        });
+        bytes += file.size();
+    }
+
+    // Compare the features in cpusysregs-features.txt ("FEAT_xxx ..... yes") with the registers.
+    // A difference means an incomplete registers file or a different version of ArmFeatures.
+    if (opt.check_features && !dir.empty() && file.open((dir / "cpusysregs-features.txt").string(), error)) {
+        ArmFeatures features;
+        snapshot.getFeatures(features);
+        const FeatureSet set(features);
+        ForEachLine(file.view(), [&](std::string_view line) {
+            const std::string_view feat_name(FirstWord(line));
+            const std::string_view value(LastWord(line));
+            FeatureId id;
+            if ((value == "yes" || value == "no") && feat_name != value && FeatureSet::find(feat_name, id) && set.has(id) != (value == "yes")) {
+                messages += Format("%s: %.*s is %.*s in features file, %s from registers\n", name.c_str(),
+                                   int(feat_name.size()), feat_name.data(), int(value.size()), value.data(),
+                                   YesNo(set.has(id)).c_str());
+            }
+            return true;
+        });
+        bytes += file.size();
+    }
+
+    // Write the binary snapshot. The host name is anonymized in collect/ directories, use the directory name.
+    if (!opt.output_dir.empty()) {
+        const std::string out_file((fs::path(opt.output_dir) / (name + ".csrsnap")).string());
+        if (!SnapFile::create(out_file, snapshot, name, kernel, timestamp, error)) {
+            messages += error + "\n";
+            return;
+        }
+    }
+    success = true;
+}
+
+// Search all text snapshots in a path.
+void SearchHosts(const std::string& path, std::vector<Host>& hosts)
+{
+    std::error_code ec;
+    if (!fs::is_directory(path, ec)) {
+        hosts.emplace_back();
+        hosts.back().registers_file = path;
+        return;
+    }
+    for (auto it = fs::recursive_directory_iterator(path, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->path().filename() == "cpusysregs-registers.txt") {
+            hosts.emplace_back();
+            hosts.back().dir = it->path().parent_path();
+            hosts.back().registers_file = it->path();
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point.
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Host> hosts;
+    for (const auto& path : opt.inputs) {
+        SearchHosts(path, hosts);
+    }
+    std::sort(hosts.begin(), hosts.end(), [](const Host& h1, const Host& h2) { return h1.registers_file < h2.registers_file; });
+
+    std::error_code ec;
+    if (!opt.output_dir.empty()) {
+        fs::create_directories(opt.output_dir, ec);
+    }
+
+    // Parse all hosts in parallel.
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(opt.threads, hosts.size()); ++i) {
+        threads.emplace_back([&]() {
+            for (size_t h = next++; h < hosts.size(); h = next++) {
+                hosts[h].process(opt);
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    // Report errors and warnings in input order.
+    size_t success = 0;
+    size_t bytes = 0;
+    for (const auto& host : hosts) {
+        std::cerr << host.messages;
+        success += host.success;
+        bytes += host.bytes;
+    }
+    if (opt.verbose) {
+        const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << Format("%s: %zu hosts, %zu errors, %zu bytes in %.3f s, %.1f MB/s", opt.command.c_str(),
+                            hosts.size(), hosts.size() - success, bytes, sec, sec > 0 ? bytes / sec / 1e6 : 0.0)
+                  << std::endl;
+    }
+    return success == hosts.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -55,10 +55,37 @@ std::string ToBinary(csr_u64_t value)
 
 
 //----------------------------------------------------------------------------
-// Decode hexadecimal strings, return false on invalid input.
+// Decode hexadecimal and binary strings, return false on invalid input.
+// Table-driven: each character is classified with one lookup. Separators are
+// rare, they are searched only for characters which are not digits.
 //----------------------------------------------------------------------------
 
-bool DecodeHexa(csr_u64_t& value, const std::string& hex, const std::string& sep)
+namespace {
+    // Value of each hexadecimal digit, 0xFF for other characters.
+    struct HexTable {
+        uint8_t value[256];
+        constexpr HexTable() : value()
+        {
+            for (int c = 0; c < 256; ++c) {
+                value[c] = c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : (c >= 'A' && c <= 'F' ? c - 'A' + 10 : 0xFF));
+            }
+        }
+    };
+    constexpr HexTable HexValues;
+
+    // Decode 4 characters as a binary nibble, return -1 if they are not all '0' or '1'.
+    inline int BinaryNibble(const char* p)
+    {
+        const uint32_t w = uint32_t(uint8_t(p[0])) | (uint32_t(uint8_t(p[1])) << 8) | (uint32_t(uint8_t(p[2])) << 16) | (uint32_t(uint8_t(p[3])) << 24);
+        if ((w & 0xFEFEFEFE) != 0x30303030) {
+            return -1;
+        }
+        // Gather bits 0, 8, 16, 24 into bits 27, 26, 25, 24 (first character is the most significant).
+        return int((((w & 0x01010101) * 0x08040201) >> 24) & 0x0F);
+    }
+}
+
+bool DecodeHexa(csr_u64_t& value, std::string_view hex, std::string_view sep)
 {
     csr_pair_t pair;
     const bool res = DecodeHexa(pair, hex, sep);
@@ -66,34 +93,47 @@ bool DecodeHexa(csr_u64_t& value, const std::string& hex, const std::string& sep
     return res;
 }
 
-bool DecodeHexa(csr_pair_t& value, const std::string& hex, const std::string& sep)
+bool DecodeHexa(csr_pair_t& value, std::string_view hex, std::string_view sep)
 {
     value.high = value.low = 0;
     bool found = false;
     for (char c : hex) {
-        int nibble = 0;
-        if (c >= '0' && c <= '9') {
-            nibble = c - '0';
+        const uint8_t nibble = HexValues.value[uint8_t(c)];
+        if (nibble != 0xFF) {
+            value.high = (value.high << 4) | (value.low >> 60);
+            value.low = (value.low << 4) | nibble;
             found = true;
         }
-        else if (c >= 'a' && c <= 'f') {
-            nibble = c - 'a' + 10;
-            found = true;
+        else if (sep.find(c) == std::string_view::npos) {
+            return false; // invalid character
         }
-        else if (c >= 'A' && c <= 'F') {
-            nibble = c - 'A' + 10;
-            found = true;
+    }
+    return found;
+}
+
+bool DecodeBinary(csr_u64_t& value, std::string_view bin, std::string_view sep)
+{
+    value = 0;
+    int count = 0;
+    const char* p = bin.data();
+    const char* const end = p + bin.size();
+    while (p < end) {
+        int nibble = 0;
+        if (end - p >= 4 && (nibble = BinaryNibble(p)) >= 0) {
+            // Fast path: groups of 4 digits, as produced by ToBinary().
+            value = (value << 4) | csr_u64_t(nibble);
+            count += 4;
+            p += 4;
         }
-        else if (sep.find(c) != std::string::npos) {
-            continue; // ignore acceptable separator
+        else if (*p == '0' || *p == '1') {
+            value = (value << 1) | csr_u64_t(*p++ - '0');
+            count++;
         }
-        else {
+        else if (sep.find(*p++) == std::string_view::npos) {
             return false; // invalid character
         }
-        value.high = (value.high << 4) | (value.low >> 60);
-        value.low = (value.low << 4) | nibble;
     }
-    return found;
+    return count > 0 && count <= 64;
 }
 
 
@@ -12,6 +12,7 @@
 #include "cpusysregs.h"
 #include <cstring>
 #include <string>
+#include <string_view>
 
 // Zero memory.
 CSR_INLINE void Zero(void* addr, size_t size) { ::memset(addr, 0, size); }
@@ -24,8 +25,11 @@ std::string ToHexa(const csr_pair_t&);
 std::string ToBinary(csr_u64_t);
 
 // Decode hexadecimal strings, return false on invalid input.
-bool DecodeHexa(csr_u64_t&, const std::string&, const std::string& sep = "-_., \t\r\n");
-bool DecodeHexa(csr_pair_t&, const std::string&, const std::string& sep = "-_., \t\r\n");
+bool DecodeHexa(csr_u64_t&, std::string_view, std::string_view sep = "-_., \t\r\n");
+bool DecodeHexa(csr_pair_t&, std::string_view, std::string_view sep = "-_., \t\r\n");
+
+// Decode binary strings, as produced by ToBinary(), return false on invalid input.
+bool DecodeBinary(csr_u64_t&, std::string_view, std::string_view sep = "- \t\r\n");
 
 // Format a C++ string in a printf-way.
 std::string Format(const char* fmt, ...);
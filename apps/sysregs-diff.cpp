@@ -0,0 +1,419 @@
+//----------------------------------------------------------------------------
+//
+// Arm64 CPU system registers tools
+// Copyright (c) 2023, Thierry Lelegard
+// BSD-2-Clause license, see the LICENSE file.
+//
+// Compare snapshots of system registers, bitfield by bitfield.
+//
+//----------------------------------------------------------------------------
+
+#include "cpusysregs.h"
+#include "armfeatures.h"
+#include "featureset.h"
+#include "regaccess.h"
+#include "regsnapshot.h"
+#include "regview.h"
+#include "strutils.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+class Options
+{
+public:
+    // Constructor.
+    Options(int argc, char* argv[]);
+
+    // Command line options.
+    std::string command;
+    std::string baseline;
+    std::vector<std::string> inputs;
+    std::set<int> excluded;
+    size_t threads;
+    bool all;
+    bool list;
+    bool summary;
+
+    // Print help and exits.
+    void usage() const;
+
+    // Print a fatal error and exit.
+    void fatal(const std::string& message) const;
+};
+
+// Registers which differ between boots, processes or CPU's of the same system.
+// They are ignored by default.
+const int VolatileRegisters[] = {
+    CSR_REGID2_APDAKEY_EL1, CSR_REGID2_APDBKEY_EL1, CSR_REGID2_APGAKEY_EL1, CSR_REGID2_APIAKEY_EL1, CSR_REGID2_APIBKEY_EL1,
+    CSR_REGID_CNTPCT_EL0, CSR_REGID_CNTVCT_EL0, CSR_REGID_PMCCNTR_EL0, CSR_REGID_RNDR, CSR_REGID_RNDRRS,
+    CSR_REGID_MPIDR_EL1, CSR_REGID_TPIDRRO_EL0, CSR_REGID_TPIDR_EL0, CSR_REGID_TPIDR_EL1,
+    CSR_REGID_TTBR0_EL1, CSR_REGID_TTBR1_EL1, CSR_REGID_SCXTNUM_EL0, CSR_REGID_SCXTNUM_EL1,
+};
+
+void Options::usage() const
+{
+    std::cerr << std::endl
+              << "Syntax: " << command << " [options] snapshot [snapshot]" << std::endl
+              << "        " << command << " [options] -b baseline path ..." << std::endl
+              << std::endl
+              << "A snapshot is a binary snapshot file (.csrsnap), a registers file (sysregs -a)" << std::endl
+              << "or a collect/ subdirectory. With only one snapshot, it is compared with the" << std::endl
+              << "registers of the current system. With -b, all snapshots in the paths (searched" << std::endl
+              << "recursively in directories) are compared with the baseline. Identical snapshots" << std::endl
+              << "are grouped and each distinct snapshot is compared only once." << std::endl
+              << std::endl
+              << "Command line options:" << std::endl
+              << std::endl
+              << "  -a : compare all registers, including volatile ones (PAC keys, counters, etc.)" << std::endl
+              << "  -b path : baseline snapshot, compare all other snapshots with it" << std::endl
+              << "  -h : display this help text" << std::endl
+              << "  -l : list the snapshots in each group of identical snapshots" << std::endl
+              << "  -s : summary, display the changed registers and features, not the bitfields" << std::endl
+              << "  -t count : number of loading threads (default: number of CPU's)" << std::endl
+              << "  -x name : exclude a register from the comparison, can be repeated" << std::endl
+              << std::endl
+              << "The exit code is zero when all snapshots are identical." << std::endl
+              << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+void Options::fatal(const std::string& message) const
+{
+    std::cerr << command << ": " << message << std::endl;
+    ::exit(EXIT_FAILURE);
+}
+
+Options::Options(int argc, char* argv[]) :
+    command(argc < 1 ? "" : argv[0]),
+    baseline(),
+    inputs(),
+    excluded(),
+    threads(std::max(1u, std::thread::hardware_concurrency())),
+    all(false),
+    list(false),
+    summary(false)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg == "--help" || arg == "-h") {
+            usage();
+        }
+        else if (arg == "-a") {
+            all = true;
+        }
+        else if (arg == "-b" && i+1 < argc) {
+            baseline = argv[++i];
+        }
+        else if (arg == "-l") {
+            list = true;
+        }
+        else if (arg == "-s") {
+            summary = true;
+        }
+        else if (arg == "-t" && i+1 < argc) {
+            if ((threads = ::atol(argv[++i])) == 0) {
+                fatal("invalid number of threads");
+            }
+        }
+        else if (arg == "-x" && i+1 < argc) {
+            const RegView::Register& reg(RegView::getRegister(argv[++i]));
+            if (!reg.isValid()) {
+                fatal(std::string("unknown register ") + argv[i]);
+            }
+            excluded.insert(reg.csr_index);
+        }
+        else if (!arg.empty() && arg[0] != '-') {
+            inputs.push_back(arg);
+        }
+        else {
+            fatal("invalid option '" + arg + "', try --help");
+        }
+    }
+    if (baseline.empty() && (inputs.empty() || inputs.size() > 2)) {
+        fatal("specify one or two snapshots, or a baseline, try --help");
+    }
+    if (!baseline.empty() && inputs.empty()) {
+        fatal("no snapshot to compare with the baseline, try --help");
+    }
+    if (!all) {
+        excluded.insert(std::begin(VolatileRegisters), std::end(VolatileRegisters));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// A snapshot of one system.
+//----------------------------------------------------------------------------
+
+class Snapshot
+{
+public:
+    std::string source {};                // snapshot file or directory, empty for the current system
+    std::string error {};                 // loading error, if any
+    RegSnapshot registers {};             // registers of the first CPU
+    std::vector<csr_u64_t> canonical {};  // canonical form of the compared registers
+    uint64_t hash = 0;                    // hash of the canonical form
+
+    // Load the snapshot and build its canonical form. Return false on error.
+    bool load(const Options& opt);
+
+    // Display name of the snapshot.
+    std::string name() const { return source.empty() ? "current system" : source; }
+};
+
+bool Snapshot::load(const Options& opt)
+{
+    if (!source.empty()) {
+        if (!registers.load(source, error)) {
+            return false;
+        }
+    }
+    else {
+        // Read the registers of the current system.
+        RegAccess regaccess(true, true);
+        const ArmFeatures feat(regaccess);
+        for (const auto& desc : RegView::AllRegisters) {
+            csr_pair_t reg {0, 0};
+            if (desc.canRead(feat) && regaccess.read(desc.csr_index, reg)) {
+                registers.set(desc.csr_index, desc.isPair() ? reg : csr_pair_t {reg.low, 0});
+            }
+        }
+    }
+    if (registers.size() == 0) {
+        error = "no register found in " + name();
+        return false;
+    }
+
+    // The canonical form is the sequence of (regid, low, high) for all compared registers,
+    // sorted by regid, followed by (encoding, value) for registers with a generic name.
+    // Registers with a generic name are flagged with the most significant bit, not used in
+    // CSR_REGID_ values and in MRS encodings.
+    constexpr csr_u64_t SREG_FLAG = csr_u64_t(1) << 63;
+    canonical.clear();
+    for (const auto& it : registers.registers()) {
+        if (opt.excluded.count(it.first) == 0) {
+            canonical.push_back(csr_u64_t(it.first));
+            canonical.push_back(it.second.low);
+            canonical.push_back(csr_regid_is_pair(it.first) ? it.second.high : 0);
+        }
+    }
+    for (const auto& it : registers.sysRegisters()) {
+        canonical.push_back(it.first | SREG_FLAG);
+        canonical.push_back(it.second);
+    }
+
+    // FNV-1a hash, 64 bits.
+    hash = 14695981039346656037ull;
+    for (csr_u64_t value : canonical) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            hash = (hash ^ ((value >> shift) & 0xFF)) * 1099511628211ull;
+        }
+    }
+    return true;
+}
+
+// Search all snapshots in a path.
+void SearchSnapshots(const std::string& path, std::vector<Snapshot>& snapshots)
+{
+    for (const auto& source : RegSnapshot::Search(path)) {
+        snapshots.emplace_back();
+        snapshots.back().source = source;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Display the differences between two snapshots.
+// Return the number of different features and registers.
+//----------------------------------------------------------------------------
+
+size_t DisplayDiff(std::ostream& out, const Options& opt, const Snapshot& before, const Snapshot& after)
+{
+    size_t count = 0;
+
+    // Compare features.
+    ArmFeatures feat_before, feat_after;
+    before.registers.getFeatures(feat_before);
+    after.registers.getFeatures(feat_after);
+    const FeatureSet set_before(feat_before);
+    const FeatureSet set_after(feat_after);
+    (set_before ^ set_after).forEach([&](FeatureId id) {
+        count++;
+        out << FeatureSet::name(id) << ": " << YesNo(set_before.has(id)) << " -> " << YesNo(set_after.has(id)) << std::endl;
+    });
+
+    // Compare registers, by merging the two sorted maps.
+    const auto& regs_before(before.registers.registers());
+    const auto& regs_after(after.registers.registers());
+    auto it_before = regs_before.begin();
+    auto it_after = regs_after.begin();
+    while (it_before != regs_before.end() || it_after != regs_after.end()) {
+        const bool has_before = it_before != regs_before.end() && (it_after == regs_after.end() || it_before->first <= it_after->first);
+        const bool has_after = it_after != regs_after.end() && (it_before == regs_before.end() || it_after->first <= it_before->first);
+        const int regid = has_before ? it_before->first : it_after->first;
+        const RegView::Register& desc(RegView::getRegister(regid));
+        const std::string name(desc.isValid() ? std::string(desc.name) : Format("REGID_%d", regid));
+        if (opt.excluded.count(regid) != 0) {
+            // Ignored register.
+        }
+        else if (!has_before) {
+            count++;
+            out << name << ": absent -> " << desc.hexa(it_after->second) << std::endl;
+        }
+        else if (!has_after) {
+            count++;
+            out << name << ": " << desc.hexa(it_before->second) << " -> absent" << std::endl;
+        }
+        else if (it_before->second.low != it_after->second.low || (desc.isPair() && it_before->second.high != it_after->second.high)) {
+            count++;
+            out << name << ": " << desc.hexa(it_before->second) << " -> " << desc.hexa(it_after->second) << std::endl;
+            if (!opt.summary) {
+                desc.displayChanges(out, it_before->second, it_after->second);
+            }
+        }
+        if (has_before) {
+            ++it_before;
+        }
+        if (has_after) {
+            ++it_after;
+        }
+    }
+
+    // Compare registers with a generic name, no bitfield description.
+    const auto& sregs_before(before.registers.sysRegisters());
+    const auto& sregs_after(after.registers.sysRegisters());
+    auto its_before = sregs_before.begin();
+    auto its_after = sregs_after.begin();
+    while (its_before != sregs_before.end() || its_after != sregs_after.end()) {
+        const bool has_before = its_before != sregs_before.end() && (its_after == sregs_after.end() || its_before->first <= its_after->first);
+        const bool has_after = its_after != sregs_after.end() && (its_before == sregs_before.end() || its_after->first <= its_before->first);
+        const std::string name(RegView::genericName(has_before ? its_before->first : its_after->first));
+        if (!has_before || !has_after || its_before->second != its_after->second) {
+            count++;
+            out << name << ": " << (has_before ? ToHexa(its_before->second) : "absent")
+                << " -> " << (has_after ? ToHexa(its_after->second) : "absent") << std::endl;
+        }
+        if (has_before) {
+            ++its_before;
+        }
+        if (has_after) {
+            ++its_after;
+        }
+    }
+    return count;
+}
+
+
+//----------------------------------------------------------------------------
+// Program entry point.
+//----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    const Options opt(argc, argv);
+
+    // Two-way comparison: first snapshot, then second snapshot or current system.
+    if (opt.baseline.empty()) {
+        Snapshot before, after;
+        before.source = opt.inputs[0];
+        after.source = opt.inputs.size() > 1 ? opt.inputs[1] : std::string();
+        if (!before.load(opt)) {
+            opt.fatal(before.error);
+        }
+        if (!after.load(opt)) {
+            opt.fatal(after.error);
+        }
+        std::cout << "--- " << before.name() << std::endl << "+++ " << after.name() << std::endl;
+        const size_t count = before.hash == after.hash && before.canonical == after.canonical ? 0 : DisplayDiff(std::cout, opt, before, after);
+        std::cout << Format("%zu differences", count) << std::endl;
+        return count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // N-way comparison: load all snapshots in parallel.
+    Snapshot baseline;
+    baseline.source = opt.baseline;
+    if (!baseline.load(opt)) {
+        opt.fatal(baseline.error);
+    }
+    std::vector<Snapshot> snapshots;
+    for (const auto& path : opt.inputs) {
+        SearchSnapshots(path, snapshots);
+    }
+    std::sort(snapshots.begin(), snapshots.end(), [](const Snapshot& s1, const Snapshot& s2) { return s1.source < s2.source; });
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < std::min(opt.threads, snapshots.size()); ++i) {
+        threads.emplace_back([&]() {
+            for (size_t s = next++; s < snapshots.size(); s = next++) {
+                snapshots[s].load(opt);
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    // Group identical snapshots. The hash is only a hint, the canonical forms are compared.
+    // A group is a list of indexes in snapshots, the first one is the representative.
+    std::vector<std::vector<size_t>> groups;
+    std::multimap<uint64_t, size_t> hashes;  // hash -> index in groups
+    size_t errors = 0;
+    for (size_t s = 0; s < snapshots.size(); ++s) {
+        const Snapshot& snap(snapshots[s]);
+        if (!snap.error.empty()) {
+            std::cerr << opt.command << ": " << snap.error << std::endl;
+            errors++;
+            continue;
+        }
+        auto range = hashes.equal_range(snap.hash);
+        auto it = range.first;
+        while (it != range.second && snapshots[groups[it->second][0]].canonical != snap.canonical) {
+            ++it;
+        }
+        if (it != range.second) {
+            groups[it->second].push_back(s);
+        }
+        else {
+            hashes.insert(std::make_pair(snap.hash, groups.size()));
+            groups.emplace_back(1, s);
+        }
+    }
+
+    // Compare each distinct snapshot with the baseline, largest groups first.
+    std::stable_sort(groups.begin(), groups.end(), [](const auto& g1, const auto& g2) { return g1.size() > g2.size(); });
+    size_t identical = 0;
+    std::cout << "Baseline: " << baseline.name() << std::endl;
+    for (size_t g = 0; g < groups.size(); ++g) {
+        const Snapshot& snap(snapshots[groups[g][0]]);
+        const bool same = snap.hash == baseline.hash && snap.canonical == baseline.canonical;
+        identical += same ? groups[g].size() : 0;
+        std::cout << std::endl << Format("Group %zu: %zu snapshots, ", g + 1, groups[g].size())
+                  << (same ? "identical to baseline" : "first one is " + snap.name()) << std::endl;
+        if (opt.list) {
+            for (size_t s : groups[g]) {
+                std::cout << "    " << snapshots[s].name() << std::endl;
+            }
+        }
+        if (!same) {
+            DisplayDiff(std::cout, opt, baseline, snap);
+        }
+    }
+    std::cout << std::endl
+              << Format("%zu snapshots, %zu distinct, %zu identical to baseline, %zu errors",
+                        snapshots.size(), groups.size(), identical, errors) << std::endl;
+    return identical == snapshots.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -12,20 +12,41 @@
 #include "strutils.h"
 #include "regaccess.h"
 #include "regview.h"
+#include "outbuffer.h"
+#include "snapfile.h"
 #include "armfeatures.h"
+#include "featurecache.h"
+#include "featureset.h"
 #include "armpseudocode.h"
+#include "asyncregaccess.h"
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include <cstddef>
 #include <cstdlib>
+#include <cerrno>
 #include <string>
-#include <list>
+#include <vector>
+#if defined(__linux__)
+    #include <unistd.h>
+    #include <sys/timerfd.h>
+#elif defined(WINDOWS)
+    #include <io.h>
+    #include <fcntl.h>
+#endif
 
 
 //----------------------------------------------------------------------------
 // Command line options.
 //----------------------------------------------------------------------------
 
+// Output formats of -a, -p, -s.
+enum class OutputFormat {TEXT, JSONL, TLV};
+
 class Options
 {
 public:
@@ -37,14 +58,23 @@ public:
     std::string read_register;
     std::string write_register;
     std::string display_register;
+    std::string save_file;
+    std::string batch_file;
     csr_pair_t write_value;
     csr_pair_t display_value;
+    long watch_interval;
+    size_t watch_count;
+    OutputFormat format;
     bool all_registers;
+    bool compact;
     bool binary;
     bool force;
     bool list_registers;
     bool cpu_summary;
     bool direct_load;
+    bool hwcap_load;
+    bool linux_load;
+    bool no_cache;
     bool pac_summary;
     bool verbose;
 
@@ -62,16 +92,33 @@ void Options::usage() const
               << std::endl
               << "  -a : read all supported Arm64 system registers" << std::endl
               << "  -b : display register value in binary (default: hex)" << std::endl
+              << "  --batch file : execute the commands in a file ('-' for standard input)" << std::endl
+              << "  -c : with -i, compact output, one line per sample" << std::endl
               << "  -d name value : display the value in the named register format" << std::endl
               << "  -f : force read/write register, even if not supposed to" << std::endl
+              << "  --format=name : output format of -a, -p, -s: text (default), jsonl, tlv" << std::endl
               << "  -h : display this help text" << std::endl
+              << "  --hwcap : same as -s but deduce the features from AT_HWCAP, without trap (Linux only)" << std::endl
+              << "  -i msec : with -r, read the register periodically, display changes" << std::endl
               << "  -l : list all supported Arm64 system registers" << std::endl
+              << "  --linux : same as --hwcap, then read registers at EL0 in one batch (Linux only)" << std::endl
+              << "  -n count : with -i, stop after count samples (default: no limit)" << std::endl
+              << "  --no-cache : do not use the feature cache file, always read the registers" << std::endl
               << "  -p : summary of supported PAC features" << std::endl
               << "  -r name : read the content of the named register" << std::endl
+              << "            or any register by encoding, S<op0>_<op1>_C<n>_C<m>_<op2>" << std::endl
               << "  -s : summary of CPU features" << std::endl
               << "  -S : same as -s but read registers at EL0 (maybe partial, may fail)" << std::endl
+              << "  --save file : save all registers of all CPU's in a binary snapshot file (.csrsnap)" << std::endl
               << "  -w name hex-value : write the value in the named register" << std::endl
               << "  -v : verbose, display register analysis and fields" << std::endl
+              << std::endl
+              << "Batch commands, one per line, same as the corresponding options:" << std::endl
+              << std::endl
+              << "  r name, w name hex-value, d name hex-value, s, p" << std::endl
+              << std::endl
+              << "All commands use the same access to the kernel module and the same CPU features." << std::endl
+              << "Consecutive reads are submitted together. Empty lines and comments (#) are ignored." << std::endl
               << std::endl;
     ::exit(EXIT_FAILURE);
 }
@@ -87,14 +134,23 @@ Options::Options(int argc, char* argv[]) :
     read_register(),
     write_register(),
     display_register(),
+    save_file(),
+    batch_file(),
     write_value{0, 0},
     display_value{0, 0},
+    watch_interval(0),
+    watch_count(0),
+    format(OutputFormat::TEXT),
     all_registers(false),
+    compact(false),
     binary(false),
     force(false),
     list_registers(false),
     cpu_summary(false),
     direct_load(false),
+    hwcap_load(false),
+    linux_load(false),
+    no_cache(false),
     pac_summary(false),
     verbose(false)
 {
@@ -118,12 +174,45 @@ Options::Options(int argc, char* argv[]) :
                 fatal("invalid hexa value to display");
             }
         }
+        else if (arg == "-i" && i+1 < argc) {
+            if ((watch_interval = ::atol(argv[++i])) <= 0) {
+                fatal("invalid interval, must be a positive number of milliseconds");
+            }
+        }
+        else if (arg == "-n" && i+1 < argc) {
+            const long count = ::atol(argv[++i]);
+            if (count <= 0) {
+                fatal("invalid count, must be a positive number of samples");
+            }
+            watch_count = size_t(count);
+        }
+        else if (arg == "--save" && i+1 < argc) {
+            save_file = argv[++i];
+        }
+        else if (arg == "--batch" && i+1 < argc) {
+            batch_file = argv[++i];
+        }
+        else if (arg == "--no-cache") {
+            no_cache = true;
+        }
+        else if (arg == "--format=text") {
+            format = OutputFormat::TEXT;
+        }
+        else if (arg == "--format=jsonl") {
+            format = OutputFormat::JSONL;
+        }
+        else if (arg == "--format=tlv") {
+            format = OutputFormat::TLV;
+        }
         else if (arg == "-a") {
             all_registers = true;
         }
         else if (arg == "-b") {
             binary = true;
         }
+        else if (arg == "-c") {
+            compact = true;
+        }
         else if (arg == "-f") {
             force = true;
         }
@@ -139,6 +228,12 @@ Options::Options(int argc, char* argv[]) :
         else if (arg == "-S") {
             cpu_summary = direct_load = true;
         }
+        else if (arg == "--hwcap") {
+            cpu_summary = hwcap_load = true;
+        }
+        else if (arg == "--linux") {
+            cpu_summary = linux_load = true;
+        }
         else if (arg == "-v") {
             verbose = true;
         }
@@ -146,6 +241,70 @@ Options::Options(int argc, char* argv[]) :
             fatal("invalid option '" + arg + "', try --help");
         }
     }
+    if (watch_interval > 0 && read_register.empty()) {
+        fatal("option -i requires -r");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Access to the kernel module and CPU features, shared by all commands.
+//----------------------------------------------------------------------------
+
+class Session
+{
+public:
+    // Constructor.
+    Session(const Options& opt) : _command(opt.command), _use_cache(!opt.no_cache) {}
+
+    // Access to the kernel module, open on first use, exit on open error.
+    RegAccess& regaccess();
+
+    // CPU features, loaded on first use, from the feature cache when possible.
+    // After writing a register, remove the cache file, which may be stale for all
+    // processes, and reload the features from the registers.
+    const ArmFeatures& features();
+    void resetFeatures();
+
+private:
+    std::string _command;
+    std::unique_ptr<RegAccess> _regaccess {};
+    ArmFeatures _features {};
+    bool _features_loaded = false;
+    bool _use_cache = true;
+};
+
+RegAccess& Session::regaccess()
+{
+    if (_regaccess == nullptr) {
+        _regaccess.reset(new RegAccess(false, true));
+    }
+    return *_regaccess;
+}
+
+void Session::resetFeatures()
+{
+    if (!FeatureCache::remove()) {
+        std::cerr << _command << ": cannot remove the feature cache " << FeatureCache::defaultPath() << ": " << Error(errno) << std::endl;
+    }
+    _features_loaded = false;
+}
+
+const ArmFeatures& Session::features()
+{
+    if (!_features_loaded) {
+        if (!_use_cache || !FeatureCache::load(_features)) {
+            if (!_features.load(regaccess())) {
+                regaccess().printLastError();
+            }
+            else if (_use_cache) {
+                // Ignore errors, the cache is typically not writable when not root.
+                FeatureCache::save(_features);
+            }
+        }
+        _features_loaded = true;
+    }
+    return _features;
 }
 
 
@@ -170,7 +329,7 @@ void ListRegisters(const Options& opt, std::ostream& out)
         << Pad("", name_width, '-') << "  " << Pad("", feature_width, '-') << std::endl;
 
     for (const auto& desc : RegView::AllRegisters) {
-        out << Pad(desc.name, name_width, ' ') << "  "
+        out << Pad(std::string(desc.name), name_width, ' ') << "  "
             << desc.featuresList() << std::endl;
     }
     out << std::endl;
@@ -199,59 +358,275 @@ void DisplayRegisterValue(const Options& opt, const RegView::Register& desc, con
     }
 }
 
-void ReadRegister(const Options& opt, std::ostream& out)
+void DisplaySysRegValue(const Options& opt, csr_u64_t sreg, csr_u64_t value, std::ostream& out)
 {
-    RegAccess regaccess(false, true);
+    if (opt.verbose) {
+        out << std::endl << RegView::genericName(sreg) << ": " << ToBinary(value) << std::endl
+            << std::endl << "  Value: " << ToHexa(value) << std::endl << std::endl;
+    }
+    else if (opt.binary) {
+        out << ToBinary(value) << std::endl;
+    }
+    else {
+        out << ToHexa(value) << std::endl;
+    }
+}
 
-    const auto& desc(RegView::getRegister(opt.read_register));
-    if (!desc.isValid()) {
-        opt.fatal("unknown register " + opt.read_register + ", try -l");
+// Check the name of a register to read. Return its description or exit on error.
+// The register may be unknown to this project, we only know its encoding.
+const RegView::Register& CheckReadRegister(const Options& opt, Session& session, const std::string& name, csr_u64_t& sreg)
+{
+    const auto& desc(RegView::getRegister(name));
+    if (!desc.isValid() && !RegView::decodeGenericName(name, sreg)) {
+        opt.fatal("unknown register " + name + ", try -l");
     }
-    if (!opt.force && !desc.canRead(regaccess)) {
-        opt.fatal("register " + opt.read_register + " is not readable on this CPU, try -f at your own risks");
+    if (desc.isValid() && !opt.force && !desc.canRead(session.features())) {
+        opt.fatal("register " + name + " is not readable on this CPU, try -f at your own risks");
     }
+    return desc;
+}
 
-    csr_pair_t reg;
-    if (!regaccess.read(desc.csr_index, reg)) {
-        regaccess.printLastError(opt.command + ": error reading " + opt.read_register);
+void ReadRegister(const Options& opt, Session& session, const std::string& name, std::ostream& out)
+{
+    csr_u64_t sreg = 0;
+    const auto& desc(CheckReadRegister(opt, session, name, sreg));
+    RegAccess& regaccess(session.regaccess());
+    csr_pair_t reg {0, 0};
+    if (desc.isValid() ? !regaccess.read(desc.csr_index, reg) : !regaccess.readSysReg(sreg, reg.low)) {
+        regaccess.printLastError(opt.command + ": error reading " + name);
     }
-    else {
+    else if (desc.isValid()) {
         DisplayRegisterValue(opt, desc, reg, out);
     }
+    else {
+        DisplaySysRegValue(opt, sreg, reg.low, out);
+    }
 }
 
-void DisplayRegister(const Options& opt, std::ostream& out)
+void DisplayRegister(const Options& opt, const std::string& name, const csr_pair_t& value, std::ostream& out)
 {
-    const auto& desc(RegView::getRegister(opt.display_register));
+    const auto& desc(RegView::getRegister(name));
     if (!desc.isValid()) {
-        opt.fatal("unknown register " + opt.display_register + ", try -l");
+        opt.fatal("unknown register " + name + ", try -l");
     }
     else {
-        DisplayRegisterValue(opt, desc, opt.display_value, out);
+        DisplayRegisterValue(opt, desc, value, out);
     }
 }
 
 
 //----------------------------------------------------------------------------
-// Write a register
+// Periodically read a register
 //----------------------------------------------------------------------------
 
-void WriteRegister(const Options& opt, std::ostream& out)
+// A periodic timer. On Linux, use a timerfd, other systems sleep until the next period.
+class Ticker
+{
+public:
+    Ticker(std::chrono::milliseconds period);
+    ~Ticker();
+
+    // Wait for the next period.
+    void wait();
+
+private:
+    const std::chrono::milliseconds       _period;
+    std::chrono::steady_clock::time_point _next;
+#if defined(__linux__)
+    int _fd = -1;
+#endif
+};
+
+Ticker::Ticker(std::chrono::milliseconds period) :
+    _period(period),
+    _next(std::chrono::steady_clock::now() + period)
 {
-    RegAccess regaccess(false, true);
+#if defined(__linux__)
+    if ((_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) >= 0) {
+        ::itimerspec spec;
+        spec.it_interval.tv_sec = spec.it_value.tv_sec = period.count() / 1000;
+        spec.it_interval.tv_nsec = spec.it_value.tv_nsec = (period.count() % 1000) * 1000000;
+        if (::timerfd_settime(_fd, 0, &spec, nullptr) < 0) {
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+#endif
+}
+
+Ticker::~Ticker()
+{
+#if defined(__linux__)
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+#endif
+}
+
+void Ticker::wait()
+{
+#if defined(__linux__)
+    if (_fd >= 0) {
+        // Read the number of expirations, missed periods are ignored.
+        uint64_t count = 0;
+        while (::read(_fd, &count, sizeof(count)) < 0 && errno == EINTR) {
+        }
+        return;
+    }
+#endif
+    std::this_thread::sleep_until(_next);
+    _next += _period;
+}
+
+void WatchRegister(const Options& opt, Session& session, std::ostream& out)
+{
+    // The register and the device are checked once.
+    csr_u64_t sreg = 0;
+    const auto& desc(CheckReadRegister(opt, session, opt.read_register, sreg));
+    const bool by_encoding = !desc.isValid();
+    RegAccess& regaccess(session.regaccess());
+
+    const auto start = std::chrono::steady_clock::now();
+    Ticker ticker(std::chrono::milliseconds(opt.watch_interval));
+    csr_pair_t previous {0, 0};
 
-    const auto& desc(RegView::getRegister(opt.write_register));
+    for (size_t count = 0; opt.watch_count == 0 || count < opt.watch_count; ++count) {
+        if (count > 0) {
+            ticker.wait();
+        }
+        const double timestamp = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        csr_pair_t reg {0, 0};
+        if (by_encoding ? !regaccess.readSysReg(sreg, reg.low) : !regaccess.read(desc.csr_index, reg)) {
+            regaccess.printLastError(opt.command + ": error reading " + opt.read_register);
+            return;
+        }
+
+        // Timestamp in seconds, absolute value, delta of the 64-bit value (low part of a pair).
+        out << Format("%12.6f", timestamp) << "  " << (by_encoding ? ToHexa(reg.low) : desc.hexa(reg));
+        if (count > 0) {
+            out << Format("  %+lld", (long long)(reg.low - previous.low));
+        }
+        if (opt.compact) {
+            if (count > 0 && !by_encoding) {
+                for (const auto& bf : desc.fields) {
+                    const csr_u64_t value = bf.get(reg);
+                    if (value != bf.get(previous)) {
+                        out << " " << bf.name << "=" << bf.hexa(value);
+                    }
+                }
+            }
+            out << std::endl;
+        }
+        else {
+            // Registers which are read by encoding have no bitfield description.
+            out << std::endl;
+            if (!by_encoding && count == 0 && opt.verbose) {
+                out << std::endl;
+                desc.display(out, reg);
+                out << std::endl;
+            }
+            else if (!by_encoding && count > 0) {
+                desc.displayChanges(out, previous, reg);
+            }
+        }
+        previous = reg;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Write a register
+//----------------------------------------------------------------------------
+
+void WriteRegister(const Options& opt, Session& session, const std::string& name, const csr_pair_t& value, std::ostream& out)
+{
+    const auto& desc(RegView::getRegister(name));
     if (!desc.isValid()) {
-        opt.fatal("unknown register " + opt.write_register + ", try -l");
+        opt.fatal("unknown register " + name + ", try -l");
     }
-    if (!opt.force && !desc.canWrite(regaccess)) {
-        opt.fatal("register " + opt.write_register + " is not writeable on this CPU, try -f at your own risks");
+    if (!opt.force && !desc.canWrite(session.features())) {
+        opt.fatal("register " + name + " is not writeable on this CPU, try -f at your own risks");
     }
     if (opt.verbose) {
-        out << opt.command << ": writing " << desc.hexa(opt.write_value) << " " << desc.name << std::endl;
+        out << opt.command << ": writing " << desc.hexa(value) << " " << desc.name << std::endl;
+    }
+    RegAccess& regaccess(session.regaccess());
+    if (!regaccess.write(desc.csr_index, value)) {
+        regaccess.printLastError(opt.command + ": error writing " + name);
+    }
+    else {
+        // Some features depend on writeable registers (e.g. TCR_EL1).
+        session.resetFeatures();
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Machine-readable output formats.
+//----------------------------------------------------------------------------
+
+// JSON Lines: one JSON object per line, per register or per feature.
+// TLV: a sequence of binary records. Each record starts with a tag (32 bits)
+// and the size in bytes of the value (32 bits). All integers are little endian.
+enum : csr_u64_t {
+    TLV_REGISTER   = 1,  // regid (32 bits), width in bits (32 bits), value (8 or 16 bytes, low part first), name
+    TLV_FEATURE    = 2,  // value (8 bits, 0 or 1), name
+    TLV_PAC_LAYOUT = 3,  // is_instr, upper, size, top bit, selector bit, bottom bit (8 bits each)
+};
+
+void TLVHeader(OutBuffer& out, csr_u64_t tag, size_t size)
+{
+    out.littleEndian(tag, 4).littleEndian(size, 4);
+}
+
+void OutputRegister(const Options& opt, OutBuffer& out, const RegView::Register& desc, const csr_pair_t& reg)
+{
+    if (opt.format == OutputFormat::TLV) {
+        const size_t width = desc.isPair() ? 16 : 8;
+        TLVHeader(out, TLV_REGISTER, 8 + width + desc.name.size());
+        out.littleEndian(desc.csr_index, 4).littleEndian(8 * width, 4).littleEndian(reg.low, 8);
+        if (desc.isPair()) {
+            out.littleEndian(reg.high, 8);
+        }
+        out << desc.name;
     }
-    if (!regaccess.write(desc.csr_index, opt.write_value)) {
-        regaccess.printLastError(opt.command + ": error writing " + opt.write_register);
+    else {
+        out << "{\"register\":";
+        out.json(desc.name) << ",\"regid\":";
+        out.decimal(desc.csr_index) << ",\"value\":\"";
+        out.hexa(reg.low, 16) << "\"";
+        if (desc.isPair()) {
+            out << ",\"high\":\"";
+            out.hexa(reg.high, 16) << "\"";
+        }
+        out << ",\"fields\":[";
+        for (const auto& bf : desc.fields) {
+            const csr_u64_t value = bf.get(reg);
+            out << (&bf == desc.fields.begin() ? "{" : ",{") << "\"name\":";
+            out.json(bf.name) << ",\"msb\":";
+            out.decimal(bf.msb) << ",\"lsb\":";
+            out.decimal(bf.lsb) << ",\"value\":";
+            out.decimal((long long)(value));
+            const std::string_view name(bf.findName(value));
+            if (!name.empty()) {
+                out << ",\"meaning\":";
+                out.json(name);
+            }
+            out << "}";
+        }
+        out << "]}\n";
+    }
+}
+
+void OutputFeature(const Options& opt, OutBuffer& out, std::string_view name, bool value)
+{
+    if (opt.format == OutputFormat::TLV) {
+        TLVHeader(out, TLV_FEATURE, 1 + name.size());
+        out.littleEndian(value, 1) << name;
+    }
+    else {
+        out << "{\"feature\":";
+        out.json(name) << ",\"value\":" << (value ? "true" : "false") << "}\n";
     }
 }
 
@@ -260,32 +635,51 @@ void WriteRegister(const Options& opt, std::ostream& out)
 // Read all registers
 //----------------------------------------------------------------------------
 
-void ReadAllRegisters(const Options& opt, std::ostream& out)
+void ReadAllRegisters(const Options& opt, Session& session, OutBuffer& out)
 {
     size_t name_width = 0;
-    if (!opt.verbose) {
+    if (opt.format == OutputFormat::TEXT && !opt.verbose) {
         for (const auto& desc : RegView::AllRegisters) {
             name_width = std::max(name_width, desc.name.length());
         }
-        out << std::endl;
+        out.endl();
     }
 
     // Loop on all registers.
-    RegAccess regaccess(true, true);
+    RegAccess& regaccess(session.regaccess());
+    const ArmFeatures& feat(session.features());
     for (const auto& desc : RegView::AllRegisters) {
         csr_pair_t reg;
         // Check if this register is readable and compatible with the CPU features.
-        if (desc.canRead(regaccess) && regaccess.read(desc.csr_index, reg)) {
-            if (opt.verbose) {
-                out << std::endl;
+        if (!desc.canRead(feat)) {
+            continue;
+        }
+        if (!regaccess.read(desc.csr_index, reg)) {
+            regaccess.printLastError();
+        }
+        else {
+            if (opt.format != OutputFormat::TEXT) {
+                OutputRegister(opt, out, desc, reg);
+            }
+            else if (opt.verbose) {
+                out.endl();
                 desc.display(out, reg);
             }
             else {
-                out << Pad(desc.name, name_width, ' ') << "  " << desc.hexa(reg) << std::endl;
+                out.pad(desc.name, name_width, ' ') << "  ";
+                if (desc.isPair()) {
+                    out.hexa(reg);
+                }
+                else {
+                    out.hexa(reg.low);
+                }
+                out.endl();
             }
         }
     }
-    out << std::endl;
+    if (opt.format == OutputFormat::TEXT) {
+        out.endl();
+    }
 }
 
 
@@ -314,10 +708,10 @@ void PACLayout(ArmPseudoCode& code, std::ostream& out, bool upper, bool is_instr
         << std::endl;
 }
 
-void PointerAuthenticationSummary(const Options& opt, std::ostream& out)
+void PointerAuthenticationSummary(const Options& opt, Session& session, std::ostream& out)
 {
-    RegAccess regaccess(true, true);
-    ArmFeatures feat(regaccess);
+    RegAccess& regaccess(session.regaccess());
+    const ArmFeatures& feat(session.features());
 
     out << std::endl
         << "Summary: PAC: " << YesNo(feat.FEAT_PAuth())
@@ -353,47 +747,252 @@ void PointerAuthenticationSummary(const Options& opt, std::ostream& out)
     out << std::endl;
 }
 
+void PointerAuthenticationData(const Options& opt, Session& session, OutBuffer& out)
+{
+    RegAccess& regaccess(session.regaccess());
+    const ArmFeatures& feat(session.features());
+
+    OutputFeature(opt, out, "PAC", feat.FEAT_PAuth());
+    OutputFeature(opt, out, "PACGA", feat.hasPACGA());
+    OutputFeature(opt, out, "FEAT_PAuth", feat.FEAT_PAuth());
+    OutputFeature(opt, out, "FEAT_PAuth2", feat.FEAT_PAuth2());
+    OutputFeature(opt, out, "FEAT_EPAC", feat.FEAT_EPAC());
+    OutputFeature(opt, out, "FEAT_FPAC", feat.FEAT_FPAC());
+    OutputFeature(opt, out, "FEAT_FPACCOMBINE", feat.FEAT_FPACCOMBINE());
+    OutputFeature(opt, out, "FEAT_CONSTPACFIELD", feat.FEAT_CONSTPACFIELD());
+    OutputFeature(opt, out, "FEAT_PACQARMA3", feat.FEAT_PACQARMA3());
+    OutputFeature(opt, out, "FEAT_PACQARMA5", feat.FEAT_PACQARMA5());
+    OutputFeature(opt, out, "FEAT_PACIMP", feat.FEAT_PACIMP());
+    OutputFeature(opt, out, "MemoryTagging", feat.addressTaggingEnabled());
+
+    if (feat.FEAT_PAuth()) {
+        ArmPseudoCode code(regaccess);
+        for (int is_instr = 0; is_instr <= 1; ++is_instr) {
+            for (int upper = 0; upper <= 1; ++upper) {
+                const csr_u64_t address = upper ? ~0ull : 0;
+                const int size = code.pacSize(address, is_instr);
+                const int top = code.pacTopBit(address, is_instr);
+                const int sel = code.pacSelBit(address, is_instr);
+                const int bottom = code.pacBottomBit(address, is_instr);
+                if (opt.format == OutputFormat::TLV) {
+                    TLVHeader(out, TLV_PAC_LAYOUT, 6);
+                    out.littleEndian(is_instr, 1).littleEndian(upper, 1).littleEndian(size, 1)
+                       .littleEndian(top, 1).littleEndian(sel, 1).littleEndian(bottom, 1);
+                }
+                else {
+                    out << "{\"pac_layout\":" << (is_instr ? "\"instr\"" : "\"data\"")
+                        << ",\"range\":" << (upper ? "\"upper\"" : "\"lower\"") << ",\"size\":";
+                    out.decimal(size) << ",\"top\":";
+                    out.decimal(top) << ",\"sel\":";
+                    out.decimal(sel) << ",\"bottom\":";
+                    out.decimal(bottom) << "}\n";
+                }
+            }
+        }
+    }
+}
+
 
 //----------------------------------------------------------------------------
-// Descriptions of all Arm features.
+// Display a summary of CPU features.
 //----------------------------------------------------------------------------
 
-class Feature
+void FeaturesSummary(const Options& opt, Session& session, OutBuffer& out)
 {
-public:
-    std::string name;                  // Feature name
-    bool (ArmFeatures::*get)() const;  // Method to get that feature
-};
+    // Read system registers at EL0 (direct MRS instructions) or EL1 (call the kernel module).
+    // On Linux, the auxiliary vector can be used first, without trap.
+    ArmFeatures direct;
+    if (opt.hwcap_load && !direct.loadLinuxSysfs(false)) {
+        opt.fatal("--hwcap is only supported on Linux");
+    }
+    else if (opt.linux_load && !direct.loadLinuxSysfs(true)) {
+        opt.fatal("--linux is only supported on Linux");
+    }
+    else if (opt.direct_load) {
+        direct.loadDirect();
+    }
+    const ArmFeatures& features(opt.direct_load || opt.hwcap_load || opt.linux_load ? direct : session.features());
 
-const std::list<Feature> AllArmFeatures {
-    // Automatically generated file:
-    #include "_armfeatures.h"
-};
+    const FeatureSet set(features);
+    size_t name_width = 0;
+    for (size_t i = 0; i < FeatureSet::COUNT; ++i) {
+        name_width = std::max(name_width, FeatureSet::name(FeatureId(i)).length());
+    }
+    for (size_t i = 0; i < FeatureSet::COUNT; ++i) {
+        const std::string_view name(FeatureSet::name(FeatureId(i)));
+        const bool value = set.has(FeatureId(i));
+        if (opt.format != OutputFormat::TEXT) {
+            OutputFeature(opt, out, name, value);
+        }
+        else {
+            out.pad(std::string(name) + " ", name_width + 2) << " " << YesNo(value) << "\n";
+        }
+    }
+}
 
 
 //----------------------------------------------------------------------------
-// Display a summary of CPU features.
+// Execute a stream of commands (batch mode).
 //----------------------------------------------------------------------------
 
-void FeaturesSummary(const Options& opt, std::ostream& out)
+// A register read in a batch. Consecutive reads are submitted together.
+struct BatchRead
+{
+    std::string name {};                      // register name, as specified
+    const RegView::Register* desc = nullptr;  // register description, null when read by encoding
+    size_t sreg_index = 0;                    // index in the table of reads by encoding
+    csr_pair_t value {0, 0};                  // register value
+    int error = 0;                            // system error code
+};
+
+// Submit all pending reads, display the results in order.
+void FlushReads(const Options& opt, AsyncRegAccess& async, std::vector<BatchRead>& reads, std::vector<csr_sreg_t>& sregs, std::ostream& out)
 {
-    ArmFeatures features;
-    if (opt.direct_load) {
-        // Read system registers at EL0 (direct MRS instructions).
-        features.loadDirect();
+    // Registers which are known to the kernel module are read individually. All registers
+    // which are read by encoding are read in one request. All requests are submitted together.
+    int sregs_error = 0;
+    for (auto& rd : reads) {
+        if (rd.desc != nullptr && !async.read(rd.desc->csr_index, rd.value, [&rd](int error) { rd.error = error; })) {
+            rd.error = EINVAL;
+        }
+    }
+    if (!sregs.empty() && !async.readSysRegs(sregs.data(), sregs.size(), [&sregs_error](int error) { sregs_error = error; })) {
+        sregs_error = EINVAL;
+    }
+    async.wait();
+
+    for (const auto& rd : reads) {
+        const int error = rd.desc != nullptr ? rd.error : sregs_error;
+        if (error != 0) {
+            std::cerr << opt.command << ": error reading " << rd.name << ": " << Error(error) << std::endl;
+        }
+        else if (rd.desc != nullptr) {
+            DisplayRegisterValue(opt, *rd.desc, rd.value, out);
+        }
+        else if (sregs[rd.sreg_index].status == CSR_SREG_DISABLED) {
+            std::cerr << opt.command << ": error reading " << rd.name << ": read-by-encoding disabled, see module parameter sreg_unsafe (Linux 6.4+)" << std::endl;
+        }
+        else if (sregs[rd.sreg_index].status != CSR_SREG_OK) {
+            std::cerr << opt.command << ": error reading " << rd.name << ": register not accessible" << std::endl;
+        }
+        else {
+            DisplaySysRegValue(opt, sregs[rd.sreg_index].sreg, sregs[rd.sreg_index].value, out);
+        }
+    }
+    reads.clear();
+    sregs.clear();
+}
+
+void PointerAuthentication(const Options& opt, Session& session)
+{
+    if (opt.format == OutputFormat::TEXT) {
+        PointerAuthenticationSummary(opt, session, std::cout);
     }
     else {
-        // Read system registers at EL1 (call the kernel module).
-        RegAccess regaccess(true, true);
-        features.load(regaccess);
+        std::cout.flush();
+        OutBuffer out(OutBuffer::STDOUT);
+        PointerAuthenticationData(opt, session, out);
     }
+}
 
-    size_t name_width = 0;
-    for (const auto& feat : AllArmFeatures) {
-        name_width = std::max(name_width, feat.name.length());
+// One command in a batch.
+struct BatchCommand
+{
+    char        cmd = 0;        // 'r', 'w', 'd', 's', 'p'
+    std::string name {};        // register name
+    csr_pair_t  value {0, 0};   // value to write or display
+};
+
+void RunBatch(const Options& opt, Session& session)
+{
+    std::ifstream file;
+    if (opt.batch_file != "-") {
+        file.open(opt.batch_file);
+        if (!file) {
+            opt.fatal("cannot open " + opt.batch_file);
+        }
     }
-    for (const auto& feat : AllArmFeatures) {
-        out << Pad(feat.name + " ", name_width + 2) << " " << YesNo((features.*feat.get)()) << std::endl;
+    std::istream& in(opt.batch_file == "-" ? std::cin : file);
+
+    // Check all commands, including the access to the registers, before executing the
+    // first one, to avoid partial configurations.
+    std::vector<BatchCommand> commands;
+    std::string line;
+    for (size_t line_number = 1; std::getline(in, line); ++line_number) {
+        std::istringstream parser(line.substr(0, line.find('#')));
+        std::string cmd, name, value, extra;
+        parser >> cmd >> name >> value >> extra;
+        if (cmd.empty()) {
+            continue;
+        }
+        const std::string location(Format("%s:%zu: ", opt.batch_file == "-" ? "stdin" : opt.batch_file.c_str(), line_number));
+        commands.emplace_back();
+        BatchCommand& bc(commands.back());
+        bc.cmd = cmd.size() == 1 ? cmd[0] : 0;
+        bc.name = name;
+        csr_u64_t sreg = 0;
+        const bool with_name = bc.cmd == 'r' || bc.cmd == 'w' || bc.cmd == 'd';
+        const bool with_value = bc.cmd == 'w' || bc.cmd == 'd';
+        if ((!with_name && bc.cmd != 's' && bc.cmd != 'p') || !extra.empty() ||
+            with_name == name.empty() || with_value == value.empty() ||
+            (with_value && !DecodeHexa(bc.value, value)))
+        {
+            opt.fatal(location + "invalid command: " + line);
+        }
+        const auto& desc(RegView::getRegister(name));
+        if (with_name && !desc.isValid() && (bc.cmd != 'r' || !RegView::decodeGenericName(name, sreg))) {
+            opt.fatal(location + "unknown register " + name + ", try -l");
+        }
+        // Same access checks as in CheckReadRegister() and WriteRegister(). They depend
+        // on the feature registers only, a write in the batch cannot change the result.
+        if (bc.cmd == 'r' && desc.isValid() && !opt.force && !desc.canRead(session.features())) {
+            opt.fatal(location + "register " + name + " is not readable on this CPU, try -f at your own risks");
+        }
+        if (bc.cmd == 'w' && !opt.force && !desc.canWrite(session.features())) {
+            opt.fatal(location + "register " + name + " is not writeable on this CPU, try -f at your own risks");
+        }
+    }
+
+    // Consecutive reads are queued, then submitted together before the next command.
+    std::unique_ptr<AsyncRegAccess> async;
+    std::vector<BatchRead> reads;
+    std::vector<csr_sreg_t> sregs;
+    for (size_t i = 0; i < commands.size(); ++i) {
+        const BatchCommand& bc(commands[i]);
+        if (bc.cmd == 'r') {
+            csr_u64_t sreg = 0;
+            reads.emplace_back();
+            reads.back().name = bc.name;
+            const auto& desc(CheckReadRegister(opt, session, bc.name, sreg));
+            if (desc.isValid()) {
+                reads.back().desc = &desc;
+            }
+            else {
+                reads.back().sreg_index = sregs.size();
+                sregs.push_back(csr_sreg_t {sreg, 0, CSR_SREG_OK});
+            }
+            if (i + 1 < commands.size() && commands[i + 1].cmd == 'r') {
+                continue;
+            }
+            if (async == nullptr) {
+                async.reset(new AsyncRegAccess(session.regaccess()));
+            }
+            FlushReads(opt, *async, reads, sregs, std::cout);
+        }
+        else if (bc.cmd == 'w') {
+            WriteRegister(opt, session, bc.name, bc.value, std::cout);
+        }
+        else if (bc.cmd == 'd') {
+            DisplayRegister(opt, bc.name, bc.value, std::cout);
+        }
+        else if (bc.cmd == 's') {
+            std::cout.flush();
+            OutBuffer out(OutBuffer::STDOUT);
+            FeaturesSummary(opt, session, out);
+        }
+        else if (bc.cmd == 'p') {
+            PointerAuthentication(opt, session);
+        }
     }
 }
 
@@ -406,26 +1005,53 @@ int main(int argc, char* argv[])
 {
     const Options opt(argc, argv);
 
+#if defined(WINDOWS)
+    // Binary records must not be altered by end-of-line translation.
+    if (opt.format == OutputFormat::TLV) {
+        ::_setmode(OutBuffer::STDOUT, _O_BINARY);
+    }
+#endif
+
+    // The kernel module is open once, when first needed, and shared by all commands.
+    Session session(opt);
+
     if (opt.list_registers) {
         ListRegisters(opt, std::cout);
     }
     if (opt.all_registers) {
-        ReadAllRegisters(opt, std::cout);
+        // Potentially large output, directly written on standard output.
+        std::cout.flush();
+        OutBuffer out(OutBuffer::STDOUT);
+        ReadAllRegisters(opt, session, out);
     }
     if (!opt.display_register.empty()) {
-        DisplayRegister(opt, std::cout);
+        DisplayRegister(opt, opt.display_register, opt.display_value, std::cout);
     }
     if (!opt.write_register.empty()) {
-        WriteRegister(opt, std::cout);
+        WriteRegister(opt, session, opt.write_register, opt.write_value, std::cout);
+    }
+    if (!opt.read_register.empty() && opt.watch_interval > 0) {
+        WatchRegister(opt, session, std::cout);
     }
-    if (!opt.read_register.empty()) {
-        ReadRegister(opt, std::cout);
+    else if (!opt.read_register.empty()) {
+        ReadRegister(opt, session, opt.read_register, std::cout);
     }
     if (opt.pac_summary) {
-        PointerAuthenticationSummary(opt, std::cout);
+        PointerAuthentication(opt, session);
+    }
+    if (!opt.save_file.empty()) {
+        std::string error;
+        if (!SnapFile::create(opt.save_file, error)) {
+            opt.fatal(error);
+        }
     }
     if (opt.cpu_summary) {
-        FeaturesSummary(opt, std::cout);
+        std::cout.flush();
+        OutBuffer out(OutBuffer::STDOUT);
+        FeaturesSummary(opt, session, out);
+    }
+    if (!opt.batch_file.empty()) {
+        RunBatch(opt, session);
     }
 
     return EXIT_SUCCESS;
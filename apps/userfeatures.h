@@ -11,116 +11,108 @@
 //----------------------------------------------------------------------------
 
 #pragma once
-#include <functional>
+#include "compiletimefeatures.h"
 #include <cstdint>
 
 //
 // A class describing the features of an Arm64 processor as seen from
 // userland, without accessing the kernel module, Linux and macOS.
 //
+// All features are loaded once per process, on first construction, in a
+// thread-safe way. Then, all instances are copies of a packed bitset and
+// the accessors are inline, without test or synchronization. The features
+// which are guaranteed by the compilation target are constant true.
+//
 class UserFeatures
 {
 public:
     // Constructor.
-    UserFeatures();
+    UserFeatures() : _bits(load()) {}
 
     // Processor features, using same names as Arm Architecture Reference Manual.
-    bool FEAT_AES();
-    bool FEAT_BF16();
-    bool FEAT_BTI();
-    bool FEAT_CRC32();
-    bool FEAT_CSV2();
-    bool FEAT_CSV3();
-    bool FEAT_DIT();
-    bool FEAT_DotProd();
-    bool FEAT_DPB();
-    bool FEAT_DPB2();
-    bool FEAT_ECV();
-    bool FEAT_FCMA();
-    bool FEAT_FHM();
-    bool FEAT_FlagM();
-    bool FEAT_FlagM2();
-    bool FEAT_FP16();
-    bool FEAT_FPAC();
-    bool FEAT_FRINTTS();
-    bool FEAT_I8MM();
-    bool FEAT_JSCVT();
-    bool FEAT_LRCPC();
-    bool FEAT_LRCPC2();
-    bool FEAT_LSE();
-    bool FEAT_LSE2();
-    bool FEAT_PAuth();
-    bool FEAT_PAuth2();
-    bool FEAT_PMULL();
-    bool FEAT_RDM();
-    bool FEAT_SB();
-    bool FEAT_SHA1();
-    bool FEAT_SHA256();
-    bool FEAT_SHA512();
-    bool FEAT_SHA3();
-    bool FEAT_SPECRES();
-    bool FEAT_SSBS();
+    bool FEAT_AES() const { return CompileTimeFeatures::FEAT_AES() || get(AES); }
+    bool FEAT_BF16() const { return CompileTimeFeatures::FEAT_BF16() || get(BF16); }
+    bool FEAT_BTI() const { return CompileTimeFeatures::FEAT_BTI() || get(BTI); }
+    bool FEAT_CRC32() const { return CompileTimeFeatures::FEAT_CRC32() || get(CRC32); }
+    bool FEAT_CSV2() const { return CompileTimeFeatures::FEAT_CSV2() || get(CSV2); }
+    bool FEAT_CSV3() const { return CompileTimeFeatures::FEAT_CSV3() || get(CSV3); }
+    bool FEAT_DIT() const { return CompileTimeFeatures::FEAT_DIT() || get(DIT); }
+    bool FEAT_DotProd() const { return CompileTimeFeatures::FEAT_DotProd() || get(DOTPROD); }
+    bool FEAT_DPB() const { return CompileTimeFeatures::FEAT_DPB() || get(DPB); }
+    bool FEAT_DPB2() const { return CompileTimeFeatures::FEAT_DPB2() || get(DPB2); }
+    bool FEAT_ECV() const { return CompileTimeFeatures::FEAT_ECV() || get(ECV); }
+    bool FEAT_FCMA() const { return CompileTimeFeatures::FEAT_FCMA() || get(FCMA); }
+    bool FEAT_FHM() const { return CompileTimeFeatures::FEAT_FHM() || get(FHM); }
+    bool FEAT_FlagM() const { return CompileTimeFeatures::FEAT_FlagM() || get(FLAGM); }
+    bool FEAT_FlagM2() const { return CompileTimeFeatures::FEAT_FlagM2() || get(FLAGM2); }
+    bool FEAT_FP16() const { return CompileTimeFeatures::FEAT_FP16() || get(FP16); }
+    bool FEAT_FPAC() const { return CompileTimeFeatures::FEAT_FPAC() || get(FPAC); }
+    bool FEAT_FRINTTS() const { return CompileTimeFeatures::FEAT_FRINTTS() || get(FRINTTS); }
+    bool FEAT_I8MM() const { return CompileTimeFeatures::FEAT_I8MM() || get(I8MM); }
+    bool FEAT_JSCVT() const { return CompileTimeFeatures::FEAT_JSCVT() || get(JSCVT); }
+    bool FEAT_LRCPC() const { return CompileTimeFeatures::FEAT_LRCPC() || get(LRCPC); }
+    bool FEAT_LRCPC2() const { return CompileTimeFeatures::FEAT_LRCPC2() || get(LRCPC2); }
+    bool FEAT_LSE() const { return CompileTimeFeatures::FEAT_LSE() || get(LSE); }
+    bool FEAT_LSE2() const { return CompileTimeFeatures::FEAT_LSE2() || get(LSE2); }
+    bool FEAT_PAuth() const { return CompileTimeFeatures::FEAT_PAuth() || get(PAUTH); }
+    bool FEAT_PAuth2() const { return CompileTimeFeatures::FEAT_PAuth2() || get(PAUTH2); }
+    bool FEAT_PMULL() const { return CompileTimeFeatures::FEAT_PMULL() || get(PMULL); }
+    bool FEAT_RDM() const { return CompileTimeFeatures::FEAT_RDM() || get(RDM); }
+    bool FEAT_SB() const { return CompileTimeFeatures::FEAT_SB() || get(SB); }
+    bool FEAT_SHA1() const { return CompileTimeFeatures::FEAT_SHA1() || get(SHA1); }
+    bool FEAT_SHA256() const { return CompileTimeFeatures::FEAT_SHA256() || get(SHA256); }
+    bool FEAT_SHA512() const { return CompileTimeFeatures::FEAT_SHA512() || get(SHA512); }
+    bool FEAT_SHA3() const { return CompileTimeFeatures::FEAT_SHA3() || get(SHA3); }
+    bool FEAT_SPECRES() const { return CompileTimeFeatures::FEAT_SPECRES() || get(SPECRES); }
+    bool FEAT_SSBS() const { return CompileTimeFeatures::FEAT_SSBS() || get(SSBS); }
 
 private:
-    // Each feature is loaded once.
-    struct InitBool {
-        bool loaded;
-        bool value;
-        InitBool() : loaded(false), value(false) {}
+    // Index of each feature in the bitset.
+    enum Index : unsigned int {
+        AES,
+        BF16,
+        BTI,
+        CRC32,
+        CSV2,
+        CSV3,
+        DIT,
+        DOTPROD,
+        DPB,
+        DPB2,
+        ECV,
+        FCMA,
+        FHM,
+        FLAGM,
+        FLAGM2,
+        FP16,
+        FPAC,
+        FRINTTS,
+        I8MM,
+        JSCVT,
+        LRCPC,
+        LRCPC2,
+        LSE,
+        LSE2,
+        PAUTH,
+        PAUTH2,
+        PMULL,
+        RDM,
+        SB,
+        SHA1,
+        SHA256,
+        SHA512,
+        SHA3,
+        SPECRES,
+        SSBS,
+        COUNT
     };
+    static_assert(COUNT <= 64, "too many features for a 64-bit set");
 
-    // List of features.
-    InitBool _aes;
-    InitBool _bf16;
-    InitBool _bti;
-    InitBool _crc32;
-    InitBool _csv2;
-    InitBool _csv3;
-    InitBool _dit;
-    InitBool _dotprod;
-    InitBool _dpb;
-    InitBool _dpb2;
-    InitBool _ecv;
-    InitBool _fcma;
-    InitBool _fhm;
-    InitBool _flagm;
-    InitBool _flagm2;
-    InitBool _fp16;
-    InitBool _fpac;
-    InitBool _frintts;
-    InitBool _i8mm;
-    InitBool _jscvt;
-    InitBool _lrcpc;
-    InitBool _lrcpc2;
-    InitBool _lse;
-    InitBool _lse2;
-    InitBool _pauth;
-    InitBool _pauth2;
-    InitBool _pmull;
-    InitBool _rdm;
-    InitBool _sb;
-    InitBool _sha1;
-    InitBool _sha256;
-    InitBool _sha512;
-    InitBool _sha3;
-    InitBool _specres;
-    InitBool _ssbs;
-
-    // On Linux, some selected registers are available at EL0.
-    // Some Arm features are only available there.
-#if defined(__linux__)
-    bool     _reg_loaded;
-    uint64_t _isar0;
-    uint64_t _isar1;
-    uint64_t _isar2;
-    uint64_t _pfr0;
-    uint64_t _mmfr2;
-#endif
+    // Packed bitset of features, indexed by Index.
+    uint64_t _bits;
+    bool get(Index index) const { return (_bits >> index) & 1; }
 
-    // Initialize a feature.
-#if defined(__linux__)
-    bool feature(InitBool& feat, unsigned long type, unsigned long flag, std::function<bool()> eval);
-#elif defined(__APPLE__)
-    bool feature(InitBool& feat, const char* name);
-#endif
+    // Load all features from the system, once per process. Thread-safe.
+    static uint64_t load();
+    static uint64_t detect();
 };
@@ -42,6 +42,7 @@ Write-Output $OS.Caption | Out-File -Encoding ascii -Append "$DestDir\cpusysregs
 . $BinDir\sysregs -s    | Out-File -Encoding ascii "$DestDir\cpusysregs-features.txt"
 . $BinDir\sysregs -p    | Out-File -Encoding ascii "$DestDir\cpusysregs-pac.txt"
 . $BinDir\sysregs -a -v | Out-File -Encoding ascii "$DestDir\cpusysregs-registers.txt"
+. $BinDir\sysregs --save "$DestDir\cpusysregs-registers.csrsnap"
 . $BinDir\demo-pac      | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-1.txt"
 . $BinDir\demo-pac      | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-2.txt"
 . $BinDir\demo-pac      | Out-File -Encoding ascii "$DestDir\cpusysregs-demo-pac-3.txt"
@@ -57,10 +57,11 @@ echo "Creating cpusysregs-* files"
 apps/sysregs -s >$DESTDIR/cpusysregs-features.txt
 apps/sysregs -p >$DESTDIR/cpusysregs-pac.txt
 apps/sysregs -a -v >$DESTDIR/cpusysregs-registers.txt
+apps/sysregs --save $DESTDIR/cpusysregs-registers.csrsnap
 apps/demo-pac >$DESTDIR/cpusysregs-demo-pac-1.txt
 apps/demo-pac >$DESTDIR/cpusysregs-demo-pac-2.txt
 apps/demo-pac >$DESTDIR/cpusysregs-demo-pac-3.txt
 apps/demo-userfeatures >$DESTDIR/cpusysregs-user-features.txt
 apps/collect >$DESTDIR/cpusysregs-pac-md.txt
 
-ls -l $DESTDIR/cpusysregs-*.txt
+ls -l $DESTDIR/cpusysregs-*.txt $DESTDIR/cpusysregs-*.csrsnap
@@ -303,6 +303,104 @@ typedef struct {
     csr_u64_t modifier;  // modifier, read-only
 } csr_instr_t;
 
+// Parameters to execute the same instruction on a batch of values.
+// The batch is limited to CSR_INSTR_BATCH_MAX entries.
+#define CSR_INSTR_BATCH_MAX 256
+typedef struct {
+    csr_u64_t instr;     // CSR_INSTR_xxx instruction code, read-only
+    csr_u64_t count;     // number of entries, read-only
+    csr_u64_t entries;   // address of an array of csr_instr_t, in user space
+} csr_instr_batch_t;
+
+
+//----------------------------------------------------------------------------
+// Read system registers using their raw encoding (Linux only).
+//----------------------------------------------------------------------------
+//
+// The registers are identified by their encoding in MRS instructions, as
+// built by the CSR_SREG() macro and the CSR_SREG_xxx definitions below.
+// Any register in the op0 = 2 or 3 space can be read, including registers
+// which are unknown to this project (implementation-defined registers for
+// instance). The kernel module does not check the CPU features: when the
+// register does not exist, the MRS instruction fails and the module reports
+// a CSR_SREG_UNDEFINED status. Before Linux 6.4, the exception is cleanly
+// handled by an undef hook. Starting with Linux 6.4, it is a kernel oops
+// (logged, taints the kernel, panics with panic_on_oops) and the module only
+// continues after it: the read-by-encoding commands are disabled unless the
+// module is loaded with the parameter sreg_unsafe=1.
+
+// Status of a read-by-encoding.
+enum {
+    CSR_SREG_OK,         // Register successfully read.
+    CSR_SREG_INVALID,    // Invalid encoding, not in the op0 = 2 or 3 space.
+    CSR_SREG_UNDEFINED,  // MRS instruction failed, register not accessible.
+    CSR_SREG_DISABLED,   // Read-by-encoding disabled (see sreg_unsafe), not attempted.
+};
+
+// Parameters to read one register by encoding.
+typedef struct {
+    csr_u64_t sreg;      // register encoding (CSR_SREG value), read-only
+    csr_u64_t value;     // register value, write-only
+    csr_u64_t status;    // CSR_SREG_xxx status, write-only
+} csr_sreg_t;
+
+// Parameters to read a batch of registers by encoding.
+// The batch is limited to CSR_SREG_BATCH_MAX entries.
+#define CSR_SREG_BATCH_MAX 256
+typedef struct {
+    csr_u64_t count;     // number of entries, read-only
+    csr_u64_t entries;   // address of an array of csr_sreg_t, in user space
+} csr_sreg_batch_t;
+
+// Number of possible encodings in the op0 = 2 or 3 space.
+#define CSR_SREG_COUNT 0x8000
+
+// Check if an MRS encoding is in the op0 = 2 or 3 space.
+CSR_INLINE int csr_sreg_is_valid(csr_u64_t sreg)
+{
+    return (sreg & ~(csr_u64_t)0x001FFFE0) == 0 && (sreg & 0x00100000) != 0;
+}
+
+// Get the index of a valid MRS encoding, from 0 to CSR_SREG_COUNT-1.
+// The bits op0[0], op1, CRn, CRm, op2 are contiguous in the encoding.
+CSR_INLINE int csr_sreg_index(csr_u64_t sreg)
+{
+    return (int)((sreg >> 5) & 0x7FFF);
+}
+
+
+//----------------------------------------------------------------------------
+// Kernel module statistics (Linux only).
+//----------------------------------------------------------------------------
+
+// Types of commands in statistics.
+enum {
+    CSR_STAT_GET_REG,   // Read a register by id.
+    CSR_STAT_SET_REG,   // Write a register by id.
+    CSR_STAT_INSTR,     // Execute an instruction.
+    CSR_STAT_SREG,      // Read registers by encoding, single or batch.
+    CSR_STAT_OTHER,     // Invalid commands.
+    _CSR_STAT_END
+};
+
+// Statistics for one type of command.
+typedef struct {
+    csr_u64_t calls;        // number of calls
+    csr_u64_t errors;       // number of calls which returned an error
+    csr_u64_t nanoseconds;  // cumulated execution time
+} csr_stat_t;
+
+// Use this value in csr_stats_t.cpu to get the statistics of all CPU's.
+#define CSR_STATS_ALL_CPUS (~(csr_u64_t)0)
+
+// Statistics of the kernel module, on one CPU or all CPU's.
+// The statistics are accounted on the CPU where the command completes.
+typedef struct {
+    csr_u64_t  cpu;                    // CPU index or CSR_STATS_ALL_CPUS, read-only
+    csr_u64_t  cpu_count;              // number of possible CPU indexes, write-only
+    csr_stat_t stats[_CSR_STAT_END];   // statistics per type of command, write-only
+} csr_stats_t;
+
 
 //----------------------------------------------------------------------------
 // Kernel module commands.
@@ -320,11 +418,25 @@ typedef struct {
     // Each code shall be unique since all commands go through ioctl().
     #define _CSR_IOC_REG             0x50
     #define _CSR_IOC_INSTR           0x80
+    #define _CSR_IOC_CMD             0x90
     #define CSR_IOC_GET_REG(regid)   _IOR(_CSR_IOC_REG, (regid), csr_u64_t)
     #define CSR_IOC_GET_REG2(regid)  _IOR(_CSR_IOC_REG, (regid), csr_pair_t)
     #define CSR_IOC_SET_REG(regid)   _IOW(_CSR_IOC_REG, (regid), csr_u64_t)
     #define CSR_IOC_SET_REG2(regid)  _IOW(_CSR_IOC_REG, (regid), csr_pair_t)
     #define CSR_IOC_INSTR(instr)     _IOWR(_CSR_IOC_INSTR, (instr), csr_instr_t)
+    #define CSR_IOC_GET_SREG         _IOWR(_CSR_IOC_CMD, 1, csr_sreg_t)
+    #define CSR_IOC_GET_SREGS        _IOWR(_CSR_IOC_CMD, 2, csr_sreg_batch_t)
+    #define CSR_IOC_GET_STATS        _IOWR(_CSR_IOC_CMD, 3, csr_stats_t)
+    #define CSR_IOC_RESET_STATS      _IO(_CSR_IOC_CMD, 4)
+    #define CSR_IOC_INSTRS           _IOWR(_CSR_IOC_CMD, 5, csr_instr_batch_t)
+
+    // Payload of an io_uring command (IORING_OP_URING_CMD) on /dev/cpusysregs.
+    // The command code (cmd_op in the submission queue entry) is the ioctl() code.
+    // The parameter is the address of the ioctl() argument. Fits in a 64-byte SQE.
+    typedef struct {
+        csr_u64_t param;     // address of the ioctl() argument, in user space
+        csr_u64_t reserved;  // must be zero
+    } csr_uring_cmd_t;
 
     // Extract the register id from an ioctl() code.
     // Return CSR_REGID_INVALID if not a set/get register command.
@@ -17,10 +17,31 @@
 #include <linux/device.h>
 #include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/kdebug.h>
 #include <linux/kernel.h>
+#include <linux/kallsyms.h>
+#include <linux/kprobes.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/preempt.h>
+#include <linux/ptrace.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
+#include <asm/traps.h>
+
+// The uring_cmd file operation appeared in Linux 5.19.
+// Its declarations moved to a dedicated header in Linux 6.7.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 19, 0)
+    #define CSR_HAS_URING_CMD 1
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 7, 0)
+        #include <linux/io_uring/cmd.h>
+    #else
+        #include <linux/io_uring.h>
+    #endif
+#else
+    #define CSR_HAS_URING_CMD 0
+#endif
 
 // Description of the kernel module.
 
@@ -37,12 +58,58 @@ static struct class* csr_class = NULL;
 static struct device* csr_device = NULL;
 static int cpu_features = 0;
 
+// Read-by-encoding of undefined registers needs to recover from the undefined
+// instruction exception of the MRS. The arm64 exception table is only used for
+// data aborts, not for undefined instructions. Before Linux 6.4, undefined
+// instructions in kernel mode go through the undef hooks: this is a clean fixup,
+// without oops, read-by-encoding is always enabled. register_undef_hook() is not
+// exported, it is found using kallsyms_lookup_name() (itself found using a kprobe
+// since Linux 5.7). Linux 6.4 removed the undef hooks, the only remaining way is
+// the die notifier chain, called from die() after the oops is logged: the kernel
+// is tainted (TAINT_DIE), lockdep is disabled, a crash kernel is started when kexec
+// is armed and the system panics with panic_on_oops. This is not a fixup, only a
+// way to continue: read-by-encoding must be explicitly allowed using sreg_unsafe.
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0)
+    #define CSR_HAS_UNDEF_HOOK 0
+    #define CSR_HAS_DIE_RECOVERY 1
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 7, 0) && !defined(CONFIG_KPROBES)
+    #define CSR_HAS_UNDEF_HOOK 0
+    #define CSR_HAS_DIE_RECOVERY 0
+#else
+    #define CSR_HAS_UNDEF_HOOK 1
+    #define CSR_HAS_DIE_RECOVERY 0
+#endif
+
+// Per-CPU statistics, accounted on the CPU where the command completes.
+
+struct csr_cpu_stats {
+    csr_stat_t stats[_CSR_STAT_END];
+};
+static DEFINE_PER_CPU(struct csr_cpu_stats, csr_cpu_stats);
+
+static bool sreg_unsafe = false;
+module_param(sreg_unsafe, bool, 0444);
+MODULE_PARM_DESC(sreg_unsafe, "Allow read-by-encoding on Linux 6.4+, an undefined register is an oops (taint, may panic or crash)");
+
+// Set when an undefined MRS in a read-by-encoding stub is recovered without oops.
+static bool csr_undef_hook_registered = false;
+
 // Functions in this module.
 
 static int __init csr_init(void);
 static void __exit csr_exit(void);
 static char* csr_devnode(const struct device* dev, umode_t* mode);
 static long csr_ioctl(struct file* filp, unsigned int cmd, unsigned long argp);
+static long csr_ioctl_dispatch(unsigned int cmd, unsigned long param);
+#if CSR_HAS_URING_CMD
+static int csr_uring_cmd(struct io_uring_cmd* ioucmd, unsigned int issue_flags);
+#endif
+static int csr_die_handler(struct notifier_block* nb, unsigned long action, void* data);
+#if CSR_HAS_UNDEF_HOOK
+static int csr_undef_handler(struct pt_regs* regs, u32 instr);
+static void csr_register_undef_hook(void);
+#endif
 
 // Registration of the module.
 
@@ -54,8 +121,32 @@ module_exit(csr_exit);
 static struct file_operations csr_fops = {
     .owner = THIS_MODULE,
     .unlocked_ioctl = csr_ioctl,
+#if CSR_HAS_URING_CMD
+    .uring_cmd = csr_uring_cmd,
+#endif
 };
 
+// Die notifier, used to recover from undefined registers in read-by-encoding.
+
+static struct notifier_block csr_die_notifier = {
+    .notifier_call = csr_die_handler,
+};
+
+// Undef hook, used to recover from undefined registers in read-by-encoding.
+// Matches MRS instructions with op0 = 2 or 3, in kernel mode.
+
+#if CSR_HAS_UNDEF_HOOK
+typedef void (*csr_undef_hook_func_t)(struct undef_hook* hook);
+static csr_undef_hook_func_t csr_unregister_undef_hook = NULL;
+static struct undef_hook csr_undef_hook = {
+    .instr_mask = 0xFFF00000,
+    .instr_val  = 0xD5300000,
+    .pstate_mask = PSR_MODE_MASK,
+    .pstate_val  = PSR_MODE_EL1h,
+    .fn = csr_undef_handler,
+};
+#endif
+
 
 //----------------------------------------------------------------------------
 // Initialize the kernel module (upon "insmod").
@@ -103,6 +194,16 @@ static int __init csr_init(void)
         return PTR_ERR(csr_device);
     }
 
+    // Recover from undefined registers in read-by-encoding.
+#if CSR_HAS_UNDEF_HOOK
+    csr_register_undef_hook();
+#endif
+#if CSR_HAS_DIE_RECOVERY
+    if (sreg_unsafe) {
+        register_die_notifier(&csr_die_notifier);
+    }
+#endif
+
     return 0;
 }
 
@@ -114,6 +215,16 @@ static int __init csr_init(void)
 static void __exit csr_exit(void)
 {
     // Close resources in reverse order from csr_init().
+#if CSR_HAS_DIE_RECOVERY
+    if (sreg_unsafe) {
+        unregister_die_notifier(&csr_die_notifier);
+    }
+#endif
+#if CSR_HAS_UNDEF_HOOK
+    if (csr_undef_hook_registered) {
+        csr_unregister_undef_hook(&csr_undef_hook);
+    }
+#endif
     device_destroy(csr_class, MKDEV(csr_major_number, 0));
     class_destroy(csr_class);
     unregister_chrdev(csr_major_number, CSR_MODULE_NAME);
@@ -146,12 +257,380 @@ static char* csr_devnode(const struct device* dev, umode_t* mode)
 }
 
 
+//----------------------------------------------------------------------------
+// Read system registers using their raw encoding.
+//----------------------------------------------------------------------------
+
+// The MRS instruction embeds the register encoding. To read any register,
+// we pre-generate a table of stubs, one per possible encoding in the
+// op0 = 2 or 3 space, indexed by csr_sreg_index(). Each stub is:
+//   bti c  ; landing pad for the indirect call
+//   mrs    x0, <sreg>
+//   ret
+// On return, x1 is still zero when the MRS succeeded. When the MRS fails,
+// csr_sreg_recover() sets x1 to CSR_SREG_UNDEFINED and skips the MRS. From the
+// undef hook, this is a clean fixup. From the die notifier, this is not: the
+// oops is already logged and the kernel is tainted.
+
+#define CSR_SREG_STUB_SIZE  12  // size in bytes of a stub
+#define CSR_SREG_STUB_MRS   4   // offset of the MRS instruction in a stub
+
+extern const char csr_sreg_stubs[];
+extern const char csr_sreg_stubs_end[];
+
+asm(".pushsection .text, \"ax\"\n"
+    ".balign 16\n"
+    "csr_sreg_stubs:\n"
+    ".irp op0,2,3\n"
+    ".irp op1,0,1,2,3,4,5,6,7\n"
+    ".irp crn,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15\n"
+    ".irp crm,0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15\n"
+    ".irp op2,0,1,2,3,4,5,6,7\n"
+    "hint #34\n"
+    ".inst 0xd5200000|(\\op0<<19)|(\\op1<<16)|(\\crn<<12)|(\\crm<<8)|(\\op2<<5)\n"
+    "ret\n"
+    ".endr\n"
+    ".endr\n"
+    ".endr\n"
+    ".endr\n"
+    ".endr\n"
+    "csr_sreg_stubs_end:\n"
+    ".popsection\n");
+
+// Recover from an undefined MRS instruction. Return true if recovered.
+static bool csr_sreg_recover(struct pt_regs* regs)
+{
+    // Only recover from an MRS instruction inside the table of stubs.
+    if (regs != NULL && !user_mode(regs) &&
+        regs->pc >= (unsigned long)csr_sreg_stubs &&
+        regs->pc < (unsigned long)csr_sreg_stubs_end &&
+        (regs->pc - (unsigned long)csr_sreg_stubs) % CSR_SREG_STUB_SIZE == CSR_SREG_STUB_MRS)
+    {
+        regs->regs[0] = 0;
+        regs->regs[1] = CSR_SREG_UNDEFINED;
+        regs->pc += 4;
+        return true;
+    }
+    return false;
+}
+
+// Called on kernel exceptions which would otherwise kill the task (Linux 6.4+, after the oops).
+static int csr_die_handler(struct notifier_block* nb, unsigned long action, void* data)
+{
+    struct die_args* args = data;
+    return args != NULL && csr_sreg_recover(args->regs) ? NOTIFY_STOP : NOTIFY_DONE;
+}
+
+#if CSR_HAS_UNDEF_HOOK
+
+// Called on undefined MRS instructions in kernel mode (before Linux 6.4). Return 0 if handled.
+static int csr_undef_handler(struct pt_regs* regs, u32 instr)
+{
+    return csr_sreg_recover(regs) ? 0 : 1;
+}
+
+// Find a kernel symbol, exported or not.
+static unsigned long csr_lookup_name(const char* name)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 7, 0)
+    // kallsyms_lookup_name() is no longer exported, a kprobe gives its address.
+    typedef unsigned long (*lookup_func_t)(const char* name);
+    static lookup_func_t lookup = NULL;
+    if (lookup == NULL) {
+        struct kprobe kp = {.symbol_name = "kallsyms_lookup_name"};
+        if (register_kprobe(&kp) < 0) {
+            return 0;
+        }
+        lookup = (lookup_func_t)kp.addr;
+        unregister_kprobe(&kp);
+    }
+    return lookup == NULL ? 0 : lookup(name);
+#else
+    return kallsyms_lookup_name(name);
+#endif
+}
+
+// Register the undef hook. Read-by-encoding is disabled when it cannot be registered.
+static void csr_register_undef_hook(void)
+{
+    const csr_undef_hook_func_t reg = (csr_undef_hook_func_t)csr_lookup_name("register_undef_hook");
+    csr_unregister_undef_hook = (csr_undef_hook_func_t)csr_lookup_name("unregister_undef_hook");
+    if (reg != NULL && csr_unregister_undef_hook != NULL) {
+        reg(&csr_undef_hook);
+        csr_undef_hook_registered = true;
+    }
+    else {
+        pr_warn("%s: undef hooks not found, read-by-encoding disabled\n", CSR_MODULE_NAME);
+    }
+}
+
+#endif
+
+// Read one register by encoding. Update value and status in the structure.
+static void csr_read_sreg(csr_sreg_t* reg)
+{
+    if (!csr_sreg_is_valid(reg->sreg)) {
+        reg->value = 0;
+        reg->status = CSR_SREG_INVALID;
+    }
+    else if (!csr_undef_hook_registered && !(CSR_HAS_DIE_RECOVERY && sreg_unsafe)) {
+        reg->value = 0;
+        reg->status = CSR_SREG_DISABLED;
+    }
+    else {
+        register csr_u64_t x0 asm("x0");
+        register csr_u64_t x1 asm("x1") = CSR_SREG_OK;
+        const char* stub = csr_sreg_stubs + csr_sreg_index(reg->sreg) * CSR_SREG_STUB_SIZE;
+        asm volatile("blr %2" : "=&r" (x0), "+r" (x1) : "r" (stub) : "x30", "memory", "cc");
+        reg->value = x0;
+        reg->status = x1;
+    }
+}
+
+// Process a CSR_IOC_GET_SREG ioctl() command.
+static long csr_ioctl_get_sreg(unsigned long param)
+{
+    csr_sreg_t reg;
+    if (copy_from_user(&reg, (void*)param, sizeof(reg))) {
+        return -EFAULT;
+    }
+    csr_read_sreg(&reg);
+    if (copy_to_user((void*)param, &reg, sizeof(reg))) {
+        return -EFAULT;
+    }
+    switch (reg.status) {
+        case CSR_SREG_OK:
+            return 0;
+        case CSR_SREG_INVALID:
+            return -EINVAL;
+        case CSR_SREG_DISABLED:
+            return -EOPNOTSUPP;
+        default:
+            return -EIO;
+    }
+}
+
+// Process a CSR_IOC_GET_SREGS ioctl() command.
+// The entries are processed by chunks. Each chunk is read on the same CPU.
+static long csr_ioctl_get_sregs(unsigned long param)
+{
+    csr_sreg_batch_t batch;
+    csr_sreg_t chunk[16];
+    csr_sreg_t __user* entries = NULL;
+    size_t done = 0;
+
+    if (copy_from_user(&batch, (void*)param, sizeof(batch))) {
+        return -EFAULT;
+    }
+    if (batch.count > CSR_SREG_BATCH_MAX) {
+        return -EINVAL;
+    }
+    entries = (csr_sreg_t __user*)(uintptr_t)batch.entries;
+
+    while (done < batch.count) {
+        const size_t count = min_t(size_t, batch.count - done, ARRAY_SIZE(chunk));
+        size_t i = 0;
+        if (copy_from_user(chunk, entries + done, count * sizeof(csr_sreg_t))) {
+            return -EFAULT;
+        }
+        preempt_disable();
+        for (i = 0; i < count; i++) {
+            csr_read_sreg(&chunk[i]);
+        }
+        preempt_enable();
+        if (copy_to_user(entries + done, chunk, count * sizeof(csr_sreg_t))) {
+            return -EFAULT;
+        }
+        done += count;
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Execute the same instruction on a batch of values.
+//----------------------------------------------------------------------------
+
+// Process a CSR_IOC_INSTRS ioctl() command.
+static long csr_ioctl_instrs(unsigned long param)
+{
+    csr_instr_batch_t batch;
+    csr_instr_t chunk[16];
+    csr_instr_t __user* entries = NULL;
+    size_t done = 0;
+
+    if (copy_from_user(&batch, (void*)param, sizeof(batch))) {
+        return -EFAULT;
+    }
+    if (batch.count > CSR_INSTR_BATCH_MAX || batch.instr == CSR_INSTR_INVALID || batch.instr >= _CSR_INSTR_END) {
+        return -EINVAL;
+    }
+    entries = (csr_instr_t __user*)(uintptr_t)batch.entries;
+
+    while (done < batch.count) {
+        const size_t count = min_t(size_t, batch.count - done, ARRAY_SIZE(chunk));
+        size_t i = 0;
+        if (copy_from_user(chunk, entries + done, count * sizeof(csr_instr_t))) {
+            return -EFAULT;
+        }
+        for (i = 0; i < count; i++) {
+            if (csr_exec_instr((int)batch.instr, &chunk[i])) {
+                return -EINVAL;
+            }
+        }
+        if (copy_to_user(entries + done, chunk, count * sizeof(csr_instr_t))) {
+            return -EFAULT;
+        }
+        done += count;
+    }
+    return 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Module statistics.
+//----------------------------------------------------------------------------
+
+// Get the type of an ioctl() command in statistics.
+static int csr_stat_type(unsigned int cmd)
+{
+    if (cmd == CSR_IOC_GET_SREG || cmd == CSR_IOC_GET_SREGS) {
+        return CSR_STAT_SREG;
+    }
+    else if (cmd == CSR_IOC_INSTRS || csr_ioc_to_instr(cmd) != CSR_INSTR_INVALID) {
+        return CSR_STAT_INSTR;
+    }
+    else if (csr_ioc_to_regid(cmd) != CSR_REGID_INVALID) {
+        return _IOC_DIR(cmd) == _IOC_WRITE ? CSR_STAT_SET_REG : CSR_STAT_GET_REG;
+    }
+    else {
+        return CSR_STAT_OTHER;
+    }
+}
+
+// Process a CSR_IOC_GET_STATS ioctl() command.
+static long csr_ioctl_get_stats(unsigned long param)
+{
+    csr_stats_t args;
+    int cpu = 0;
+    int type = 0;
+
+    if (copy_from_user(&args, (void*)param, sizeof(args))) {
+        return -EFAULT;
+    }
+    if (args.cpu != CSR_STATS_ALL_CPUS && (args.cpu >= nr_cpu_ids || !cpu_possible(args.cpu))) {
+        return -EINVAL;
+    }
+
+    // Counters of other CPU's are read without locking, they are 64-bit aligned.
+    memset(args.stats, 0, sizeof(args.stats));
+    args.cpu_count = nr_cpu_ids;
+    for_each_possible_cpu(cpu) {
+        if (args.cpu == CSR_STATS_ALL_CPUS || args.cpu == (csr_u64_t)cpu) {
+            const struct csr_cpu_stats* cs = per_cpu_ptr(&csr_cpu_stats, cpu);
+            for (type = 0; type < _CSR_STAT_END; type++) {
+                args.stats[type].calls += READ_ONCE(cs->stats[type].calls);
+                args.stats[type].errors += READ_ONCE(cs->stats[type].errors);
+                args.stats[type].nanoseconds += READ_ONCE(cs->stats[type].nanoseconds);
+            }
+        }
+    }
+
+    if (copy_to_user((void*)param, &args, sizeof(args))) {
+        return -EFAULT;
+    }
+    return 0;
+}
+
+// Process a CSR_IOC_RESET_STATS ioctl() command.
+// Concurrent commands on other CPU's may be partially accounted.
+static long csr_ioctl_reset_stats(void)
+{
+    int cpu = 0;
+    for_each_possible_cpu(cpu) {
+        memset(per_cpu_ptr(&csr_cpu_stats, cpu), 0, sizeof(struct csr_cpu_stats));
+    }
+    return 0;
+}
+
+
 //----------------------------------------------------------------------------
 // Called on ioctl() from userland.
 //----------------------------------------------------------------------------
 
 static long csr_ioctl(struct file* filp, unsigned int cmd, unsigned long param)
 {
+    // The statistics commands are not accounted.
+    if (cmd == CSR_IOC_GET_STATS) {
+        return csr_ioctl_get_stats(param);
+    }
+    else if (cmd == CSR_IOC_RESET_STATS) {
+        return csr_ioctl_reset_stats();
+    }
+    else {
+        const int type = csr_stat_type(cmd);
+        const u64 start = ktime_get_ns();
+        const long status = csr_ioctl_dispatch(cmd, param);
+        this_cpu_inc(csr_cpu_stats.stats[type].calls);
+        this_cpu_add(csr_cpu_stats.stats[type].nanoseconds, ktime_get_ns() - start);
+        if (status < 0) {
+            this_cpu_inc(csr_cpu_stats.stats[type].errors);
+        }
+        return status;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Called on io_uring command (IORING_OP_URING_CMD) from userland.
+//----------------------------------------------------------------------------
+
+#if CSR_HAS_URING_CMD
+
+// The payload of the command is in the submission queue entry.
+// It is accessed using a helper function starting with Linux 6.5.
+static inline const csr_uring_cmd_t* csr_uring_cmd_args(struct io_uring_cmd* ioucmd)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 5, 0)
+    return io_uring_sqe_cmd(ioucmd->sqe);
+#else
+    return ioucmd->cmd;
+#endif
+}
+
+// The command code is an ioctl() code and the payload contains the address of
+// the ioctl() argument. All commands are executed synchronously, in the context
+// of the submitter, and completed immediately.
+static int csr_uring_cmd(struct io_uring_cmd* ioucmd, unsigned int issue_flags)
+{
+    const csr_uring_cmd_t* args = csr_uring_cmd_args(ioucmd);
+    const unsigned long param = (unsigned long)READ_ONCE(args->param);
+    if (READ_ONCE(args->reserved) != 0) {
+        return -EINVAL;
+    }
+    return (int)csr_ioctl(ioucmd->file, ioucmd->cmd_op, param);
+}
+
+#endif
+
+
+//----------------------------------------------------------------------------
+// Execute an ioctl() command, except statistics.
+//----------------------------------------------------------------------------
+
+static long csr_ioctl_dispatch(unsigned int cmd, unsigned long param)
+{
+    // Check if this is a read by encoding.
+    if (cmd == CSR_IOC_GET_SREG) {
+        return csr_ioctl_get_sreg(param);
+    }
+    else if (cmd == CSR_IOC_GET_SREGS) {
+        return csr_ioctl_get_sregs(param);
+    }
+    else if (cmd == CSR_IOC_INSTRS) {
+        return csr_ioctl_instrs(param);
+    }
+
     // Check if this an instruction to execute.
     const int instr = csr_ioc_to_instr(cmd);
     if (instr != CSR_INSTR_INVALID) {
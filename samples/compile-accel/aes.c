@@ -1,24 +1,51 @@
 #include "aes.h"
 #include "aes_accel.h"
-#include "armfeature.h"
+#include "dispatch.h"
+#include "dispatch_patch.h"
 #include <stdio.h>
 
-static volatile int aes_accel_checked = 0;
-static volatile int aes_accel_supported = 0;
+#if (DISPATCH_BASELINE & DISPATCH_FEAT_AES) != 0
 
+// The accelerated implementation is always supported by the compilation target, no dispatch.
 void aes()
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!aes_accel_checked) {
-        aes_accel_supported = aes_accel_compiled && armfeature(AT_HWCAP, HWCAP_AES, "hw.optional.arm.FEAT_AES");
-        aes_accel_checked = 1;
-    }
-
-    // Each time, select accelerated implementation when supported.
-    if (aes_accel_supported) {
-        aes_accel();
-    }
-    else {
-        printf("aes():    portable implementation\n");
-    }
+    aes_accel();
 }
+
+#else
+
+// Portable implementation.
+static void aes_portable()
+{
+    printf("aes():    portable implementation\n");
+}
+
+// All implementations, the accelerated one is preferred when supported.
+static const dispatch_impl_t aes_impls[] = {
+    {"accel",    aes_accel,    DISPATCH_FEAT_AES, 1, &aes_accel_compiled},
+    {"portable", aes_portable, 0, 0, NULL},
+};
+
+// Called on first call only, select the implementation and call it.
+static void aes_resolve();
+DISPATCH_PATCH_STORAGE dispatch_t aes_dispatch = DISPATCH_INIT("aes", aes_impls, aes_resolve);
+static void aes_resolve()
+{
+    dispatch_resolve(&aes_dispatch)();
+}
+
+#if DISPATCH_PATCH
+
+// The call site is patched at startup with a direct branch to the selected implementation.
+DISPATCH_PATCH_SITE(aes, aes_dispatch);
+
+#else
+
+void aes()
+{
+    // Each time, directly call the selected implementation.
+    DISPATCH_FUNC(aes_dispatch)();
+}
+
+#endif
+#endif
@@ -1,24 +1,51 @@
 #include "crc.h"
 #include "crc_accel.h"
-#include "armfeature.h"
+#include "dispatch.h"
+#include "dispatch_patch.h"
 #include <stdio.h>
 
-static volatile int crc_accel_checked = 0;
-static volatile int crc_accel_supported = 0;
+#if (DISPATCH_BASELINE & DISPATCH_FEAT_CRC32) != 0
 
+// The accelerated implementation is always supported by the compilation target, no dispatch.
 void crc()
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!crc_accel_checked) {
-        crc_accel_supported = crc_accel_compiled && armfeature(AT_HWCAP, HWCAP_CRC32, "hw.optional.armv8_crc32");
-        crc_accel_checked = 1;
-    }
-
-    // Each time, select accelerated implementation when supported.
-    if (crc_accel_supported) {
-        crc_accel();
-    }
-    else {
-        printf("crc():    portable implementation\n");
-    }
+    crc_accel();
 }
+
+#else
+
+// Portable implementation.
+static void crc_portable()
+{
+    printf("crc():    portable implementation\n");
+}
+
+// All implementations, the accelerated one is preferred when supported.
+static const dispatch_impl_t crc_impls[] = {
+    {"accel",    crc_accel,    DISPATCH_FEAT_CRC32, 1, &crc_accel_compiled},
+    {"portable", crc_portable, 0, 0, NULL},
+};
+
+// Called on first call only, select the implementation and call it.
+static void crc_resolve();
+DISPATCH_PATCH_STORAGE dispatch_t crc_dispatch = DISPATCH_INIT("crc", crc_impls, crc_resolve);
+static void crc_resolve()
+{
+    dispatch_resolve(&crc_dispatch)();
+}
+
+#if DISPATCH_PATCH
+
+// The call site is patched at startup with a direct branch to the selected implementation.
+DISPATCH_PATCH_SITE(crc, crc_dispatch);
+
+#else
+
+void crc()
+{
+    // Each time, directly call the selected implementation.
+    DISPATCH_FUNC(crc_dispatch)();
+}
+
+#endif
+#endif
@@ -0,0 +1,108 @@
+#include "dispatch.h"
+#include "armfeature.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int dispatch_features_checked = 0;
+static unsigned int dispatch_features_mask = 0;
+
+unsigned int dispatch_features(void)
+{
+    // Check done once only. No lock, all threads compute and store the same mask.
+    if (!__atomic_load_n(&dispatch_features_checked, __ATOMIC_ACQUIRE)) {
+        // Features which are guaranteed at compile time are always present.
+        unsigned int mask = DISPATCH_BASELINE;
+        if (armfeature(AT_HWCAP, HWCAP_CRC32, "hw.optional.armv8_crc32")) {
+            mask |= DISPATCH_FEAT_CRC32;
+        }
+        if (armfeature(AT_HWCAP, HWCAP_AES, "hw.optional.arm.FEAT_AES")) {
+            mask |= DISPATCH_FEAT_AES;
+        }
+        if (armfeature(AT_HWCAP, HWCAP_PMULL, "hw.optional.arm.FEAT_PMULL")) {
+            mask |= DISPATCH_FEAT_PMULL;
+        }
+        if (armfeature(AT_HWCAP, HWCAP_SHA1, "hw.optional.arm.FEAT_SHA1")) {
+            mask |= DISPATCH_FEAT_SHA1;
+        }
+        if (armfeature(AT_HWCAP, HWCAP_SHA2, "hw.optional.arm.FEAT_SHA256")) {
+            mask |= DISPATCH_FEAT_SHA256;
+        }
+        if (armfeature(AT_HWCAP, HWCAP_SHA512, "hw.optional.arm.FEAT_SHA512")) {
+            mask |= DISPATCH_FEAT_SHA512;
+        }
+        if (armfeature(AT_HWCAP, HWCAP_SHA3, "hw.optional.arm.FEAT_SHA3")) {
+            mask |= DISPATCH_FEAT_SHA3;
+        }
+        __atomic_store_n(&dispatch_features_mask, mask, __ATOMIC_RELAXED);
+        __atomic_store_n(&dispatch_features_checked, 1, __ATOMIC_RELEASE);
+    }
+    return __atomic_load_n(&dispatch_features_mask, __ATOMIC_RELAXED);
+}
+
+// Check if an implementation can be used on the current CPU.
+static int dispatch_usable(const dispatch_impl_t* impl)
+{
+    return (impl->compiled == NULL || *impl->compiled) && (impl->features & ~dispatch_features()) == 0;
+}
+
+// Check if a string of a given size is equal to a nul-terminated one.
+static int dispatch_equal(const char* str, size_t size, const char* ref)
+{
+    return strlen(ref) == size && strncmp(str, ref, size) == 0;
+}
+
+// Find the implementation which is forced by ACCEL_DISPATCH. Return NULL if there is none.
+static const dispatch_impl_t* dispatch_forced(const dispatch_t* disp)
+{
+    const char* env = getenv("ACCEL_DISPATCH");
+    const dispatch_impl_t* forced = NULL;
+    while (env != NULL && *env != '\0') {
+        // Locate next "function=implementation".
+        const char* end = strchr(env, ',');
+        const char* equal = strchr(env, '=');
+        if (end == NULL) {
+            end = env + strlen(env);
+        }
+        if (equal != NULL && equal < end) {
+            const size_t func_size = equal - env;
+            const char* impl_name = equal + 1;
+            const size_t impl_size = end - impl_name;
+            // An explicit function name takes precedence over "*".
+            const int explicit_func = dispatch_equal(env, func_size, disp->name);
+            if (explicit_func || (forced == NULL && dispatch_equal(env, func_size, "*"))) {
+                for (size_t i = 0; i < disp->count; ++i) {
+                    if (dispatch_equal(impl_name, impl_size, disp->impls[i].name) && dispatch_usable(&disp->impls[i])) {
+                        forced = &disp->impls[i];
+                        if (explicit_func) {
+                            return forced;
+                        }
+                    }
+                }
+            }
+        }
+        env = *end == ',' ? end + 1 : end;
+    }
+    return forced;
+}
+
+dispatch_func_t dispatch_resolve(dispatch_t* disp)
+{
+    const dispatch_impl_t* selected = dispatch_forced(disp);
+    if (selected == NULL) {
+        for (size_t i = 0; i < disp->count; ++i) {
+            // Keep the first one in case of identical priorities.
+            if (dispatch_usable(&disp->impls[i]) && (selected == NULL || disp->impls[i].priority > selected->priority)) {
+                selected = &disp->impls[i];
+            }
+        }
+    }
+    if (selected == NULL) {
+        // Cannot return to the caller, the resolver is calling the result.
+        fprintf(stderr, "dispatch: no usable implementation of %s\n", disp->name);
+        abort();
+    }
+    // No lock, all threads store the same pointer.
+    __atomic_store_n(&disp->func, selected->func, __ATOMIC_RELEASE);
+    return selected->func;
+}
@@ -0,0 +1,101 @@
+#if !defined(DISPATCH_H)
+#define DISPATCH_H 1
+
+#include <stddef.h>
+
+// Runtime selection of the implementation of a function.
+//
+// A dispatched function has several implementations. Each of them requires
+// a set of Arm features and has a priority. On first call, the implementation
+// with the highest priority for which all features are supported is selected.
+// All subsequent calls go directly to the selected implementation, through a
+// function pointer, without any check.
+//
+// For A/B testing, the environment variable ACCEL_DISPATCH can force the
+// selection of implementations. It contains a comma-separated list of
+// "function=implementation". The function can be "*" for all functions.
+// Example: ACCEL_DISPATCH="sha256=portable,*=accel"
+// A forced implementation is ignored if its features are not supported.
+
+// Arm features which can be required by an implementation (bit mask).
+#define DISPATCH_FEAT_CRC32   0x0001  // FEAT_CRC32
+#define DISPATCH_FEAT_AES     0x0002  // FEAT_AES
+#define DISPATCH_FEAT_PMULL   0x0004  // FEAT_PMULL
+#define DISPATCH_FEAT_SHA1    0x0008  // FEAT_SHA1
+#define DISPATCH_FEAT_SHA256  0x0010  // FEAT_SHA256
+#define DISPATCH_FEAT_SHA512  0x0020  // FEAT_SHA512
+#define DISPATCH_FEAT_SHA3    0x0040  // FEAT_SHA3
+
+// Features which are guaranteed by the compilation target options (-march, -mcpu),
+// as reported by the ACLE __ARM_FEATURE_xxx macros. This is a constant expression
+// which can be used in #if: the dispatch can be replaced by a direct call.
+#if defined(__ARM_FEATURE_CRC32)
+    #define DISPATCH_BASELINE_CRC32 DISPATCH_FEAT_CRC32
+#else
+    #define DISPATCH_BASELINE_CRC32 0
+#endif
+#if defined(__ARM_FEATURE_AES)
+    #define DISPATCH_BASELINE_AES (DISPATCH_FEAT_AES | DISPATCH_FEAT_PMULL)
+#else
+    #define DISPATCH_BASELINE_AES 0
+#endif
+#if defined(__ARM_FEATURE_SHA2)
+    #define DISPATCH_BASELINE_SHA2 (DISPATCH_FEAT_SHA1 | DISPATCH_FEAT_SHA256)
+#else
+    #define DISPATCH_BASELINE_SHA2 0
+#endif
+#if defined(__ARM_FEATURE_SHA512)
+    #define DISPATCH_BASELINE_SHA512 DISPATCH_FEAT_SHA512
+#else
+    #define DISPATCH_BASELINE_SHA512 0
+#endif
+#if defined(__ARM_FEATURE_SHA3)
+    #define DISPATCH_BASELINE_SHA3 DISPATCH_FEAT_SHA3
+#else
+    #define DISPATCH_BASELINE_SHA3 0
+#endif
+
+#define DISPATCH_BASELINE (DISPATCH_BASELINE_CRC32 | DISPATCH_BASELINE_AES | DISPATCH_BASELINE_SHA2 | \
+                           DISPATCH_BASELINE_SHA512 | DISPATCH_BASELINE_SHA3)
+
+// Generic function pointer. Must be cast to the actual function type before call.
+typedef void (*dispatch_func_t)(void);
+
+// Description of one implementation of a function.
+typedef struct {
+    const char*     name;      // implementation name, as used in ACCEL_DISPATCH
+    dispatch_func_t func;      // implementation function
+    unsigned int    features;  // required features, mask of DISPATCH_FEAT_xxx
+    int             priority;  // the highest priority is selected
+    const int*      compiled;  // when not NULL, the implementation is usable if *compiled is non-zero
+} dispatch_impl_t;
+
+// Description of a dispatched function.
+// The function pointer is the first field, it is directly loaded by dispatch_patch.h.
+// It is concurrently written by dispatch_resolve(), read it using DISPATCH_FUNC().
+typedef struct {
+    dispatch_func_t        func;   // selected implementation, initially the resolver
+    const char*            name;   // function name, as used in ACCEL_DISPATCH
+    const dispatch_impl_t* impls;  // array of implementations
+    size_t                 count;  // number of implementations
+} dispatch_t;
+
+// Static initializer of a dispatch_t. The resolver is a function with the same
+// profile as the dispatched function, which calls dispatch_resolve().
+#define DISPATCH_INIT(name, impls, resolver) \
+    {(dispatch_func_t)(resolver), (name), (impls), sizeof(impls) / sizeof((impls)[0])}
+
+// Current function pointer of a dispatch_t, the resolver or the selected implementation.
+#define DISPATCH_FUNC(disp) __atomic_load_n(&(disp).func, __ATOMIC_ACQUIRE)
+
+// Select the implementation of a function, store it and return it.
+// Can be called several times from several threads, the result is always the same:
+// it depends only on the CPU features and ACCEL_DISPATCH. Never return NULL: when no
+// implementation is usable, abort with an error message. A dispatched function shall
+// always have a portable implementation, without required feature.
+dispatch_func_t dispatch_resolve(dispatch_t* disp);
+
+// Get the mask of DISPATCH_FEAT_xxx which are supported on the current CPU.
+unsigned int dispatch_features(void);
+
+#endif // DISPATCH_H
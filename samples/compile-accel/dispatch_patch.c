@@ -0,0 +1,202 @@
+// dl_iterate_phdr() is a GNU extension.
+#if !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE 1
+#endif
+
+#include "dispatch_patch.h"
+
+#if DISPATCH_PATCH
+
+#include <sys/mman.h>
+#include <sys/auxv.h>
+#include <elf.h>
+#include <link.h>
+#include <string.h>
+#include <unistd.h>
+
+// Linux ABI values, in case the system headers are too old.
+#if !defined(PROT_BTI)
+    #define PROT_BTI 0x10
+#endif
+#if !defined(HWCAP2_BTI)
+    #define HWCAP2_BTI (1 << 17)
+#endif
+#if !defined(PT_GNU_PROPERTY)
+    #define PT_GNU_PROPERTY 0x6474e553
+#endif
+#if !defined(NT_GNU_PROPERTY_TYPE_0)
+    #define NT_GNU_PROPERTY_TYPE_0 5
+#endif
+#if !defined(GNU_PROPERTY_AARCH64_FEATURE_1_AND)
+    #define GNU_PROPERTY_AARCH64_FEATURE_1_AND 0xc0000000
+#endif
+#if !defined(GNU_PROPERTY_AARCH64_FEATURE_1_BTI)
+    #define GNU_PROPERTY_AARCH64_FEATURE_1_BTI (1U << 0)
+#endif
+
+// Search of the module (executable or shared object) which contains an address.
+typedef struct {
+    uintptr_t addr;   // address to search
+    int       found;  // the module was found
+    int       bti;    // the module is marked as BTI-compatible
+} dispatch_module_t;
+
+// Check if the content of a PT_GNU_PROPERTY segment has the BTI property.
+// The notes and the properties are 8-byte aligned in 64-bit ELF files.
+static int dispatch_property_bti(const uint8_t* data, size_t size)
+{
+    const uint8_t* const end = data + size;
+    while ((size_t)(end - data) >= sizeof(Elf64_Nhdr)) {
+        const Elf64_Nhdr* note = (const Elf64_Nhdr*)data;
+        const uint8_t* desc = data + ((sizeof(Elf64_Nhdr) + note->n_namesz + 7) & ~(size_t)7);
+        if (desc > end || note->n_descsz > (size_t)(end - desc)) {
+            break;
+        }
+        if (note->n_type == NT_GNU_PROPERTY_TYPE_0 && note->n_namesz == 4 && memcmp(note + 1, "GNU", 4) == 0) {
+            const uint8_t* const desc_end = desc + note->n_descsz;
+            for (const uint8_t* prop = desc; desc_end - prop >= 8; ) {
+                const uint32_t type = ((const uint32_t*)prop)[0];
+                const uint32_t prop_size = ((const uint32_t*)prop)[1];
+                if (prop_size > (size_t)(desc_end - prop - 8)) {
+                    break;
+                }
+                if (type == GNU_PROPERTY_AARCH64_FEATURE_1_AND && prop_size >= 4) {
+                    return (((const uint32_t*)prop)[2] & GNU_PROPERTY_AARCH64_FEATURE_1_BTI) != 0;
+                }
+                prop += 8 + ((prop_size + 7) & ~(size_t)7);
+            }
+        }
+        data = desc + ((note->n_descsz + 7) & ~(size_t)7);
+    }
+    return 0;
+}
+
+// Callback for dl_iterate_phdr(): check if the module contains the address.
+static int dispatch_find_module(struct dl_phdr_info* info, size_t size, void* data)
+{
+    (void)size;
+    dispatch_module_t* module = (dispatch_module_t*)data;
+    for (size_t i = 0; !module->found && i < info->dlpi_phnum; ++i) {
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        const uintptr_t start = info->dlpi_addr + ph->p_vaddr;
+        module->found = ph->p_type == PT_LOAD && module->addr >= start && module->addr - start < ph->p_memsz;
+    }
+    for (size_t i = 0; module->found && i < info->dlpi_phnum; ++i) {
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        if (ph->p_type == PT_GNU_PROPERTY) {
+            module->bti = dispatch_property_bti((const uint8_t*)(info->dlpi_addr + ph->p_vaddr), ph->p_memsz);
+        }
+    }
+    return module->found;
+}
+
+// Get the protection of the code page which contains an address. Return 0 if unknown.
+// The code pages of a BTI-compatible module are mapped with PROT_BTI, by the kernel or
+// the dynamic loader, only when the CPU and the kernel support BTI.
+static int dispatch_code_prot(const void* addr)
+{
+    dispatch_module_t module = {(uintptr_t)addr, 0, 0};
+    dl_iterate_phdr(dispatch_find_module, &module);
+    if (!module.found) {
+        return 0;
+    }
+    const int bti = module.bti && (getauxval(AT_HWCAP2) & HWCAP2_BTI) != 0;
+    return PROT_READ | PROT_EXEC | (bti ? PROT_BTI : 0);
+}
+
+// Start and end of the section "dispatch_sites", defined by the linker.
+// Weak symbols: the section does not exist when no site is linked.
+extern dispatch_site_t __start_dispatch_sites[] __attribute__((weak));
+extern dispatch_site_t __stop_dispatch_sites[] __attribute__((weak));
+
+void dispatch_patch_sync(void* start, size_t size)
+{
+    // Line sizes in CTR_EL0 are log2 of the number of 4-byte words.
+    uint64_t ctr;
+    __asm__ volatile("mrs %0, ctr_el0" : "=r" (ctr));
+    const uintptr_t dline = 4 << ((ctr >> 16) & 0x0F);  // DminLine
+    const uintptr_t iline = 4 << (ctr & 0x0F);          // IminLine
+    const uintptr_t end = (uintptr_t)start + size;
+
+    // CTR_EL0.IDC: the data cache clean to the point of unification is not required.
+    if ((ctr & (1 << 28)) == 0) {
+        for (uintptr_t addr = (uintptr_t)start & ~(dline - 1); addr < end; addr += dline) {
+            __asm__ volatile("dc cvau, %0" : : "r" (addr) : "memory");
+        }
+    }
+    __asm__ volatile("dsb ish" : : : "memory");
+
+    // CTR_EL0.DIC: the instruction cache invalidation to the point of unification is not required.
+    if ((ctr & (1 << 29)) == 0) {
+        for (uintptr_t addr = (uintptr_t)start & ~(iline - 1); addr < end; addr += iline) {
+            __asm__ volatile("ic ivau, %0" : : "r" (addr) : "memory");
+        }
+        __asm__ volatile("dsb ish" : : : "memory");
+    }
+    __asm__ volatile("isb" : : : "memory");
+}
+
+// Patch one site with a direct branch to the target. The code page has the protection prot.
+// Return 1 on success, 0 when the site is not patched, -1 when the code page remains writable.
+static int dispatch_patch_branch(uint32_t* site, dispatch_func_t target, int prot)
+{
+    // B imm26: signed offset in instructions, +/-128 MB.
+    const intptr_t offset = (intptr_t)target - (intptr_t)site;
+    if ((offset & 3) != 0 || offset < -(1L << 27) || offset >= (1L << 27)) {
+        return 0;
+    }
+    const uint32_t insn = 0x14000000 | (((uint64_t)offset >> 2) & 0x03FFFFFF);
+    if (*site == insn) {
+        return 1;
+    }
+
+    // An aligned instruction is never split between two pages.
+    const uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    void* page = (void*)((uintptr_t)site & ~(page_size - 1));
+    if (mprotect(page, page_size, prot | PROT_WRITE) != 0) {
+        return 0;
+    }
+    __atomic_store_n(site, insn, __ATOMIC_RELAXED);
+    dispatch_patch_sync(site, sizeof(*site));
+    return mprotect(page, page_size, prot) == 0 ? 1 : -1;
+}
+
+size_t dispatch_patch_all(void)
+{
+    // All sites are in the same module, linked with this code. The protection of the code
+    // pages must be restored exactly. When it is unknown, the sites are not patched.
+    size_t count = 0;
+    dispatch_site_t* const first = __start_dispatch_sites;
+    const int prot = first != NULL && first < __stop_dispatch_sites ? dispatch_code_prot(first->site) : 0;
+    for (dispatch_site_t* s = first; s != NULL && s < __stop_dispatch_sites; ++s) {
+        // Also store the selection in the function pointer, for the unpatched sites.
+        const dispatch_func_t func = dispatch_resolve(s->disp);
+        const int status = prot == 0 ? 0 : dispatch_patch_branch(s->site, func, prot);
+        if (status < 0) {
+            // Cannot restore the protection, do not make more code pages writable.
+            break;
+        }
+        count += status;
+    }
+    return count;
+}
+
+// Patch all sites before main().
+__attribute__((constructor)) static void dispatch_patch_init(void)
+{
+    dispatch_patch_all();
+}
+
+#else
+
+void dispatch_patch_sync(void* start, size_t size)
+{
+    __builtin___clear_cache((char*)start, (char*)start + size);
+}
+
+size_t dispatch_patch_all(void)
+{
+    return 0;
+}
+
+#endif
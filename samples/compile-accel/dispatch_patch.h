@@ -0,0 +1,93 @@
+#if !defined(DISPATCH_PATCH_H)
+#define DISPATCH_PATCH_H 1
+
+#include "dispatch.h"
+#include <stdint.h>
+
+// Patching of the dispatch sites in the code, a static-key style dispatch.
+//
+// With dispatch.h alone, each call to a dispatched function is an indirect call
+// through the function pointer of its dispatch_t. With dispatch_patch.h, the public
+// function is a small assembly stub which is recorded in a dedicated section:
+//
+//     name: nop                  <- dispatch site
+//           adrp x16, disp       <- indirect branch through the function pointer
+//           ldr  x16, [x16, #:lo12:disp]
+//           br   x16
+//
+// At startup, before main(), each recorded site is patched with a direct branch
+// to the selected implementation, "b impl". All subsequent calls are two direct
+// branches, without load of the function pointer, without indirect branch. When
+// a site cannot be patched (W^X policy, implementation out of branch range), the
+// indirect branch remains in place and works as before.
+//
+// The protection of the code pages is restored exactly. It is PROT_BTI when the module
+// is marked as BTI-compatible (GNU property note) and the CPU and kernel support BTI
+// (HWCAP2_BTI). When the module containing the sites is not found, nothing is patched.
+//
+// Replacing a NOP with a B instruction is allowed while other threads execute it
+// (Arm ARM, concurrent modification and execution of instructions). The caches
+// are maintained using the line sizes and the IDC/DIC bits in CTR_EL0.
+//
+// Text patching is only supported on Linux. On macOS, the code pages are signed
+// and cannot be modified. DISPATCH_PATCH is non-zero when patching is supported.
+
+#if defined(__linux__) && defined(__aarch64__)
+    #define DISPATCH_PATCH 1
+#else
+    #define DISPATCH_PATCH 0
+#endif
+
+// A dispatch site, as recorded in the section "dispatch_sites".
+typedef struct {
+    uint32_t*   site;  // instruction to patch, initially a NOP
+    dispatch_t* disp;  // dispatch of the function
+} dispatch_site_t;
+
+// Storage class of a dispatch_t which is referenced by DISPATCH_PATCH_SITE.
+// The stub references it by name from top-level assembly code. A static object could
+// be renamed or dropped by link-time optimization: it is global, kept and hidden.
+#if DISPATCH_PATCH
+    #define DISPATCH_PATCH_STORAGE __attribute__((used, visibility("hidden")))
+#else
+    #define DISPATCH_PATCH_STORAGE static
+#endif
+
+// Landing pad at the entry of the stub, when compiled with -mbranch-protection=bti.
+#if defined(__ARM_FEATURE_BTI_DEFAULT)
+    #define DISPATCH_PATCH_BTI "    bti  c\n"
+#else
+    #define DISPATCH_PATCH_BTI ""
+#endif
+
+// Define a public function "name" as a patchable stub to the selected implementation
+// in the dispatch_t "disp", declared with DISPATCH_PATCH_STORAGE. Must be used at file scope.
+// The registers are untouched, except x16, the function can have any profile.
+// The field "func" must be the first one in dispatch_t. It is loaded with a plain LDR,
+// the indirect branch depends on the loaded address and the target code is immutable.
+#define DISPATCH_PATCH_SITE(name, disp)                 \
+    __asm__(".pushsection .text\n"                      \
+            ".balign 16\n"                              \
+            ".globl " #name "\n"                        \
+            ".type " #name ", %function\n"              \
+            #name ":\n"                                 \
+            DISPATCH_PATCH_BTI                          \
+            "1:  nop\n"                                 \
+            "    adrp x16, " #disp "\n"                 \
+            "    ldr  x16, [x16, #:lo12:" #disp "]\n"   \
+            "    br   x16\n"                            \
+            ".size " #name ", . - " #name "\n"          \
+            ".popsection\n"                             \
+            ".pushsection dispatch_sites, \"aw\"\n"     \
+            ".balign 8\n"                               \
+            ".quad 1b, " #disp "\n"                     \
+            ".popsection\n")
+
+// Patch all dispatch sites in the executable. Automatically called before main().
+// Return the number of patched sites.
+size_t dispatch_patch_all(void);
+
+// Synchronize the instruction cache after a modification of the code.
+void dispatch_patch_sync(void* start, size_t size);
+
+#endif // DISPATCH_PATCH_H
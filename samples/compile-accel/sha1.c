@@ -1,24 +1,51 @@
 #include "sha1.h"
 #include "sha1_accel.h"
-#include "armfeature.h"
+#include "dispatch.h"
+#include "dispatch_patch.h"
 #include <stdio.h>
 
-static volatile int sha1_accel_checked = 0;
-static volatile int sha1_accel_supported = 0;
+#if (DISPATCH_BASELINE & DISPATCH_FEAT_SHA1) != 0
 
+// The accelerated implementation is always supported by the compilation target, no dispatch.
 void sha1()
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!sha1_accel_checked) {
-        sha1_accel_supported = sha1_accel_compiled && armfeature(AT_HWCAP, HWCAP_SHA1, "hw.optional.arm.FEAT_SHA1");
-        sha1_accel_checked = 1;
-    }
-
-    // Each time, select accelerated implementation when supported.
-    if (sha1_accel_supported) {
-        sha1_accel();
-    }
-    else {
-        printf("sha1():   portable implementation\n");
-    }
+    sha1_accel();
 }
+
+#else
+
+// Portable implementation.
+static void sha1_portable()
+{
+    printf("sha1():   portable implementation\n");
+}
+
+// All implementations, the accelerated one is preferred when supported.
+static const dispatch_impl_t sha1_impls[] = {
+    {"accel",    sha1_accel,    DISPATCH_FEAT_SHA1, 1, &sha1_accel_compiled},
+    {"portable", sha1_portable, 0, 0, NULL},
+};
+
+// Called on first call only, select the implementation and call it.
+static void sha1_resolve();
+DISPATCH_PATCH_STORAGE dispatch_t sha1_dispatch = DISPATCH_INIT("sha1", sha1_impls, sha1_resolve);
+static void sha1_resolve()
+{
+    dispatch_resolve(&sha1_dispatch)();
+}
+
+#if DISPATCH_PATCH
+
+// The call site is patched at startup with a direct branch to the selected implementation.
+DISPATCH_PATCH_SITE(sha1, sha1_dispatch);
+
+#else
+
+void sha1()
+{
+    // Each time, directly call the selected implementation.
+    DISPATCH_FUNC(sha1_dispatch)();
+}
+
+#endif
+#endif
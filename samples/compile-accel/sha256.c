@@ -1,24 +1,51 @@
 #include "sha256.h"
 #include "sha256_accel.h"
-#include "armfeature.h"
+#include "dispatch.h"
+#include "dispatch_patch.h"
 #include <stdio.h>
 
-static volatile int sha256_accel_checked = 0;
-static volatile int sha256_accel_supported = 0;
+#if (DISPATCH_BASELINE & DISPATCH_FEAT_SHA256) != 0
 
+// The accelerated implementation is always supported by the compilation target, no dispatch.
 void sha256()
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!sha256_accel_checked) {
-        sha256_accel_supported = sha256_accel_compiled && armfeature(AT_HWCAP, HWCAP_SHA2, "hw.optional.arm.FEAT_SHA256");
-        sha256_accel_checked = 1;
-    }
-
-    // Each time, select accelerated implementation when supported.
-    if (sha256_accel_supported) {
-        sha256_accel();
-    }
-    else {
-        printf("sha256(): portable implementation\n");
-    }
+    sha256_accel();
 }
+
+#else
+
+// Portable implementation.
+static void sha256_portable()
+{
+    printf("sha256(): portable implementation\n");
+}
+
+// All implementations, the accelerated one is preferred when supported.
+static const dispatch_impl_t sha256_impls[] = {
+    {"accel",    sha256_accel,    DISPATCH_FEAT_SHA256, 1, &sha256_accel_compiled},
+    {"portable", sha256_portable, 0, 0, NULL},
+};
+
+// Called on first call only, select the implementation and call it.
+static void sha256_resolve();
+DISPATCH_PATCH_STORAGE dispatch_t sha256_dispatch = DISPATCH_INIT("sha256", sha256_impls, sha256_resolve);
+static void sha256_resolve()
+{
+    dispatch_resolve(&sha256_dispatch)();
+}
+
+#if DISPATCH_PATCH
+
+// The call site is patched at startup with a direct branch to the selected implementation.
+DISPATCH_PATCH_SITE(sha256, sha256_dispatch);
+
+#else
+
+void sha256()
+{
+    // Each time, directly call the selected implementation.
+    DISPATCH_FUNC(sha256_dispatch)();
+}
+
+#endif
+#endif
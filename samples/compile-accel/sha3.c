@@ -1,24 +1,51 @@
 #include "sha3.h"
 #include "sha3_accel.h"
-#include "armfeature.h"
+#include "dispatch.h"
+#include "dispatch_patch.h"
 #include <stdio.h>
 
-static volatile int sha3_accel_checked = 0;
-static volatile int sha3_accel_supported = 0;
+#if (DISPATCH_BASELINE & DISPATCH_FEAT_SHA3) != 0
 
+// The accelerated implementation is always supported by the compilation target, no dispatch.
 void sha3()
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!sha3_accel_checked) {
-        sha3_accel_supported = sha3_accel_compiled && armfeature(AT_HWCAP, HWCAP_SHA3, "hw.optional.arm.FEAT_SHA3");
-        sha3_accel_checked = 1;
-    }
-
-    // Each time, select accelerated implementation when supported.
-    if (sha3_accel_supported) {
-        sha3_accel();
-    }
-    else {
-        printf("sha3():   portable implementation\n");
-    }
+    sha3_accel();
 }
+
+#else
+
+// Portable implementation.
+static void sha3_portable()
+{
+    printf("sha3():   portable implementation\n");
+}
+
+// All implementations, the accelerated one is preferred when supported.
+static const dispatch_impl_t sha3_impls[] = {
+    {"accel",    sha3_accel,    DISPATCH_FEAT_SHA3, 1, &sha3_accel_compiled},
+    {"portable", sha3_portable, 0, 0, NULL},
+};
+
+// Called on first call only, select the implementation and call it.
+static void sha3_resolve();
+DISPATCH_PATCH_STORAGE dispatch_t sha3_dispatch = DISPATCH_INIT("sha3", sha3_impls, sha3_resolve);
+static void sha3_resolve()
+{
+    dispatch_resolve(&sha3_dispatch)();
+}
+
+#if DISPATCH_PATCH
+
+// The call site is patched at startup with a direct branch to the selected implementation.
+DISPATCH_PATCH_SITE(sha3, sha3_dispatch);
+
+#else
+
+void sha3()
+{
+    // Each time, directly call the selected implementation.
+    DISPATCH_FUNC(sha3_dispatch)();
+}
+
+#endif
+#endif
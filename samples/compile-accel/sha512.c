@@ -1,24 +1,51 @@
 #include "sha512.h"
 #include "sha512_accel.h"
-#include "armfeature.h"
+#include "dispatch.h"
+#include "dispatch_patch.h"
 #include <stdio.h>
 
-static volatile int sha512_accel_checked = 0;
-static volatile int sha512_accel_supported = 0;
+#if (DISPATCH_BASELINE & DISPATCH_FEAT_SHA512) != 0
 
+// The accelerated implementation is always supported by the compilation target, no dispatch.
 void sha512()
 {
-    // Check done once only. No need for multi-thread synchronization.
-    if (!sha512_accel_checked) {
-        sha512_accel_supported = sha512_accel_compiled && armfeature(AT_HWCAP, HWCAP_SHA512, "hw.optional.arm.FEAT_SHA512");
-        sha512_accel_checked = 1;
-    }
-
-    // Each time, select accelerated implementation when supported.
-    if (sha512_accel_supported) {
-        sha512_accel();
-    }
-    else {
-        printf("sha512(): portable implementation\n");
-    }
+    sha512_accel();
 }
+
+#else
+
+// Portable implementation.
+static void sha512_portable()
+{
+    printf("sha512(): portable implementation\n");
+}
+
+// All implementations, the accelerated one is preferred when supported.
+static const dispatch_impl_t sha512_impls[] = {
+    {"accel",    sha512_accel,    DISPATCH_FEAT_SHA512, 1, &sha512_accel_compiled},
+    {"portable", sha512_portable, 0, 0, NULL},
+};
+
+// Called on first call only, select the implementation and call it.
+static void sha512_resolve();
+DISPATCH_PATCH_STORAGE dispatch_t sha512_dispatch = DISPATCH_INIT("sha512", sha512_impls, sha512_resolve);
+static void sha512_resolve()
+{
+    dispatch_resolve(&sha512_dispatch)();
+}
+
+#if DISPATCH_PATCH
+
+// The call site is patched at startup with a direct branch to the selected implementation.
+DISPATCH_PATCH_SITE(sha512, sha512_dispatch);
+
+#else
+
+void sha512()
+{
+    // Each time, directly call the selected implementation.
+    DISPATCH_FUNC(sha512_dispatch)();
+}
+
+#endif
+#endif